@@ -1,21 +1,46 @@
 #include "cmd/benchmark.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
 #include <queue>
+#include <random>
 #include <sstream>
 
 #include "eval/evaluator.hpp"
+#include "eval/minimizer.hpp"
+#include "eval/optimizer.hpp"
+#include "eval/semantics.hpp"
 #include "form/formula_gen.hpp"
 #include "lang/parser.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
+#include "mine/matcher.hpp"
+#include "mine/miner.hpp"
 #include "seq/managed_seq.hpp"
+#include "seq/seq_index.hpp"
+#include "seq/seq_loader.hpp"
+#include "seq/seq_util.hpp"
+#include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/setup.hpp"
+#include "sys/thread_pool.hpp"
 #include "sys/util.hpp"
 
+const std::vector<std::string> Benchmark::SUITES = {
+    "numbers", "interpreter", "matcher", "sequences", "optimizer", "formula"};
+
+Benchmark::Benchmark(size_t warmup, size_t repetitions)
+    : warmup(warmup), repetitions(std::max<size_t>(repetitions, 1)) {}
+
 void Benchmark::smokeTest() {
   operations();
   programs();
+  optimizer();
 }
 
 std::string fillString(std::string s, size_t n) {
@@ -105,6 +130,35 @@ void Benchmark::programs() {
   std::cout << std::endl;
 }
 
+void Benchmark::optimizer() {
+  Setup::setProgramsHome("tests/programs");
+  Settings settings;
+  Optimizer optimizer(settings);
+  optimizer.setProfiling(true);
+  Parser parser;
+  for (size_t id = 0; id < 400000; id++) {
+    const auto path = ProgramUtil::getProgramPath(UID('A', id));
+    if (!isFile(path)) {
+      continue;
+    }
+    auto program = parser.parse(path);
+    optimizer.optimize(program);
+  }
+  std::cout << "| Optimizer Pass          | Runs   | Changes | Skipped | Time      |"
+            << std::endl;
+  std::cout << "|-------------------------|--------|---------|---------|-----------|"
+            << std::endl;
+  for (const auto& s : optimizer.getPassStats()) {
+    std::cout << "| " << fillString(s.name, 23) << " | "
+              << fillString(std::to_string(s.invocations), 6) << " | "
+              << fillString(std::to_string(s.changes), 7) << " | "
+              << fillString(std::to_string(s.skipped), 7) << " | "
+              << fillString(formatDuration(s.microseconds), 9) << " |"
+              << std::endl;
+  }
+  std::cout << std::endl;
+}
+
 void Benchmark::program(size_t id, size_t num_terms) {
   Parser parser;
   UID uid('A', id);
@@ -143,14 +197,21 @@ std::string Benchmark::programEval(const Program& p, eval_mode_t eval_mode,
   return formatDuration(microseconds);
 }
 
-void Benchmark::findSlow(int64_t num_terms, Operation::Type type) {
+// calls the function for all OEIS programs using the program corpus if
+// available, otherwise by parsing the program files
+void forEachProgram(const std::function<void(UID, const Program&)>& f) {
+  auto corpus = ProgramCorpus::getDefault();
+  if (corpus) {
+    for (size_t i = 0; i < corpus->size(); i++) {
+      const auto uid = corpus->getId(i);
+      if (uid.domain() == 'A') {
+        f(uid, corpus->getProgram(i));
+      }
+    }
+    return;
+  }
   Parser parser;
-  Settings settings;
-  Interpreter interpreter(settings);
-  Evaluator evaluator(settings, EVAL_ALL, false);
-  Sequence seq;
   Program program;
-  std::priority_queue<std::pair<int64_t, UID> > queue;
   for (size_t id = 0; id < 400000; id++) {
     UID uid('A', id);
     std::ifstream in(ProgramUtil::getProgramPath(uid));
@@ -163,8 +224,19 @@ void Benchmark::findSlow(int64_t num_terms, Operation::Type type) {
       Log::get().warn("Skipping " + uid.string() + ": " + e.what());
       continue;
     }
+    f(uid, program);
+  }
+}
+
+void Benchmark::findSlow(int64_t num_terms, Operation::Type type) {
+  Settings settings;
+  Interpreter interpreter(settings);
+  Evaluator evaluator(settings, EVAL_ALL, false);
+  Sequence seq;
+  std::priority_queue<std::pair<int64_t, UID> > queue;
+  forEachProgram([&](UID uid, const Program& program) {
     if (type != Operation::Type::NOP && !ProgramUtil::hasOp(program, type)) {
-      continue;
+      return;
     }
     auto start_time = std::chrono::steady_clock::now();
     evaluator.eval(program, seq, num_terms, false);
@@ -174,9 +246,9 @@ void Benchmark::findSlow(int64_t num_terms, Operation::Type type) {
                             .count();
     Log::get().info(uid.string() + ": " + formatDuration(microseconds));
     queue.push(std::pair<int64_t, UID>(microseconds, uid));
-  }
+  });
   std::cout << std::endl << "Slowest programs:" << std::endl;
-  for (size_t i = 0; i < 20; i++) {
+  for (size_t i = 0; i < 20 && !queue.empty(); i++) {
     auto entry = queue.top();
     queue.pop();
     std::cout << "[" << entry.second.string()
@@ -185,40 +257,654 @@ void Benchmark::findSlow(int64_t num_terms, Operation::Type type) {
   }
 }
 
+// generates a formula for a program and returns the time in microseconds
+static int64_t timeFormulaGeneration(UID id, const Program& program) {
+  FormulaGenerator gen;
+  Formula formula;
+  auto start_time = std::chrono::steady_clock::now();
+  try {
+    gen.generate(program, id.number(), formula, false);
+  } catch (const std::exception& e) {
+    Log::get().warn(id.string() + ": " + e.what());
+  }
+  auto end_time = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(end_time -
+                                                               start_time)
+      .count();
+}
+
 void Benchmark::findSlowFormulas() {
-  Parser parser;
+  struct Candidate {
+    int64_t microseconds;
+    UID id;
+    Program program;
+  };
+  static constexpr size_t NUM_RESULTS = 20;      // magic number
+  static constexpr size_t NUM_CANDIDATES = 100;  // magic number
+  auto slower = [](const Candidate& a, const Candidate& b) {
+    return a.microseconds > b.microseconds;
+  };
+  std::vector<Candidate> candidates;
+  ThreadPool pool(ThreadPool::getDefaultNumThreads());
+  // generate formulas in parallel using batches of programs and keep the
+  // slowest ones as candidates
+  const size_t batch_size = 100 * pool.size();  // magic number
+  std::vector<std::pair<UID, Program>> batch;
+  auto process_batch = [&]() {
+    std::vector<int64_t> times(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      pool.submit([&, i]() {
+        times[i] = timeFormulaGeneration(batch[i].first, batch[i].second);
+        Log::get().info(batch[i].first.string() + ": " +
+                        formatDuration(times[i]));
+      });
+    }
+    pool.wait();
+    for (size_t i = 0; i < batch.size(); i++) {
+      candidates.push_back(
+          {times[i], batch[i].first, std::move(batch[i].second)});
+    }
+    if (candidates.size() > NUM_CANDIDATES) {
+      std::nth_element(candidates.begin(),
+                       candidates.begin() + NUM_CANDIDATES, candidates.end(),
+                       slower);
+      candidates.resize(NUM_CANDIDATES);
+    }
+    batch.clear();
+  };
+  forEachProgram([&](UID uid, const Program& program) {
+    batch.emplace_back(uid, program);
+    if (batch.size() >= batch_size) {
+      process_batch();
+    }
+  });
+  process_batch();
+  // the parallel timings are distorted by contention between the threads,
+  // hence the candidates are timed again one after another
+  Log::get().info("Timing " + std::to_string(candidates.size()) +
+                  " slowest formula generations serially");
+  for (auto& c : candidates) {
+    c.microseconds = timeFormulaGeneration(c.id, c.program);
+  }
+  std::sort(candidates.begin(), candidates.end(), slower);
+  std::cout << std::endl << "Slowest formula generations:" << std::endl;
+  for (size_t i = 0; i < NUM_RESULTS && i < candidates.size(); i++) {
+    const auto& c = candidates[i];
+    std::cout << "[" << c.id.string()
+              << "](https://loda-lang.org/edit/?oeis=" << c.id.number()
+              << "): " << formatDuration(c.microseconds) << std::endl;
+  }
+}
+
+// --- Benchmark suites -------------------------------------------------------
+
+// uses the test programs as programs home while in scope
+class TestProgramsHome {
+ public:
+  TestProgramsHome() : previous(Setup::getProgramsHomeNoCheck()) {
+    Setup::setProgramsHome("tests/programs");
+  }
+
+  ~TestProgramsHome() { Setup::setProgramsHome(previous); }
+
+ private:
+  const std::string previous;
+};
+
+// all OEIS test programs, ordered by ID; loaded only once
+static const std::vector<std::pair<UID, Program>>& loadTestPrograms() {
+  static const auto programs = []() {
+    std::vector<std::pair<UID, Program>> result;
+    const std::string folder =
+        std::string("tests") + FILE_SEP + "programs" + FILE_SEP + "oeis";
+    Parser parser;
+    if (isDir(folder)) {
+      for (const auto& entry :
+           std::filesystem::recursive_directory_iterator(folder)) {
+        const auto stem = entry.path().stem().string();
+        if (!entry.is_regular_file() || entry.path().extension() != ".asm" ||
+            !UID::valid(stem)) {
+          continue;
+        }
+        try {
+          result.emplace_back(UID(stem), parser.parse(entry.path().string()));
+        } catch (const std::exception& e) {
+          Log::get().warn("Skipping " + stem + ": " + e.what());
+        }
+      }
+    }
+    if (result.empty()) {
+      Log::get().error("No test programs found in " + folder, true);
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+      return a.first < b.first;
+    });
+    return result;
+  }();
+  return programs;
+}
+
+// evaluates the test programs; programs with too few terms are skipped
+static std::vector<std::pair<UID, Sequence>> evalTestPrograms(
+    const std::vector<std::pair<UID, Program>>& programs, size_t num_terms) {
+  TestProgramsHome programs_home;
   Settings settings;
-  Program program;
-  std::priority_queue<std::pair<int64_t, UID> > queue;
-  for (size_t id = 0; id < 400000; id++) {
-    UID uid('A', id);
-    std::ifstream in(ProgramUtil::getProgramPath(uid));
-    if (!in) {
-      continue;
+  Evaluator evaluator(settings, EVAL_ALL, false);
+  std::vector<std::pair<UID, Sequence>> result;
+  Sequence seq;
+  for (const auto& p : programs) {
+    evaluator.eval(p.second, seq, num_terms, false);
+    if (seq.size() == num_terms) {
+      result.emplace_back(p.first, seq);
     }
-    try {
-      program = parser.parse(in);
-    } catch (std::exception& e) {
-      Log::get().warn("Skipping " + uid.string() + ": " + e.what());
-      continue;
+  }
+  return result;
+}
+
+void Benchmark::runSuites(const std::vector<std::string>& suites,
+                          const std::string& json_path) {
+  std::vector<std::string> selected;
+  for (const auto& s : suites) {
+    if (s == "all") {
+      selected = SUITES;
+      break;
+    }
+    if (std::find(SUITES.begin(), SUITES.end(), s) == SUITES.end()) {
+      Log::get().error("Unknown benchmark suite: " + s, true);
     }
-    FormulaGenerator gen;
-    Formula formula;
+    selected.push_back(s);
+  }
+  results.clear();
+  TestProgramsHome programs_home;
+  for (const auto& s : selected) {
+    Log::get().info("Running benchmark suite " + s);
+    if (s == "numbers") {
+      suiteNumbers();
+    } else if (s == "interpreter") {
+      suiteInterpreter();
+    } else if (s == "matcher") {
+      suiteMatcher();
+    } else if (s == "sequences") {
+      suiteSequences();
+    } else if (s == "optimizer") {
+      suiteOptimizer();
+    } else if (s == "formula") {
+      suiteFormula();
+    }
+  }
+  std::cout << "| Suite       | Case                     | Median     | P95        |"
+            << std::endl;
+  std::cout << "|-------------|--------------------------|------------|------------|"
+            << std::endl;
+  for (const auto& r : results) {
+    std::cout << "| " << fillString(r.suite, 11) << " | "
+              << fillString(r.name, 24) << " | "
+              << fillString(formatDuration(std::llround(r.median)), 10)
+              << " | " << fillString(formatDuration(std::llround(r.p95)), 10)
+              << " |" << std::endl;
+  }
+  std::cout << std::endl;
+  if (!json_path.empty()) {
+    writeJson(results, warmup, repetitions, json_path);
+    Log::get().info("Wrote benchmark results to " + json_path);
+  }
+}
+
+void Benchmark::measure(const std::string& suite, const std::string& name,
+                        const std::function<void()>& f) {
+  for (size_t i = 0; i < warmup; i++) {
+    f();
+  }
+  std::vector<double> times;
+  for (size_t i = 0; i < repetitions; i++) {
     auto start_time = std::chrono::steady_clock::now();
-    gen.generate(program, id, formula, false);
+    f();
     auto end_time = std::chrono::steady_clock::now();
-    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(
-                            end_time - start_time)
-                            .count();
-    Log::get().info(uid.string() + ": " + formatDuration(microseconds));
-    queue.push(std::pair<int64_t, UID>(microseconds, uid));
+    times.push_back(
+        std::chrono::duration<double, std::micro>(end_time - start_time)
+            .count());
   }
-  std::cout << std::endl << "Slowest formula generations:" << std::endl;
-  for (size_t i = 0; i < 20; i++) {
-    auto entry = queue.top();
-    queue.pop();
-    std::cout << "[" << entry.second.string()
-              << "](https://loda-lang.org/edit/?oeis=" << entry.second.number()
-              << "): " << formatDuration(entry.first) << std::endl;
+  auto result = computeStats(times);
+  result.suite = suite;
+  result.name = name;
+  Log::get().debug("Benchmark " + suite + "/" + name + ": " +
+                   formatDuration(std::llround(result.median)));
+  results.push_back(result);
+}
+
+Benchmark::Result Benchmark::computeStats(std::vector<double> times) {
+  Result result;
+  result.runs = times.size();
+  if (times.empty()) {
+    return result;
+  }
+  std::sort(times.begin(), times.end());
+  const size_t n = times.size();
+  result.median =
+      (n % 2) ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+  const size_t p95 = static_cast<size_t>(std::ceil(0.95 * n));
+  result.p95 = times[std::max<size_t>(p95, 1) - 1];
+  double sum = 0;
+  for (auto t : times) {
+    sum += t;
   }
+  result.mean = sum / n;
+  result.min = times.front();
+  result.max = times.back();
+  return result;
+}
+
+void Benchmark::suiteNumbers() {
+  // fixed seed for reproducible operands
+  std::mt19937 gen(42);
+  auto randomNumbers = [&](int64_t min_digits, int64_t max_digits) {
+    std::vector<Number> numbers(200);
+    std::string str;
+    for (auto& n : numbers) {
+      const int64_t num_digits =
+          min_digits + (gen() % (max_digits - min_digits + 1));
+      str.clear();
+      if (gen() % 2) {
+        str += '-';
+      }
+      str += '1' + static_cast<char>(gen() % 9);
+      for (int64_t j = 1; j < num_digits; j++) {
+        str += '0' + static_cast<char>(gen() % 10);
+      }
+      n = Number(str);
+    }
+    return numbers;
+  };
+  const std::vector<std::pair<std::string, std::vector<Number>>> sizes = {
+      {"small", randomNumbers(1, 18)}, {"big", randomNumbers(19, 200)}};
+  for (auto& type : Operation::Types) {
+    if (!ProgramUtil::isArithmetic(type)) {
+      continue;
+    }
+    for (const auto& size : sizes) {
+      const auto& ops = size.second;
+      measure("numbers",
+              Operation::Metadata::get(type).name + "/" + size.first, [&]() {
+                for (size_t i = 0; i + 1 < ops.size(); i++) {
+                  try {
+                    Interpreter::calc(type, ops[i], ops[i + 1]);
+                  } catch (const std::exception&) {
+                    // ignore arithmetic errors
+                  }
+                }
+              });
+    }
+  }
+}
+
+void Benchmark::suiteInterpreter() {
+  const std::vector<std::pair<size_t, size_t>> cases = {
+      {5, 1000},   {40, 200},   {45, 500},
+      {1113, 100}, {2193, 100}, {12866, 200}};
+  const std::vector<std::pair<std::string, eval_mode_t>> modes = {
+      {"reg", EVAL_REGULAR}, {"inc", EVAL_INCREMENTAL}, {"vir", EVAL_VIRTUAL}};
+  Settings settings;
+  Parser parser;
+  Sequence seq;
+  for (const auto& c : cases) {
+    UID uid('A', c.first);
+    auto program = parser.parse(ProgramUtil::getProgramPath(uid));
+    for (const auto& mode : modes) {
+      Evaluator evaluator(settings, mode.second, false);
+      if (!evaluator.supportsEvalModes(program, mode.second)) {
+        continue;
+      }
+      measure("interpreter", uid.string() + "/" + mode.first,
+              [&]() { evaluator.eval(program, seq, c.second, true); });
+    }
+  }
+}
+
+void Benchmark::suiteMatcher() {
+  Settings settings;
+  const auto& programs = loadTestPrograms();
+  const auto seqs = evalTestPrograms(programs, settings.num_terms);
+  std::map<UID, const Program*> program_map;
+  for (const auto& p : programs) {
+    program_map[p.first] = &p.second;
+  }
+  const std::vector<std::string> types = {"direct", "linear1", "linear2",
+                                          "delta",  "binary",  "decimal"};
+  for (const auto& type : types) {
+    Matcher::Config config;
+    config.type = type;
+    config.backoff = false;
+    measure("matcher", "insert/" + type, [&]() {
+      auto matcher = Matcher::Factory::create(config);
+      for (const auto& s : seqs) {
+        matcher->insert(s.second, s.first);
+      }
+    });
+    auto matcher = Matcher::Factory::create(config);
+    for (const auto& s : seqs) {
+      matcher->insert(s.second, s.first);
+    }
+    Matcher::seq_programs_t matches;
+    measure("matcher", "match/" + type, [&]() {
+      for (const auto& s : seqs) {
+        matches.clear();
+        matcher->match(*program_map.at(s.first), s.second, matches);
+      }
+    });
+  }
+}
+
+void Benchmark::suiteSequences() {
+  const std::string folder = getTmpDir() + "loda_benchmark_oeis" + FILE_SEP;
+  ensureDir(folder);
+  writeSequenceFixture(folder, 40, 10);  // magic numbers
+  measure("sequences", "load", [&]() {
+    SequenceIndex index;
+    SequenceLoader loader(index, 0);
+    loader.load(folder, 'A');
+  });
+  SequenceIndex index;
+  SequenceLoader loader(index, 0);
+  loader.load(folder, 'A');
+  measure("sequences", "get-terms", [&]() {
+    for (const auto& s : index) {
+      s.getTerms(Settings::DEFAULT_NUM_TERMS);
+    }
+  });
+}
+
+void Benchmark::suiteOptimizer() {
+  Settings settings;
+  const auto& programs = loadTestPrograms();
+  Optimizer optimizer(settings);
+  optimizer.setCaching(false);
+  measure("optimizer", "optimize", [&]() {
+    for (const auto& p : programs) {
+      auto copy = p.second;
+      optimizer.optimize(copy);
+    }
+  });
+  // minimize programs that can be evaluated
+  std::vector<Program> to_minimize;
+  const auto seqs = evalTestPrograms(programs, settings.num_terms);
+  std::map<UID, const Program*> program_map;
+  for (const auto& p : programs) {
+    program_map[p.first] = &p.second;
+  }
+  for (size_t i = 0; i < seqs.size() && to_minimize.size() < 20; i++) {
+    to_minimize.push_back(*program_map.at(seqs[i].first));
+  }
+  Minimizer minimizer(settings);
+  minimizer.setCaching(false);
+  measure("optimizer", "minimize", [&]() {
+    for (const auto& p : to_minimize) {
+      auto copy = p;
+      try {
+        minimizer.optimizeAndMinimize(copy, settings.num_terms);
+      } catch (const std::exception&) {
+        // ignore evaluation errors
+      }
+    }
+  });
+}
+
+void Benchmark::suiteFormula() {
+  const auto& programs = loadTestPrograms();
+  measure("formula", "generate", [&]() {
+    for (const auto& p : programs) {
+      FormulaGenerator gen;
+      Formula formula;
+      try {
+        gen.generate(p.second, p.first.number(), formula, false);
+      } catch (const std::exception&) {
+        // ignore generation errors
+      }
+    }
+  });
+}
+
+size_t Benchmark::writeSequenceFixture(const std::string& folder,
+                                       size_t num_terms, size_t num_copies,
+                                       bool with_bfiles, bool with_programs) {
+  const auto& programs = loadTestPrograms();
+  const auto seqs = evalTestPrograms(programs, num_terms);
+  std::map<UID, const Program*> program_map;
+  std::map<UID, int64_t> program_offsets;
+  for (const auto& p : programs) {
+    program_map[p.first] = &p.second;
+    program_offsets[p.first] = ProgramUtil::getOffset(p.second);
+  }
+  std::ofstream stripped(folder + "stripped");
+  std::ofstream names(folder + "names");
+  std::ofstream offsets(folder + "offsets");
+  stripped << "# OEIS Sequence Data (generated benchmark fixture)"
+           << std::endl;
+  names << "# OEIS Sequence Names (generated benchmark fixture)" << std::endl;
+  size_t count = 0;
+  for (size_t c = 0; c < std::max<size_t>(num_copies, 1); c++) {
+    for (size_t i = 0; i < seqs.size(); i++) {
+      // copies use IDs that are not used by the test programs
+      const UID uid =
+          c == 0 ? seqs[i].first : UID('A', 500000 + (c - 1) * seqs.size() + i);
+      const int64_t offset = program_offsets[seqs[i].first];
+      std::ofstream bfile;
+      if (with_bfiles) {
+        const auto path = folder + "b" + FILE_SEP + ProgramUtil::dirStr(uid) +
+                          FILE_SEP + "b" + uid.string().substr(1) + ".txt";
+        ensureDir(path);
+        bfile.open(path);
+      }
+      stripped << uid.string() << " ,";
+      for (size_t j = 0; j < seqs[i].second.size(); j++) {
+        const auto& t = seqs[i].second[j];
+        const auto term = c == 0 ? t : Semantics::add(t, Number(c));
+        stripped << term << ",";
+        if (with_bfiles) {
+          bfile << (offset + static_cast<int64_t>(j)) << " " << term
+                << std::endl;
+        }
+      }
+      stripped << std::endl;
+      if (with_programs && c > 0 && i % 10 != 0) {
+        // the shifted sequence is computed by the shifted test program;
+        // every tenth sequence is left without a program to be found
+        Program p = *program_map[seqs[i].first];
+        for (auto& op : p.ops) {
+          op.comment.clear();
+        }
+        ProgramUtil::removeOps(p, Operation::Type::NOP);
+        p.ops.emplace_back(
+            Operation::Type::ADD, Operand(Operand::Type::DIRECT, 0),
+            Operand(Operand::Type::CONSTANT, Number(c)));
+        const auto path = ProgramUtil::getProgramPath(uid);
+        ensureDir(path);
+        std::ofstream out(path);
+        ProgramUtil::print(p, out);
+        if (!out) {
+          Log::get().error("Error writing program to " + path, true);
+        }
+      }
+      names << uid.string() << " Benchmark sequence " << count << std::endl;
+      offsets << uid.string() << ": " << offset << std::endl;
+      count++;
+    }
+  }
+  if (!stripped || !names || !offsets) {
+    Log::get().error("Error writing sequence fixture to " + folder, true);
+  }
+  return count;
+}
+
+// --- Offline mining --------------------------------------------------------
+
+void Benchmark::mine(const Settings& settings, int64_t num_programs,
+                     int64_t num_seconds, uint64_t seed) {
+  const std::string miners_config = "miners.default.json";
+  if (!isFile(miners_config)) {
+    Log::get().error("Miner config not found: " + miners_config, true);
+  }
+
+  // set up a LODA home with fixture data and a copy of the test programs
+  const std::string home = getTmpDir() + "loda_benchmark_mine" + FILE_SEP;
+  std::filesystem::remove_all(home);
+  ensureDir(home);
+  Setup::setLodaHome(home);
+  Setup::setMiningMode(MINING_MODE_LOCAL);
+  Setup::setMinersConfig(miners_config);
+  const std::string programs_home = home + "programs" + FILE_SEP;
+  std::filesystem::copy("tests/programs", programs_home,
+                        std::filesystem::copy_options::recursive);
+  Setup::setProgramsHome(programs_home);
+  // seed programs for most copies of the sequences, so that the miner
+  // mostly compares against existing programs like in a real setup
+  const auto seqs_home = SequenceUtil::getSeqsFolder('A');
+  ensureDir(seqs_home);
+  const auto num_seqs = writeSequenceFixture(seqs_home, 40, 10, true, true);
+  // mark the programs as up-to-date to avoid updates
+  const std::string marker = programs_home + "local" + FILE_SEP + ".update";
+  ensureDir(marker);
+  std::ofstream(marker) << "1" << std::endl;
+  Log::get().info("Created mining fixture with " + std::to_string(num_seqs) +
+                  " sequences in " + home);
+
+  // run the mining loop with a fixed seed
+  Random::get().seed = seed;
+  Random::get().gen.seed(seed);
+  Miner miner(settings);
+  miner.setLimits(num_programs, num_seconds);
+  auto start_time = std::chrono::steady_clock::now();
+  miner.mine();
+  auto end_time = std::chrono::steady_clock::now();
+  const double secs =
+      std::chrono::duration<double>(end_time - start_time).count();
+
+  // print throughput
+  const auto counters = miner.getCounters();
+  auto rate = [&](int64_t count) {
+    std::stringstream buf;
+    buf.setf(std::ios::fixed);
+    buf.precision(2);
+    buf << (secs > 0 ? count / secs : 0.0);
+    return buf.str();
+  };
+  const std::vector<std::pair<std::string, int64_t>> rows = {
+      {"Generated", counters.generated},
+      {"Mutated", counters.mutated},
+      {"Processed", counters.programs},
+      {"Cells", counters.cells},
+      {"Matches", counters.matches},
+      {"Validations", counters.validations},
+      {"Updates", counters.updates}};
+  std::cout << std::endl;
+  std::cout << "| Metric      | Count      | Per Second |" << std::endl;
+  std::cout << "|-------------|------------|------------|" << std::endl;
+  for (const auto& r : rows) {
+    std::cout << "| " << fillString(r.first, 11) << " | "
+              << fillString(std::to_string(r.second), 10) << " | "
+              << fillString(rate(r.second), 10) << " |" << std::endl;
+  }
+  std::cout << std::endl
+            << "Mined for " << formatDuration(std::llround(secs * 1000000))
+            << " using seed " << seed << std::endl;
+}
+
+// --- JSON results and comparison -------------------------------------------
+
+void Benchmark::writeJson(const std::vector<Result>& results, size_t warmup,
+                          size_t repetitions, const std::string& path) {
+  std::ofstream out(path);
+  out << "{" << std::endl;
+  out << "  \"version\": \"" << escapeJsonString(Version::VERSION) << "\","
+      << std::endl;
+  out << "  \"warmup\": " << warmup << "," << std::endl;
+  out << "  \"repetitions\": " << repetitions << "," << std::endl;
+  out << "  \"results\": [";
+  out << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    out << (i > 0 ? "," : "") << std::endl;
+    out << "    {\"suite\": \"" << escapeJsonString(r.suite)
+        << "\", \"name\": \"" << escapeJsonString(r.name)
+        << "\", \"runs\": " << r.runs << ", \"median_us\": " << r.median
+        << ", \"p95_us\": " << r.p95 << ", \"mean_us\": " << r.mean
+        << ", \"min_us\": " << r.min << ", \"max_us\": " << r.max << "}";
+  }
+  out << std::endl << "  ]" << std::endl << "}" << std::endl;
+  if (!out) {
+    Log::get().error("Error writing benchmark results to " + path, true);
+  }
+}
+
+std::vector<Benchmark::Result> Benchmark::readJson(const std::string& path) {
+  if (!isFile(path)) {
+    Log::get().error("Benchmark results not found: " + path, true);
+  }
+  auto json = jute::parser::parse(getFileAsString(path));
+  auto entries = json["results"];
+  if (entries.get_type() != jute::jType::JARRAY) {
+    Log::get().error("Invalid benchmark results: " + path, true);
+  }
+  std::vector<Result> results;
+  for (int i = 0; i < entries.size(); i++) {
+    auto e = entries[i];
+    Result r;
+    r.suite = e["suite"].as_string();
+    r.name = e["name"].as_string();
+    r.runs = getJInt(e, "runs", 0);
+    r.median = getJDouble(e, "median_us", 0);
+    r.p95 = getJDouble(e, "p95_us", 0);
+    r.mean = getJDouble(e, "mean_us", 0);
+    r.min = getJDouble(e, "min_us", 0);
+    r.max = getJDouble(e, "max_us", 0);
+    results.push_back(r);
+  }
+  return results;
+}
+
+size_t Benchmark::compare(const std::string& base_path,
+                          const std::string& current_path, double threshold) {
+  const auto base = readJson(base_path);
+  const auto current = readJson(current_path);
+  std::map<std::string, const Result*> base_map;
+  for (const auto& r : base) {
+    base_map[r.suite + "/" + r.name] = &r;
+  }
+  size_t num_regressions = 0;
+  std::cout << "| Case                                 | Base       | Current    | Change   |"
+            << std::endl;
+  std::cout << "|--------------------------------------|------------|------------|----------|"
+            << std::endl;
+  for (const auto& r : current) {
+    const auto key = r.suite + "/" + r.name;
+    auto it = base_map.find(key);
+    if (it == base_map.end()) {
+      std::cout << "| " << fillString(key, 36) << " | -          | "
+                << fillString(formatDuration(std::llround(r.median)), 10)
+                << " | new      |" << std::endl;
+      continue;
+    }
+    const double b = it->second->median;
+    const double change = b > 0 ? 100.0 * (r.median - b) / b : 0;
+    std::stringstream buf;
+    buf << std::showpos << std::fixed << std::setprecision(1) << change
+        << "%";
+    std::string flag;
+    if (change > threshold) {
+      flag = " REGRESSION";
+      num_regressions++;
+    }
+    std::cout << "| " << fillString(key, 36) << " | "
+              << fillString(formatDuration(std::llround(b)), 10) << " | "
+              << fillString(formatDuration(std::llround(r.median)), 10)
+              << " | " << fillString(buf.str(), 8) << " |" << flag
+              << std::endl;
+    base_map.erase(it);
+  }
+  for (const auto& e : base_map) {
+    std::cout << "| " << fillString(e.first, 36) << " | "
+              << fillString(formatDuration(std::llround(e.second->median)), 10)
+              << " | -          | removed  |" << std::endl;
+  }
+  std::cout << std::endl;
+  return num_regressions;
 }
@@ -1,24 +1,106 @@
 #pragma once
 
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "eval/evaluator.hpp"
 
 class Benchmark {
  public:
+  // Timing statistics of a benchmark case in microseconds per run.
+  struct Result {
+    std::string suite;
+    std::string name;
+    size_t runs = 0;
+    double median = 0;
+    double p95 = 0;
+    double mean = 0;
+    double min = 0;
+    double max = 0;
+  };
+
+  static const std::vector<std::string> SUITES;
+
+  static constexpr size_t DEFAULT_WARMUP = 1;
+  static constexpr size_t DEFAULT_REPETITIONS = 10;
+  static constexpr double DEFAULT_THRESHOLD = 10.0;  // percent
+
+  explicit Benchmark(size_t warmup = DEFAULT_WARMUP,
+                     size_t repetitions = DEFAULT_REPETITIONS);
+
   void smokeTest();
 
   void operations();
 
   void programs();
 
+  void optimizer();
+
   void findSlow(int64_t num_terms, Operation::Type type);
 
   void findSlowFormulas();
 
+  // Runs the given suites ("all" for all suites) and prints the results.
+  // The results are also written to json_path if it is not empty.
+  void runSuites(const std::vector<std::string>& suites,
+                 const std::string& json_path);
+
+  const std::vector<Result>& getResults() const { return results; }
+
+  // Compares two result files written by runSuites() and prints the
+  // differences. Returns the number of regressions, i.e. cases whose median
+  // increased by more than the threshold in percent.
+  static size_t compare(const std::string& base_path,
+                        const std::string& current_path, double threshold);
+
+  static void writeJson(const std::vector<Result>& results, size_t warmup,
+                        size_t repetitions, const std::string& path);
+
+  static std::vector<Result> readJson(const std::string& path);
+
+  // Computes the statistics of the given run times in microseconds.
+  static Result computeStats(std::vector<double> times);
+
+  // Runs the miner offline on a LODA home with fixture data derived from
+  // the test programs and reports its throughput. Stops after the given
+  // number of programs or seconds (zero means no limit).
+  void mine(const Settings& settings, int64_t num_programs,
+            int64_t num_seconds, uint64_t seed);
+
+  // Writes OEIS sequence data (stripped, names, offsets and optionally
+  // b-files) to a folder. The sequences are generated by evaluating the test
+  // programs. Additional copies with shifted terms and new IDs are added to
+  // increase the size. Optionally, programs for most sequences of the copies
+  // are written to the programs folder. Returns the number of written
+  // sequences.
+  static size_t writeSequenceFixture(const std::string& folder,
+                                     size_t num_terms, size_t num_copies,
+                                     bool with_bfiles = false,
+                                     bool with_programs = false);
+
  private:
   void program(size_t id, size_t num_terms);
 
   std::string programEval(const Program& p, eval_mode_t eval_mode,
                           size_t num_terms);
+
+  void measure(const std::string& suite, const std::string& name,
+               const std::function<void()>& f);
+
+  void suiteNumbers();
+
+  void suiteInterpreter();
+
+  void suiteMatcher();
+
+  void suiteSequences();
+
+  void suiteOptimizer();
+
+  void suiteFormula();
+
+  const size_t warmup;
+  const size_t repetitions;
+  std::vector<Result> results;
 };
@@ -1,9 +1,11 @@
 #include "cmd/commands.hpp"
 
 #include <algorithm>
+#include <cstdlib>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <sstream>
 
 #include "cmd/benchmark.hpp"
 #include "cmd/boinc.hpp"
@@ -12,17 +14,21 @@
 #include "eval/fold.hpp"
 #include "eval/minimizer.hpp"
 #include "eval/optimizer.hpp"
+#include "eval/profiler.hpp"
 #include "eval/range_generator.hpp"
+#include "form/formula_cache.hpp"
 #include "form/formula_gen.hpp"
 #include "form/formula_parser.hpp"
 #include "form/function.hpp"
 #include "form/lean.hpp"
+#include "form/native.hpp"
 #include "form/pari.hpp"
 #include "form/recursion.hpp"
 #include "gen/iterator.hpp"
 #include "lang/analyzer.hpp"
 #include "lang/comments.hpp"
 #include "lang/parser.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
 #include "lang/subprogram.hpp"
 #include "lang/virtual_seq.hpp"
@@ -35,6 +41,7 @@
 #include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/setup.hpp"
+#include "sys/thread_pool.hpp"
 #include "sys/util.hpp"
 
 void Commands::initLog(bool silent) {
@@ -75,7 +82,8 @@ void Commands::help() {
   std::cout << "  minimize  <program>  Minimize a program and print the result "
                "(see -t)"
             << std::endl;
-  std::cout << "  profile   <program>  Measure program evaluation time (see -t)"
+  std::cout << "  profile   <program>  Profile program evaluation per "
+               "operation (see -t)"
             << std::endl;
   std::cout << "  fold <program> <id>  Fold a subprogram given by ID into a "
                "seq-operation"
@@ -129,6 +137,12 @@ void Commands::help() {
   std::cout << "  -l <string>          Log level (values: "
                "debug,info,warn,error,alert)"
             << std::endl;
+  std::cout << "  -L <file>            Write log to a file (parallel mining: "
+               "one file per instance)"
+            << std::endl;
+  std::cout << "  -T <file>            Write trace events to a file (Chrome "
+               "trace format)"
+            << std::endl;
   std::cout
       << "  -i <string>          Name of miner configuration from miners.json"
       << std::endl;
@@ -229,6 +243,7 @@ void Commands::minimize(const std::string& path) {
   initLog(true);
   Program program = SequenceProgram::getProgramAndSeqId(path).first;
   Minimizer minimizer(settings);
+  minimizer.setNumThreads(ThreadPool::getDefaultNumThreads());
   minimizer.optimizeAndMinimize(program, settings.num_terms);
   ProgramUtil::print(program, std::cout);
 }
@@ -292,16 +307,27 @@ void Commands::export_(const std::string& path) {
 
 void Commands::profile(const std::string& path) {
   initLog(true);
-  Program program = SequenceProgram::getProgramAndSeqId(path).first;
+  auto program_and_id = SequenceProgram::getProgramAndSeqId(path);
+  const auto& program = program_and_id.first;
   Sequence res;
-  Evaluator evaluator(settings, EVAL_ALL, false);
-  auto start_time = std::chrono::steady_clock::now();
-  evaluator.eval(program, res);
-  auto cur_time = std::chrono::steady_clock::now();
-  auto micro_secs = std::chrono::duration_cast<std::chrono::microseconds>(
-                        cur_time - start_time)
-                        .count();
-  std::cout << formatDuration(micro_secs) << std::endl;
+  // only the regular interpreter supports profiling
+  Evaluator evaluator(settings, EVAL_REGULAR, false);
+  Profiler profiler;
+  profiler.getStats(program).id = program_and_id.second;
+  evaluator.getInterpreter().setProfiler(&profiler);
+  std::string error;
+  try {
+    evaluator.eval(program, res);
+  } catch (const std::exception& e) {
+    error = e.what();
+  }
+  evaluator.getInterpreter().setProfiler(nullptr);
+  profiler.print(std::cout);
+  if (!error.empty()) {
+    Log::get().error("Evaluation stopped after " +
+                         std::to_string(res.size()) + " terms: " + error,
+                     false);
+  }
 }
 
 void Commands::fold(const std::string& main_path, const std::string& sub_id) {
@@ -480,7 +506,7 @@ void Commands::addToList(const std::string& seq_id,
     return;
   }
   if (sequences.exists(seq.id)) {
-    seq.name = sequences.get(seq.id).name;
+    seq.name = sequences.getName(seq.id);
   }
   // Insert if not present
   if (list.find(seq.id) == list.end()) {
@@ -584,7 +610,7 @@ void Commands::testAnalyzer() {
 
 template <typename FormulaType>
 void testFormula(const std::string& test_id, const Settings& settings,
-                 bool as_vector) {
+                 bool as_vector, bool check_with_pari = false) {
   Parser parser;
   Interpreter interpreter(settings);
   Evaluator evaluator(settings, EVAL_ALL, false);
@@ -614,6 +640,7 @@ void testFormula(const std::string& test_id, const Settings& settings,
 
     // generate formula code
     FormulaGenerator generator;
+    generator.setCaching(true);
     Formula formula;
     FormulaType formula_obj;
     Sequence expSeq;
@@ -706,6 +733,16 @@ void testFormula(const std::string& test_id, const Settings& settings,
     } else {
       good++;
     }
+
+    // optionally use PARI/GP as a second opinion
+    PariFormula pari_formula;
+    Sequence pariSeq;
+    if (check_with_pari &&
+        PariFormula::convert(formula, offset, false, pari_formula) &&
+        pari_formula.eval(offset, numTerms, 60, pariSeq) && pariSeq != genSeq) {
+      Log::get().info("PARI/GP sequence: " + pariSeq.to_string());
+      Log::get().error("Unexpected PARI/GP sequence", true);
+    }
   }
   Log::get().info(std::to_string(good) + " passed, " + std::to_string(bad) +
                   " failed, " + std::to_string(skipped) + " skipped " +
@@ -718,6 +755,13 @@ void Commands::testPari(const std::string& test_id) {
   testFormula<PariFormula>(test_id, settings, as_vector);
 }
 
+void Commands::testNative(const std::string& test_id) {
+  initLog(false);
+  const bool check_with_pari =
+      std::getenv("LODA_TEST_WITH_EXTERNAL_TOOLS") != nullptr;
+  testFormula<NativeFormula>(test_id, settings, false, check_with_pari);
+}
+
 void Commands::testLean(const std::string& test_id) {
   initLog(false);
   testFormula<LeanFormula>(test_id, settings, false);
@@ -994,6 +1038,7 @@ void Commands::maintain(const std::string& ids) {
   initLog(false);
   MineManager manager(settings);
   manager.load();
+  manager.getMinimizer().setNumThreads(ThreadPool::getDefaultNumThreads());
   size_t start = 0;
   size_t end = manager.getTotalCount() + 1;
   bool eval = false;
@@ -1030,10 +1075,58 @@ void Commands::iterate(const std::string& count) {
   }
 }
 
-void Commands::benchmark() {
-  initLog(true);
-  Benchmark benchmark;
-  benchmark.smokeTest();
+void Commands::benchmark(const std::vector<std::string>& args) {
+  if (args.empty()) {
+    initLog(true);
+    Benchmark benchmark;
+    benchmark.smokeTest();
+    return;
+  }
+  initLog(false);
+  const auto& mode = args[0];
+  if (mode == "run") {
+    // run <suites> [json-file] [repetitions] [warmup]
+    std::vector<std::string> suites;
+    std::stringstream ss(args.size() > 1 ? args[1] : "all");
+    std::string suite;
+    while (std::getline(ss, suite, ',')) {
+      suites.push_back(suite);
+    }
+    const std::string json_path = args.size() > 2 ? args[2] : "";
+    const size_t repetitions = args.size() > 3
+                                   ? std::stoul(args[3])
+                                   : Benchmark::DEFAULT_REPETITIONS;
+    const size_t warmup =
+        args.size() > 4 ? std::stoul(args[4]) : Benchmark::DEFAULT_WARMUP;
+    Benchmark benchmark(warmup, repetitions);
+    benchmark.runSuites(suites, json_path);
+  } else if (mode == "mine") {
+    // mine [num-programs] [seconds] [seed]
+    const int64_t num_programs = args.size() > 1 ? std::stoll(args[1]) : 2000;
+    const int64_t num_seconds = args.size() > 2 ? std::stoll(args[2]) : 0;
+    const uint64_t seed = args.size() > 3 ? std::stoull(args[3]) : 42;
+    Benchmark benchmark;
+    benchmark.mine(settings, num_programs, num_seconds, seed);
+  } else if (mode == "compare") {
+    // compare <base-json> <current-json> [threshold-percent]
+    if (args.size() < 3) {
+      Log::get().error(
+          "Usage: loda benchmark compare <base.json> <current.json> "
+          "[threshold]",
+          true);
+    }
+    const double threshold =
+        args.size() > 3 ? std::stod(args[3]) : Benchmark::DEFAULT_THRESHOLD;
+    auto num_regressions = Benchmark::compare(args[1], args[2], threshold);
+    if (num_regressions > 0) {
+      Log::get().error("Found " + std::to_string(num_regressions) +
+                           " benchmark regressions",
+                       true);
+    }
+    Log::get().info("No benchmark regressions found");
+  } else {
+    Log::get().error("Unknown benchmark mode: " + mode, true);
+  }
 }
 
 void Commands::findSlow(int64_t num_terms, const std::string& type) {
@@ -1090,13 +1183,13 @@ void Commands::extractVirseqs() {
   auto& stats = manager.getStats();
   int64_t numExtracted = 0;
 
-  for (const auto& seq : manager.getSequences()) {
-    if (!stats.all_program_ids.exists(seq.id)) {
+  for (const auto& it : manager.getSequences()) {
+    if (!stats.all_program_ids.exists(it.id)) {
       continue;
     }
     Program program;
     try {
-      program = parser.parse(ProgramUtil::getProgramPath(seq.id));
+      program = parser.parse(ProgramUtil::getProgramPath(it.id));
     } catch (const std::exception& e) {
       Log::get().warn(std::string(e.what()));
       continue;
@@ -1108,6 +1201,8 @@ void Commands::extractVirseqs() {
       continue;
     }
 
+    // look up the sequence including its name
+    const auto seq = manager.getSequences().get(it.id);
     for (size_t i = 0; i < virseqs.size(); i++) {
       const auto& vs = virseqs[i];
 
@@ -1234,13 +1329,7 @@ void Commands::findIncevalPrograms(const std::string& error_code) {
     if (!success && error_code_value >= min_error_code &&
         error_code_value <= max_error_code) {
       // Get the sequence name
-      std::string seq_name;
-      try {
-        auto seq = sequences.get(id);
-        seq_name = seq.name;
-      } catch (...) {
-        seq_name = "";
-      }
+      std::string seq_name = sequences.getName(id);
 
       // Store result for later sorting
       results.push_back({id, error_code_value, seq_name, program.ops.size()});
@@ -1285,7 +1374,6 @@ void Commands::compare(const std::string& path1, const std::string& path2) {
 
 void Commands::exportFormulas(const std::string& output_file) {
   initLog(true);
-  Parser parser;
   MineManager manager(settings);
   manager.load();
   auto& stats = manager.getStats();
@@ -1298,19 +1386,69 @@ void Commands::exportFormulas(const std::string& output_file) {
     }
     out = &file_out;
   }
-  for (auto id : stats.all_program_ids) {
-    try {
-      Program program = parser.parse(ProgramUtil::getProgramPath(id));
-      std::string formula =
-          Comments::getCommentField(program, Comments::PREFIX_FORMULA);
-
-      if (!formula.empty()) {
-        *out << id.string() << ": " << formula << std::endl;
+  // process programs in parallel and write the formulas in order. Only a
+  // limited number of chunks is kept in memory at the same time. If
+  // dependencies are requested, formulas are generated instead of using the
+  // formula comments.
+  static constexpr size_t CHUNK_SIZE = 100;  // magic number
+  const std::vector<UID> ids(stats.all_program_ids.begin(),
+                             stats.all_program_ids.end());
+  const bool generate = settings.with_deps;
+  auto corpus = ProgramCorpus::getDefault();
+  ThreadPool pool(ThreadPool::getDefaultNumThreads());
+  const size_t num_chunks = (ids.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  const size_t batch_size = 4 * pool.size();  // magic number
+  for (size_t batch = 0; batch < num_chunks; batch += batch_size) {
+    const size_t batch_end = std::min(num_chunks, batch + batch_size);
+    std::vector<std::vector<std::string>> chunks(batch_end - batch);
+    for (size_t c = batch; c < batch_end; c++) {
+      pool.submit([&, c]() {
+        Parser parser;
+        FormulaGenerator generator;
+        generator.setCaching(true);
+        Program program;
+        auto& chunk = chunks[c - batch];
+        const size_t end = std::min(ids.size(), (c + 1) * CHUNK_SIZE);
+        for (size_t i = c * CHUNK_SIZE; i < end; i++) {
+          const auto id = ids[i];
+          try {
+            if (!corpus || !corpus->getProgram(id, program)) {
+              program = parser.parse(ProgramUtil::getProgramPath(id));
+            }
+            std::string formula;
+            if (generate) {
+              Formula f;
+              if (generator.generate(program, id.number(), f, true)) {
+                formula = f.toString();
+              }
+            } else {
+              formula = Comments::getCommentField(program,
+                                                  Comments::PREFIX_FORMULA);
+            }
+            if (!formula.empty()) {
+              chunk.push_back(id.string() + ": " + formula);
+            }
+          } catch (const std::exception& e) {
+            Log::get().warn("Error processing " + id.string() + ": " +
+                            std::string(e.what()));
+          }
+        }
+      });
+    }
+    pool.wait();
+    for (const auto& chunk : chunks) {
+      for (const auto& line : chunk) {
+        *out << line << "\n";
       }
-    } catch (const std::exception& e) {
-      Log::get().warn("Error processing " + id.string() + ": " +
-                      std::string(e.what()));
     }
+    out->flush();
+  }
+  if (generate) {
+    Log::get().info("Formula cache: " +
+                    std::to_string(FormulaCache::get().getNumHits()) +
+                    " hits, " +
+                    std::to_string(FormulaCache::get().getNumMisses()) +
+                    " misses");
   }
   if (file_out.is_open()) {
     file_out.close();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "eval/evaluator.hpp"
 #include "sys/util.hpp"
@@ -63,6 +64,8 @@ class Commands {
 
   void testLean(const std::string& id);
 
+  void testNative(const std::string& id);
+
   void testFormulaParser(const std::string& id);
 
   void testRange(const std::string& id);
@@ -77,7 +80,7 @@ class Commands {
 
   void iterate(const std::string& count);
 
-  void benchmark();
+  void benchmark(const std::vector<std::string>& args);
 
   void findSlow(int64_t num_terms, const std::string& type);
 
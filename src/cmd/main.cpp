@@ -1,6 +1,7 @@
+#include <algorithm>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <thread>
 
 #include "cmd/commands.hpp"
 #include "mine/api_client.hpp"
@@ -14,10 +15,15 @@
 
 int dispatch(Settings settings, const std::vector<std::string>& args);
 
-HANDLE fork(Settings settings, std::vector<std::string> args) {
+HANDLE fork(Settings settings, std::vector<std::string> args,
+            const std::string& log_file) {
 #ifdef _WIN64
   std::string cmd = "loda.exe";
   settings.printArgs(args);
+  if (!log_file.empty()) {
+    args.push_back("-L");
+    args.push_back(log_file);
+  }
   for (auto& a : args) {
     cmd += " " + a;
   }
@@ -28,7 +34,11 @@ HANDLE fork(Settings settings, std::vector<std::string> args) {
     Log::get().error("Error forking process", true);
   } else if (child_pid == 0) {
     // execute child process
-    dispatch(settings, args);
+    if (!log_file.empty()) {
+      Log::get().setFile(log_file);
+    }
+    // do not return to the supervisor loop of the parent process
+    std::exit(dispatch(settings, args));
   } else {
     // return child's process ID to the parent
     // Log::get().info("Started child process " + std::to_string(child_pid));
@@ -38,6 +48,20 @@ HANDLE fork(Settings settings, std::vector<std::string> args) {
 #endif
 }
 
+// Inserts the instance number before the file extension of the log file.
+std::string getInstanceLogFile(const std::string& log_file, size_t instance) {
+  if (log_file.empty()) {
+    return log_file;
+  }
+  auto ext = log_file.find_last_of('.');
+  const auto sep = log_file.find_last_of("/\\");
+  if (ext == std::string::npos || (sep != std::string::npos && ext < sep)) {
+    ext = log_file.size();
+  }
+  return log_file.substr(0, ext) + "_" + std::to_string(instance) +
+         log_file.substr(ext);
+}
+
 void mineParallel(const Settings& settings,
                   const std::vector<std::string>& args) {
   // get relevant settings
@@ -53,38 +77,96 @@ void mineParallel(const Settings& settings,
   instance_settings.parallel_mining = false;
   instance_settings.report_cpu_hours = false;
 
+  // delay between starts of miner processes in seconds
+  const int64_t start_delay =
+      std::max<int64_t>(Setup::getSetupInt("LODA_MINER_START_DELAY", 1), 0);
+
+  // instances that exit quickly are restarted with exponential backoff
+  const int64_t min_runtime = 60;         // seconds; magic number
+  const int64_t min_restart_delay = 15;   // seconds; magic number
+  const int64_t max_restart_delay = 960;  // seconds; magic number
+
   // runtime objects for parallel mining
   std::vector<HANDLE> children_pids(num_instances, 0);
+  std::vector<bool> started(num_instances, false);
+  const auto log_file = Log::get().getFile();
   AdaptiveScheduler cpuhours_scheduler(3600);  // 1 hour (fixed!!)
   ApiClient api_client;
 
   Log::get().info("Starting parallel mining using " +
                   std::to_string(num_instances) + " instances");
   const auto start_time = std::chrono::steady_clock::now();
+  auto next_start = start_time;
+  size_t next_index = 0;  // round-robin, so that restarts do not starve others
+  std::vector<std::chrono::steady_clock::time_point> start_times(
+      num_instances, start_time);
+  std::vector<std::chrono::steady_clock::time_point> restart_times(
+      num_instances, start_time);
+  std::vector<int64_t> restart_delays(num_instances, 0);
 
   // run miner processes and monitor them
-  bool finished = false;
-  while (!finished) {
-    // check if miner processes are alive, restart them if should not stop
-    finished = true;
-    for (size_t i = 0; i < children_pids.size(); i++) {
-      const auto pid = children_pids[i];
-      if (pid != 0 && isChildProcessAlive(pid)) {
-        // still alive
-        finished = false;
-      } else if (pid == 0 || restart_miners) {
-        // restart process
+  while (true) {
+    // start miner processes, restart them if they should not stop
+    auto now = std::chrono::steady_clock::now();
+    bool running = false, pending = false;
+    auto wakeup = std::chrono::steady_clock::time_point::max();
+    for (size_t k = 0; k < children_pids.size(); k++) {
+      const size_t i = (next_index + k) % children_pids.size();
+      if (children_pids[i] != 0) {
+        running = true;
+      } else if (!started[i] || restart_miners) {
+        if (now < next_start || now < restart_times[i]) {
+          pending = true;  // staggered start or restart backoff
+          wakeup = std::min(wakeup, std::max(next_start, restart_times[i]));
+          continue;
+        }
         if (has_miner_profile) {
           instance_settings.miner_profile = std::to_string(i);
         }
-        children_pids[i] = fork(instance_settings, args);
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-        finished = false;
+        children_pids[i] =
+            fork(instance_settings, args, getInstanceLogFile(log_file, i));
+        started[i] = true;
+        start_times[i] = now;
+        next_index = (i + 1) % children_pids.size();
+        running = true;
+        next_start = now + std::chrono::seconds(start_delay);
       }
     }
+    if (!running && !pending) {
+      break;
+    }
 
-    // wait some time
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+    // wait until a miner process terminates, the next process should be
+    // started or the regular tasks are due
+    int64_t timeout = 60000;  // magic number
+    if (pending) {
+      timeout = std::min<int64_t>(
+          timeout,
+          std::chrono::duration_cast<std::chrono::milliseconds>(wakeup - now)
+              .count());
+    }
+    int exit_code = 0;
+    const auto index =
+        waitForChildProcesses(children_pids, timeout, exit_code);
+    if (index >= 0) {
+      children_pids[index] = 0;
+      Log::get().info("Miner instance " + std::to_string(index) +
+                      " exited with code " + std::to_string(exit_code));
+      const auto exit_time = std::chrono::steady_clock::now();
+      auto& delay = restart_delays[index];
+      if (exit_time - start_times[index] < std::chrono::seconds(min_runtime)) {
+        delay = delay == 0 ? min_restart_delay
+                           : std::min(2 * delay, max_restart_delay);
+        if (restart_miners) {
+          Log::get().warn("Miner instance " + std::to_string(index) +
+                          " exited quickly; restarting in " +
+                          std::to_string(delay) + " seconds");
+        }
+      } else {
+        delay = 0;
+      }
+      restart_times[index] = exit_time + std::chrono::seconds(delay);
+    }
 
     // report CPU hours
     if (cpuhours_scheduler.isTargetReached()) {
@@ -234,6 +316,12 @@ int dispatch(Settings settings, const std::vector<std::string>& args) {
       id = args.at(1);
     }
     commands.testLean(id);
+  } else if (cmd == "test-native") {
+    std::string id;
+    if (args.size() > 1) {
+      id = args.at(1);
+    }
+    commands.testNative(id);
   } else if (cmd == "test-formula-parser") {
     std::string id;
     if (args.size() > 1) {
@@ -265,7 +353,8 @@ int dispatch(Settings settings, const std::vector<std::string>& args) {
   } else if (cmd == "iterate") {
     commands.iterate(args.at(1));
   } else if (cmd == "benchmark") {
-    commands.benchmark();
+    commands.benchmark(
+        std::vector<std::string>(args.begin() + 1, args.end()));
   } else if (cmd == "find-slow") {
     std::string type;
     if (args.size() > 1) {
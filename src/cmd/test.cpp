@@ -1,22 +1,39 @@
 #include "cmd/test.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
 #include <cstdlib>
 #include <deque>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <set>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
 
+#include "cmd/benchmark.hpp"
+#include "eval/cost_model.hpp"
 #include "eval/evaluator.hpp"
 #include "eval/fold.hpp"
 #include "eval/interpreter.hpp"
 #include "eval/minimizer.hpp"
 #include "eval/optimizer.hpp"
+#include "eval/profiler.hpp"
+#include "eval/range_cache.hpp"
 #include "eval/range_generator.hpp"
+#include "eval/result_cache.hpp"
 #include "eval/semantics.hpp"
+#include "form/expression_pool.hpp"
+#include "form/formula_cache.hpp"
 #include "form/formula_gen.hpp"
 #include "form/formula_parser.hpp"
 #include "form/lean.hpp"
+#include "form/native.hpp"
 #include "form/pari.hpp"
 #include "gen/blocks.hpp"
 #include "gen/generator_v1.hpp"
@@ -24,22 +41,34 @@
 #include "lang/comments.hpp"
 #include "lang/constants.hpp"
 #include "lang/parser.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
 #include "lang/subprogram.hpp"
 #include "lang/virtual_seq.hpp"
 #include "math/big_number.hpp"
 #include "mine/api_client.hpp"
 #include "mine/config.hpp"
+#include "mine/finder.hpp"
 #include "mine/matcher.hpp"
 #include "mine/mine_manager.hpp"
 #include "mine/miner.hpp"
+#include "mine/stage_timer.hpp"
 #include "mine/stats.hpp"
+#include "mine/submission_queue.hpp"
 #include "seq/seq_list.hpp"
+#include "seq/seq_loader.hpp"
+#include "seq/seq_util.hpp"
 #include "sys/file.hpp"
 #include "sys/git.hpp"
 #include "sys/gzip.hpp"
+#include "sys/jute.h"
 #include "sys/log.hpp"
+#include "sys/memory_budget.hpp"
+#include "sys/process.hpp"
+#include "sys/publisher.hpp"
 #include "sys/setup.hpp"
+#include "sys/tool_worker.hpp"
+#include "sys/trace.hpp"
 
 Test::Test() {
   settings.max_memory = 100000;  // for ackermann
@@ -60,9 +89,11 @@ void Test::all() {
 void Test::fast() {
   uid();
   sequence();
+  sequenceIndex();
   memory();
   operationMetadata();
   programUtil();
+  programCorpus();
   semantics();
   config();
   steps();
@@ -74,12 +105,31 @@ void Test::fast() {
   linearMatcher();
   deltaMatcher();
   digitMatcher();
+  directMatcherRange();
+  rangePrefilter();
   optimizer();
+  resultCache();
   checkpoint();
+  statsUpdate();
   knownPrograms();
   formula();
+  nativeFormula();
+  expressionPool();
+  formulaCache();
   range();
+  rangeCache();
+  costModel();
+  benchmarkResults();
+  stageTimer();
+  trace();
+  profiler();
+  memoryBudget();
+  submissionQueue();
+  publisher();
+  logFile();
   gzip();
+  toolWorker();
+  childProcesses();
 }
 
 void Test::slow() {
@@ -433,6 +483,86 @@ void Test::sequence() {
   }
 }
 
+void Test::sequenceIndex() {
+  Log::get().info("Testing sequence index");
+  const std::string folder = getTmpDir() + "loda_seq_index" + FILE_SEP;
+  ensureDir(folder);
+  std::ofstream stripped(folder + "stripped");
+  stripped << "# OEIS stripped" << std::endl;
+  stripped << "A000004 ,0,0,0,0,0,0,0,0,0,0," << std::endl;
+  stripped << "A000027 ,1,2,3,4,5,6,7,8,9,10," << std::endl;
+  stripped << "A000030 ,1,2," << std::endl;
+  stripped << "A000045 ,0,1,1,2,3,5,8,13,21,34,55," << std::endl;
+  stripped.close();
+  std::ofstream names(folder + "names");
+  names << "# OEIS names" << std::endl;
+  names << "A000004 The zero sequence." << std::endl;
+  names << "A000027 The positive integers." << std::endl;
+  names << "A000030 Initial digit of n." << std::endl;
+  names << "A000045 Fibonacci numbers." << std::endl;
+  names.close();
+  std::ofstream offsets(folder + "offsets");
+  offsets << "A000027: 1" << std::endl;
+  offsets.close();
+
+  SequenceIndex index;
+  SequenceLoader loader(index, 8);
+  loader.load(folder, 'A');
+  loader.checkConsistency();
+  if (index.size() != 3 || index.exists(UID('A', 30)) ||
+      !index.exists(UID('A', 45))) {
+    Log::get().error("Unexpected sequences in index", true);
+  }
+  if (index.getName(UID('A', 27)) != "The positive integers." ||
+      index.getName(UID('A', 45)) != "Fibonacci numbers.") {
+    Log::get().error("Unexpected sequence names in index", true);
+  }
+  if (index.getOffset(UID('A', 27)) != 1 ||
+      index.get(UID('A', 27)).offset != 1) {
+    Log::get().error("Unexpected sequence offset in index", true);
+  }
+  if (index.getTerms(UID('A', 45)).to_string() !=
+      "0,1,1,2,3,5,8,13,21,34,55") {
+    Log::get().error("Unexpected sequence terms in index", true);
+  }
+  if (index.get(UID('A', 45)).string() != "A000045: Fibonacci numbers.") {
+    Log::get().error("Unexpected managed sequence in index", true);
+  }
+  std::vector<UID> ids;
+  std::vector<std::string> seq_names;
+  for (const auto& s : index) {
+    ids.push_back(s.id);
+    seq_names.push_back(s.name);
+  }
+  if (ids != std::vector<UID>({UID('A', 4), UID('A', 27), UID('A', 45)})) {
+    Log::get().error("Unexpected sequence index iteration", true);
+  }
+  if (seq_names != std::vector<std::string>({"The zero sequence.",
+                                             "The positive integers.",
+                                             "Fibonacci numbers."})) {
+    Log::get().error("Unexpected sequence names in iteration", true);
+  }
+  // b-file terms are cached and accounted in the memory budget
+  auto& budget = MemoryBudget::get();
+  const auto& bfiles = budget.getAccount(MemoryBudget::Subsystem::BFILES);
+  const int64_t base = bfiles.getUsage();
+  index.add(UID('U', 1), Sequence({1, 2, 3}));
+  index.add(UID('U', 2), Sequence({4, 5, 6}));
+  if (index.get(UID('U', 1), false).getTerms(10).to_string() != "1,2,3" ||
+      index.numCachedBFiles() != 1 || bfiles.getUsage() <= base) {
+    Log::get().error("Unexpected cached b-file in index", true);
+  }
+  // the cache is cleared at the memory limit
+  const int64_t gb = 1024 * 1024 * 1024;
+  budget.update(990 * gb, 1000 * gb);
+  if (index.get(UID('U', 2), false).getTerms(10).to_string() != "4,5,6" ||
+      index.numCachedBFiles() != 0 || bfiles.getUsage() != base) {
+    Log::get().error("Unexpected b-file cache after shrinking", true);
+  }
+  budget.update(0, 1000 * gb);
+  rmDirRecursive(folder);
+}
+
 void checkMemory(const Memory& mem, int64_t index, const Number& value) {
   if (mem.get(index) != value) {
     Log::get().error("Unexpected memory value at index " +
@@ -708,6 +838,42 @@ void Test::programUtil() {
   }
 }
 
+void Test::programCorpus() {
+  Log::get().info("Testing program corpus");
+  const std::string path = getTmpDir() + "programs_test.bin";
+  const std::vector<UID> ids = {UID('A', 5), UID('A', 45), UID('A', 99999),
+                                UID('A', 168380)};
+  ProgramCorpus::build(path, ids, "test");
+  ProgramCorpus corpus;
+  if (!corpus.load(path) || corpus.size() != 3 ||
+      corpus.getCommit() != "test") {
+    Log::get().error("Unexpected program corpus", true);
+  }
+  Parser parser;
+  Program p;
+  for (auto id : ids) {
+    const auto path = ProgramUtil::getProgramPath(id);
+    if (!isFile(path)) {
+      if (corpus.exists(id)) {
+        Log::get().error("Unexpected program in corpus: " + id.string(), true);
+      }
+      continue;
+    }
+    if (!corpus.getProgram(id, p)) {
+      Log::get().error("Missing program in corpus: " + id.string(), true);
+    }
+    const auto parsed = parser.parse(path);
+    std::stringstream expected, got;
+    ProgramUtil::print(parsed, expected);
+    ProgramUtil::print(p, got);
+    if (expected.str() != got.str() ||
+        ProgramUtil::getOffset(p) != ProgramUtil::getOffset(parsed)) {
+      Log::get().error("Unexpected program in corpus: " + id.string(), true);
+    }
+  }
+  std::remove(path.c_str());
+}
+
 void validateIterated(const Program& p) {
   ProgramUtil::validate(p);
   if (ProgramUtil::numOps(p, Operand::Type::INDIRECT) > 0) {
@@ -1209,6 +1375,7 @@ void Test::config() {
   check_int("matchers[0].backoff", 1, config.matchers[0].backoff);
   check_str("matchers[1].type", "linear1", config.matchers[1].type);
   check_int("matchers[1].backoff", 1, config.matchers[1].backoff);
+  check_int("prefilter", 0, config.prefilter);
 
   settings.miner_profile = "update";
   config = ConfigLoader::load(settings);
@@ -1223,6 +1390,7 @@ void Test::config() {
   check_int("matchers[0].backoff", 0, config.matchers[0].backoff);
   check_str("matchers[1].type", "delta", config.matchers[1].type);
   check_int("matchers[1].backoff", 0, config.matchers[1].backoff);
+  check_int("prefilter", 1, config.prefilter);
 
   // test selecting miner configx using index instead of name
   settings.miner_profile = "0";
@@ -1253,6 +1421,136 @@ void Test::formula() {
   checkFormulas("lean.txt", FormulaType::LEAN);
 }
 
+void Test::nativeFormula() {
+  const std::string path = std::string("tests") + FILE_SEP +
+                           std::string("formula") + FILE_SEP + "formula.txt";
+  std::map<UID, std::string> map;
+  SequenceList::loadMapWithComments(path, map);
+  Parser parser;
+  FormulaGenerator generator;
+  Evaluator evaluator(settings, EVAL_ALL, false);
+  size_t num_checked = 0;
+  for (const auto& e : map) {
+    auto id = e.first;
+    auto program = parser.parse(ProgramUtil::getProgramPath(id));
+    auto offset = ProgramUtil::getOffset(program);
+    Formula formula;
+    NativeFormula native;
+    if (!generator.generate(program, id.number(), formula, true) ||
+        !NativeFormula::convert(formula, offset, false, native)) {
+      continue;
+    }
+    Log::get().info("Testing native evaluation of " + id.string() + ": " +
+                    native.toString());
+    Sequence expSeq, genSeq;
+    const size_t numTerms = 10;
+    evaluator.eval(program, expSeq, numTerms);
+    if (!native.eval(offset, numTerms, 10, genSeq)) {
+      Log::get().error("Native evaluation timeout for " + id.string(), true);
+    }
+    if (genSeq != expSeq) {
+      Log::get().info("Generated sequence: " + genSeq.to_string());
+      Log::get().info("Expected sequence:  " + expSeq.to_string());
+      Log::get().error("Unexpected native sequence for " + id.string(), true);
+    }
+    num_checked++;
+  }
+  if (num_checked < map.size() / 2) {
+    Log::get().error("Too few native formula checks: " +
+                         std::to_string(num_checked),
+                     true);
+  }
+}
+
+void Test::expressionPool() {
+  const std::string path = std::string("tests") + FILE_SEP +
+                           std::string("formula") + FILE_SEP + "formula.txt";
+  std::map<UID, std::string> map;
+  SequenceList::loadMapWithComments(path, map);
+  Log::get().info("Testing expression pool");
+  ExpressionPool pool;
+  FormulaParser parser;
+  std::map<Expression, ExpressionPool::Id> ids;
+  for (const auto& e : map) {
+    Formula formula;
+    if (!parser.parse(e.second, formula)) {
+      Log::get().error("Cannot parse formula: " + e.second, true);
+    }
+    for (const auto& entry : formula.entries) {
+      for (const auto& expr : {entry.first, entry.second}) {
+        auto id = pool.intern(expr);
+        if (pool.get(id) != expr || pool.numTerms(id) != expr.numTerms()) {
+          Log::get().error("Unexpected pooled expression: " + expr.toString(),
+                           true);
+        }
+        // structurally equal expressions must have the same id
+        auto it = ids.find(expr);
+        if (it != ids.end() && it->second != id) {
+          Log::get().error("Duplicate pooled expression: " + expr.toString(),
+                           true);
+        }
+        ids[expr] = id;
+      }
+    }
+  }
+  // re-interning must not add nodes
+  const auto size = pool.size();
+  if (pool.intern(pool.get(0)) != 0 || pool.size() != size ||
+      ids.size() > size) {
+    Log::get().error("Unexpected expression pool size", true);
+  }
+}
+
+void Test::formulaCache() {
+  const std::string path = std::string("tests") + FILE_SEP +
+                           std::string("formula") + FILE_SEP + "formula.txt";
+  std::map<UID, std::string> map;
+  SequenceList::loadMapWithComments(path, map);
+  Log::get().info("Testing formula cache");
+  auto& cache = FormulaCache::get();
+  cache.clear();
+  const auto hits = cache.getNumHits();
+  Parser parser;
+  FormulaGenerator generator;
+  generator.setCaching(true);
+  for (size_t round = 0; round < 2; round++) {
+    for (const auto& e : map) {
+      auto p = parser.parse(ProgramUtil::getProgramPath(e.first));
+      Formula f;
+      if (!generator.generate(p, e.first.number(), f, true) ||
+          f.toString() != e.second) {
+        Log::get().error("Unexpected cached formula for " + e.first.string() +
+                             ": " + f.toString(),
+                         true);
+      }
+    }
+  }
+  if (cache.size() == 0 || cache.getNumHits() == hits) {
+    Log::get().error("Formula cache not used", true);
+  }
+  // dependencies reached at different name indices share cache entries
+  cache.clear();
+  const auto misses = cache.getNumMisses();
+  FormulaGenerator uncached;
+  for (const std::string cell : {"1", "5"}) {
+    std::stringstream buf("mov $" + cell + ",$0\nseq $" + cell +
+                          ",45\nmov $0,$" + cell + "\n");
+    const auto p = parser.parse(buf);
+    Formula f, g;
+    if (!generator.generate(p, 0, f, true) ||
+        !uncached.generate(p, 0, g, true) || f.toString() != g.toString()) {
+      Log::get().error("Unexpected cached formula: " + f.toString(), true);
+    }
+  }
+  check_int("formula cache size", 1, cache.size());
+  check_int("formula cache misses", 1, cache.getNumMisses() - misses);
+  // the cache is bounded
+  cache.setMaxEntries(0);
+  check_int("formula cache size", 0, cache.size());
+  cache.setMaxEntries(FormulaCache::DEFAULT_MAX_ENTRIES);
+  cache.clear();
+}
+
 void Test::checkFormulas(const std::string& testFile, FormulaType type) {
   std::string path = std::string("tests") + FILE_SEP + std::string("formula") +
                      FILE_SEP + testFile;
@@ -1380,6 +1678,474 @@ void Test::testRanges(const std::string& filename, bool finite) {
   }
 }
 
+void Test::benchmarkResults() {
+  Log::get().info("Testing benchmark results");
+  auto stats = Benchmark::computeStats({5, 1, 4, 2, 3, 100});
+  check_int("runs", 6, stats.runs);
+  check_int("median", 3500, std::llround(1000 * stats.median));
+  check_int("p95", 100, std::llround(stats.p95));
+  check_int("min", 1, std::llround(stats.min));
+  auto base = stats;
+  base.suite = "numbers";
+  base.name = "add/small";
+  auto current = base;
+  current.median = base.median * 1.5;
+  const std::string base_path = getTmpDir() + "loda_benchmark_base.json";
+  const std::string current_path = getTmpDir() + "loda_benchmark_current.json";
+  Benchmark::writeJson({base}, 1, 6, base_path);
+  Benchmark::writeJson({current}, 1, 6, current_path);
+  auto loaded = Benchmark::readJson(current_path);
+  check_int("loaded", 1, loaded.size());
+  check_str("loaded.name", "add/small", loaded[0].name);
+  check_int("loaded.median", 5250, std::llround(1000 * loaded[0].median));
+  check_int("regressions", 1,
+            Benchmark::compare(base_path, current_path, 10.0));
+  check_int("regressions", 0,
+            Benchmark::compare(base_path, current_path, 60.0));
+  check_int("regressions", 0,
+            Benchmark::compare(current_path, base_path, 10.0));
+  std::remove(base_path.c_str());
+  std::remove(current_path.c_str());
+}
+
+void Test::costModel() {
+  Log::get().info("Testing cost model");
+  double saved = 0;
+  // quadratic growth: a(n) = 100*n^2
+  CostModel poly;
+  poly.reset(false);
+  for (size_t n = 1; n <= 4; n++) {
+    poly.add(100 * n * n);
+  }
+  check_int("poly.project", 10000, std::llround(poly.project(9)));
+  if (poly.shouldAbort(10, 100000, 0, -1, saved)) {
+    Log::get().error("Unexpected abort of polynomial cost model", true);
+  }
+  if (!poly.shouldAbort(10, 4000, 0, -1, saved)) {
+    Log::get().error("Expected abort of polynomial cost model", true);
+  }
+  // exponential growth: a(n) = 100*2^n
+  CostModel exp;
+  exp.reset(true);
+  for (size_t n = 0; n < 4; n++) {
+    exp.add(100 << n);
+  }
+  check_int("exp.project", 102400, std::llround(exp.project(10)));
+  if (!exp.shouldAbort(20, 100000, 0, -1, saved)) {
+    Log::get().error("Expected abort of exponential cost model", true);
+  }
+  // no projection for non-increasing steps
+  CostModel flat;
+  flat.reset(false);
+  for (size_t n = 0; n < 8; n++) {
+    flat.add(1000);
+  }
+  if (flat.project(10) >= 0 || flat.shouldAbort(20, 1, 1, 1, saved)) {
+    Log::get().error("Unexpected projection of flat cost model", true);
+  }
+}
+
+void Test::stageTimer() {
+  Log::get().info("Testing stage timer");
+  StageTimer::collect();
+  // record durations in the main thread and in a worker thread
+  for (int64_t micros : {0, 5, 100, 3000}) {
+    StageTimer::add(StageTimer::Stage::EVALUATE, micros);
+  }
+  std::thread worker([]() {
+    StageTimer::add(StageTimer::Stage::EVALUATE, 7);
+    StageTimer::Span span(StageTimer::Stage::CHECK);
+  });
+  worker.join();
+  auto h = StageTimer::collect();
+  const auto& eval = h[static_cast<size_t>(StageTimer::Stage::EVALUATE)];
+  check_int("eval.count", 5, eval.count);
+  check_int("eval.total", 3112, eval.total);
+  check_int("eval.max", 3000, eval.max);
+  check_int("eval.p50", 8, eval.quantile(0.5));
+  check_int("eval.p100", 3000, eval.quantile(1.0));
+  check_int("check.count", 1,
+            h[static_cast<size_t>(StageTimer::Stage::CHECK)].count);
+  check_int("generate.count", 0,
+            h[static_cast<size_t>(StageTimer::Stage::GENERATE)].count);
+  if (StageTimer::summarize(h).rfind("evaluate ", 0) != 0) {
+    Log::get().error("Unexpected stage summary", true);
+  }
+  // the aggregates are reset after collecting them
+  h = StageTimer::collect();
+  check_int("eval.count", 0,
+            h[static_cast<size_t>(StageTimer::Stage::EVALUATE)].count);
+}
+
+void Test::trace() {
+  Log::get().info("Testing trace");
+  {
+    Trace::Span span("test", "disabled");
+    if (span) {
+      Log::get().error("Unexpected active trace span", true);
+    }
+  }
+  const std::string path = getTmpDir() + "loda_trace.json";
+  Trace::start(path);
+  {
+    Trace::Span span("test", "outer");
+    span.setArg("A000045");
+    std::thread worker([]() { Trace::Span span("test", "inner"); });
+    worker.join();
+  }
+  Trace::stop();
+  {
+    Trace::Span span("test", "stopped");
+  }
+  auto json = jute::parser::parse(getFileAsString(path));
+  auto events = json["traceEvents"];
+  check_int("events", 2, events.size());
+  std::set<std::string> names;
+  for (int i = 0; i < events.size(); i++) {
+    names.insert(events[i]["name"].as_string());
+    check_str("ph", "X", events[i]["ph"].as_string());
+  }
+  check_int("outer", 1, names.count("outer"));
+  check_int("inner", 1, names.count("inner"));
+  check_str("arg", "A000045", events[0]["args"]["arg"].as_string());
+  check_int("tid", 1,
+            events[0]["tid"].as_int() != events[1]["tid"].as_int());
+  std::remove(path.c_str());
+}
+
+void Test::profiler() {
+  Log::get().info("Testing profiler");
+  std::stringstream buf("mov $1,2\nlpb $0\n  sub $0,1\n  mul $1,$1\nlpe\n");
+  Parser parser;
+  auto p = parser.parse(buf);
+  Interpreter interpreter(settings);
+  Profiler profiler;
+  interpreter.setProfiler(&profiler);
+  Memory mem;
+  mem.set(Program::INPUT_CELL, 8);
+  interpreter.run(p, mem);
+  interpreter.setProfiler(nullptr);
+  const auto& stats = profiler.getStats(p);
+  check_int("runs", 1, stats.runs);
+  check_int("largest_cell", 1, stats.largest_cell);
+  check_int("lpb.count", 1, stats.ops[1].count);
+  check_int("lpe.count", stats.ops[2].count, stats.ops[4].count);
+  check_int("mul.arithmetic", stats.ops[3].count, stats.ops[3].arithmetic);
+  if (stats.ops[3].big == 0 || stats.ops[3].big >= stats.ops[3].arithmetic) {
+    Log::get().error("Unexpected number of big number operations", true);
+  }
+  std::stringstream out;
+  profiler.print(out);
+  if (out.str().find("iterations") == std::string::npos) {
+    Log::get().error("Missing loop info in profile", true);
+  }
+}
+
+void Test::memoryBudget() {
+  Log::get().info("Testing memory budget");
+  auto& budget = MemoryBudget::get();
+  const auto& account =
+      budget.getAccount(MemoryBudget::Subsystem::TERMS_CACHE);
+  const int64_t base = account.getUsage();
+  const int64_t gb = 1024 * 1024 * 1024;
+  const int64_t limit = 1000 * gb;
+  MemoryBudget::Usage terms(MemoryBudget::Subsystem::TERMS_CACHE);
+  MemoryBudget::Usage backoff(MemoryBudget::Subsystem::BACKOFF);
+  terms.set(600 * gb);
+  {
+    auto copy = terms;
+    check_int("copy", base + 1200 * gb, account.getUsage());
+  }
+  check_int("usage", base + 600 * gb, account.getUsage());
+  // below the grow threshold all caches may grow
+  budget.update(700 * gb, limit);
+  check_int("terms.mayGrow", 1, terms.mayGrow());
+  check_int("backoff.mayGrow", 1, backoff.mayGrow());
+  // above the grow threshold only caches within their share may grow
+  budget.update(900 * gb, limit);
+  check_int("terms.mayGrow", 0, terms.mayGrow());
+  check_int("terms.shouldShrink", 0, terms.shouldShrink());
+  check_int("backoff.mayGrow", 1, backoff.mayGrow());
+  // at the limit caches exceeding their share should shrink
+  budget.update(990 * gb, limit);
+  check_int("terms.shouldShrink", 1, terms.shouldShrink());
+  check_int("backoff.shouldShrink", 0, backoff.shouldShrink());
+  terms.set(0);
+  budget.update(0, limit);
+  check_int("terms.mayGrow", 1, terms.mayGrow());
+  check_int("usage", base, account.getUsage());
+}
+
+void Test::submissionQueue() {
+  Log::get().info("Testing submission queue");
+  const std::string spill_file = getTmpDir() + "test_submissions.jsonl";
+  std::remove(spill_file.c_str());
+  std::mutex mutex;
+  std::vector<std::string> received;
+  size_t num_calls = 0;
+  bool available = false;
+  // stand-in for the API server that can be unavailable
+  auto sender = [&](const std::string& body) {
+    std::lock_guard<std::mutex> lock(mutex);
+    num_calls++;
+    if (!available) {
+      return false;
+    }
+    received.push_back(body);
+    return true;
+  };
+  auto body = [](size_t i) {
+    return "{\"id\":\"" + std::to_string(i) + "\"}";
+  };
+  const auto timeout = std::chrono::seconds(10);
+  const size_t n = 25;
+  {
+    // server unavailable: all submissions are spilled
+    SubmissionQueue queue(spill_file, sender, 4, std::chrono::milliseconds(1));
+    for (size_t i = 0; i < n; i++) {
+      queue.push(body(i));
+    }
+    check_int("size", n, queue.size());
+  }
+  std::ifstream in(spill_file);
+  const auto num_lines =
+      std::count(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>(), '\n');
+  in.close();
+  check_int("spilled", n, num_lines);
+  {
+    // submissions are sent in order after a restart
+    std::lock_guard<std::mutex> lock(mutex);
+    available = true;
+    num_calls = 0;
+  }
+  {
+    SubmissionQueue queue(spill_file, sender, 4, std::chrono::milliseconds(1));
+    queue.push(body(n));
+    if (!queue.flush(timeout)) {
+      Log::get().error("Submission queue not flushed", true);
+    }
+    check_int("size", 0, queue.size());
+  }
+  check_int("received", n + 1, received.size());
+  check_int("calls", n + 1, num_calls);
+  for (size_t i = 0; i <= n; i++) {
+    check_str("received", body(i), received[i]);
+  }
+  if (isFile(spill_file)) {
+    Log::get().error("Unexpected spill file: " + spill_file, true);
+  }
+  // spill files are locked exclusively by one miner instance
+  const std::string lock_file = spill_file + ".lock";
+  {
+    FileLock lock1(lock_file);
+    FileLock lock2(lock_file);
+    check_int("locked", 1, lock1.isLocked());
+    check_int("locked", 0, lock2.isLocked());
+  }
+  {
+    FileLock lock3(lock_file);
+    check_int("locked", 1, lock3.isLocked());
+  }
+  std::remove(lock_file.c_str());
+}
+
+void Test::publisher() {
+  Log::get().info("Testing publisher");
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool blocked = true;
+  size_t num_coalesced = 0, num_retried = 0, num_failed = 0;
+  const auto timeout = std::chrono::seconds(10);
+  {
+    Publisher publisher(std::chrono::milliseconds(1));
+    // block the background thread until all tasks are queued
+    publisher.post("blocking task", [&]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      cond.wait(lock, [&]() { return !blocked; });
+      return true;
+    });
+    for (size_t i = 0; i < 5; i++) {
+      publisher.post(
+          "coalesced task",
+          [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            num_coalesced++;
+            return true;
+          },
+          true);
+    }
+    publisher.post("retried task", [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      return ++num_retried == 2;
+    });
+    publisher.post("failed task", [&]() {
+      std::lock_guard<std::mutex> lock(mutex);
+      num_failed++;
+      return false;
+    });
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      blocked = false;
+    }
+    cond.notify_all();
+    if (!publisher.flush(timeout)) {
+      Log::get().error("Publisher not flushed", true);
+    }
+  }
+  check_int("coalesced", 1, num_coalesced);
+  check_int("retried", 2, num_retried);
+  check_int("failed", Publisher::MAX_ATTEMPTS, num_failed);
+#ifndef _WIN64
+  // forked child processes start with an empty queue
+  blocked = true;
+  auto& shared = Publisher::get();
+  shared.post("blocking task", [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return !blocked; });
+    return true;
+  });
+  const auto pid = ::fork();
+  if (pid == 0) {
+    bool ok = shared.flush(std::chrono::milliseconds(0));
+    bool done = false;
+    shared.post("child task", [&]() {
+      done = true;
+      return true;
+    });
+    ok = ok && shared.flush(timeout) && done;
+    _exit(ok ? 0 : 1);
+  }
+  if (pid < 0) {
+    Log::get().error("Cannot fork child process", true);
+  }
+  std::vector<HANDLE> pids = {pid};
+  int exit_code = 0;
+  check_int("index", 0, waitForChildProcesses(pids, 10000, exit_code));
+  check_int("exit code", 0, exit_code);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    blocked = false;
+  }
+  cond.notify_all();
+  if (!shared.flush(timeout)) {
+    Log::get().error("Publisher not flushed", true);
+  }
+#endif
+}
+
+void Test::logFile() {
+  Log::get().info("Testing log file");
+  const std::string path = getTmpDir() + "test_log.txt";
+  std::remove(path.c_str());
+  auto& log = Log::get();
+  const auto level = log.level;
+  log.setFile(path);
+  log.level = Log::Level::INFO;
+  bool evaluated = false;
+  log.debug([&]() {
+    evaluated = true;
+    return "disabled";
+  });
+  const size_t num_threads = 4, num_lines = 100;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&log, t]() {
+      for (size_t i = 0; i < num_lines; i++) {
+        log.info("thread " + std::to_string(t) + " line " + std::to_string(i));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  log.setFile("");
+  log.level = level;
+  if (evaluated) {
+    Log::get().error("Unexpected evaluation of disabled log message", true);
+  }
+  // check that the lines of each thread are complete and in order
+  std::ifstream in(path);
+  std::string line;
+  std::vector<size_t> next(num_threads, 0);
+  while (std::getline(in, line)) {
+    const auto pos = line.find("|thread ");
+    if (pos == std::string::npos) {
+      continue;
+    }
+    std::stringstream buf(line.substr(pos + 8));
+    size_t t, i;
+    std::string word;
+    buf >> t >> word >> i;
+    if (t >= num_threads || next[t] != i) {
+      Log::get().error("Unexpected log line: " + line, true);
+    }
+    next[t]++;
+  }
+  in.close();
+  for (size_t t = 0; t < num_threads; t++) {
+    check_int("lines", num_lines, next[t]);
+  }
+  std::remove(path.c_str());
+}
+
+void Test::rangeCache() {
+  std::string path = std::string("tests") + FILE_SEP + std::string("formula") +
+                     FILE_SEP + "range.txt";
+  std::map<UID, std::string> map;
+  SequenceList::loadMapWithComments(path, map);
+  Log::get().info("Testing range cache and incremental range generation");
+  RangeCache::get().clear();
+  Parser parser;
+  RangeGenerator incremental;
+  for (const auto& e : map) {
+    auto p = parser.parse(ProgramUtil::getProgramPath(e.first));
+    for (bool before : {false, true}) {
+      // analyze a program with a common prefix first
+      auto q = p;
+      q.ops.back() = Operation(Operation::Type::ADD,
+                               Operand(Operand::Type::DIRECT, Number(0)),
+                               Operand(Operand::Type::CONSTANT, Number(1)));
+      std::vector<RangeMap> expected, result;
+      incremental.setRangeBeforeOp(before);
+      incremental.collect(q, result);
+      result.clear();
+      RangeGenerator fresh;
+      fresh.setRangeBeforeOp(before);
+      bool ok1 = fresh.collect(p, expected);
+      bool ok2 = incremental.collect(p, result);
+      if (ok1 != ok2 || expected.size() != result.size()) {
+        Log::get().error("Unexpected incremental ranges for " +
+                             e.first.string(),
+                         true);
+      }
+      for (size_t i = 0; i < expected.size(); i++) {
+        if (expected[i].toString() != result[i].toString()) {
+          Log::get().error("Unexpected incremental ranges for " +
+                               e.first.string() + ": " + result[i].toString(),
+                           true);
+        }
+      }
+    }
+    // cached output ranges must match the generated ones
+    for (size_t i = 0; i < 2; i++) {
+      RangeGenerator gen;
+      RangeMap ranges;
+      Range output;
+      bool ok1 = gen.generate(p, ranges);
+      bool ok2 = gen.generateOutput(p, output);
+      if (ok1 != ok2 || ranges.get(Program::OUTPUT_CELL) != output) {
+        Log::get().error("Unexpected cached range for " + e.first.string(),
+                         true);
+      }
+    }
+  }
+  if (RangeCache::get().getNumHits() == 0) {
+    Log::get().error("Range cache not used", true);
+  }
+  RangeCache::get().clear();
+}
+
 void Test::checkRanges(int64_t id, bool finite, const std::string& expected) {
   Parser parser;
   UID uid('A', id);
@@ -1427,12 +2193,16 @@ void Test::virtualSeq() {
   }
 }
 
+void checkStatsSnapshot(const Stats& stats, const std::string& dir);
+
 void Test::stats() {
   Log::get().info("Testing stats loading and saving");
 
-  // load stats
+  // load stats including the count maps
   Stats s, t;
-  s = getManager().getStats();
+  getManager().getStats();
+  s.load(getTmpDir() + "stats");
+  checkStatsSnapshot(s, getTmpDir() + "stats");
 
   // sanity check for loaded stats
   if (s.num_constants.at(1) == 0) {
@@ -1518,10 +2288,169 @@ void Test::stats() {
   }
 }
 
+void checkStatsFiles(const std::string& dir1, const std::string& dir2);
+
+void Test::statsUpdate() {
+  Log::get().info("Testing incremental stats update and merging");
+  Parser parser;
+  auto addPrograms = [&](Stats& stats, const std::vector<int64_t>& ids,
+                         int64_t changed_id, int64_t changed_source) {
+    for (auto id : ids) {
+      const UID uid('A', id);
+      auto source = (id == changed_id) ? UID('A', changed_source) : uid;
+      auto p = parser.parse(ProgramUtil::getProgramPath(source));
+      ProgramUtil::removeOps(p, Operation::Type::NOP);
+      // the changed program has a new submitter, which must get the same
+      // ref ID in incremental and full updates
+      auto submitter =
+          (id == changed_id) ? "new" : "test" + std::to_string(id % 3);
+      stats.updateProgramStats(uid, p, submitter, "", 0);
+    }
+  };
+  auto addSequences = [](Stats& stats, const std::vector<int64_t>& ids) {
+    for (auto id : ids) {
+      const UID uid('A', id);
+      stats.updateSequenceStats(uid, stats.program_lengths.count(uid), false);
+    }
+  };
+  const std::string dir1 = getTmpDir() + "stats_full1" + FILE_SEP;
+  const std::string dir2 = getTmpDir() + "stats_full2" + FILE_SEP;
+  const std::string dir3 = getTmpDir() + "stats_incremental" + FILE_SEP;
+  ensureDir(dir1);
+  ensureDir(dir2);
+  ensureDir(dir3);
+
+  // full stats before and after the changes
+  const std::vector<int64_t> before = {5, 27, 45, 142, 1044, 1611};
+  const std::vector<int64_t> after = {5, 27, 45, 1044, 1611, 243980};
+  const std::vector<int64_t> all = {5, 27, 45, 142, 1044, 1611, 243980};
+  Stats s1, s2;
+  addPrograms(s1, before, 0, 0);
+  addSequences(s1, all);
+  s1.finalize();
+  s1.save(dir1);
+  addPrograms(s2, after, 1044, 168);
+  addSequences(s2, all);
+  s2.finalize();
+  s2.save(dir2);
+  checkStatsSnapshot(s2, dir2);
+
+  // incremental update: modify A001044, remove A000142, add A243980
+  Stats s3;
+  s3.load(dir1);
+  s3.prepareIncrementalUpdate();
+  for (auto id : {1044, 142}) {
+    auto p = parser.parse(ProgramUtil::getProgramPath(UID('A', id)));
+    ProgramUtil::removeOps(p, Operation::Type::NOP);
+    s3.removeProgramStats(UID('A', id), p, "test" + std::to_string(id % 3));
+  }
+  addPrograms(s3, {1044, 243980}, 1044, 168);
+  addSequences(s3, all);
+  s3.finalize();
+  s3.save(dir3);
+  checkStatsFiles(dir2, dir3);
+
+  // merged partial stats
+  Stats s4, p1, p2;
+  addPrograms(p1, {5, 27, 45}, 0, 0);
+  addPrograms(p2, {1044, 1611, 243980}, 1044, 168);
+  s4.merge(p1);
+  s4.merge(p2);
+  addSequences(s4, all);
+  s4.finalize();
+  s4.save(dir3);
+  checkStatsFiles(dir2, dir3);
+
+  // snapshot with constants that do not fit into 64 bits
+  Stats s5;
+  std::stringstream buf("mov $1,123456789012345678901234567890\nmul $0,$1\n");
+  s5.updateProgramStats(UID('A', 1), parser.parse(buf), "test", "", 0);
+  s5.updateSequenceStats(UID('A', 1), true, false);
+  s5.save(dir3);
+  checkStatsSnapshot(s5, dir3);
+  rmDirRecursive(dir1);
+  rmDirRecursive(dir2);
+  rmDirRecursive(dir3);
+}
+
+void checkStatsFiles(const std::string& dir1, const std::string& dir2) {
+  for (const std::string f :
+       {"blocks.asm", "call_graph.csv", "constant_counts.csv",
+        "operation_counts.csv", "operation_pos_counts.csv",
+        "operation_types.csv", "program_lengths.csv", "programs.csv",
+        "submitters.csv", "summary.csv"}) {
+    if (getFileAsString(dir1 + f) != getFileAsString(dir2 + f)) {
+      Log::get().error("Unexpected stats in " + f, true);
+    }
+  }
+}
+
+void checkStatsSnapshot(const Stats& stats, const std::string& dir) {
+  Stats loaded;
+  loaded.load(dir, true);
+  const auto& snapshot = loaded.getSnapshot();
+  if (snapshot.empty() || !loaded.hasCountsFromSnapshot()) {
+    Log::get().error("Stats snapshot not loaded from " + dir, true);
+  }
+  if (!loaded.num_constants.empty() || !loaded.num_operations.empty() ||
+      !loaded.num_operation_positions.empty()) {
+    Log::get().error("Unexpected count maps in stats loaded from snapshot",
+                     true);
+  }
+  loaded.prepareIncrementalUpdate();  // builds the count maps
+  if (loaded.num_constants != stats.num_constants ||
+      loaded.num_operations != stats.num_operations ||
+      loaded.num_operation_positions != stats.num_operation_positions) {
+    Log::get().error("Unexpected counts in stats loaded from snapshot", true);
+  }
+  if (snapshot.numConstants() != stats.num_constants.size() ||
+      snapshot.numOperations() != stats.num_operations.size() ||
+      snapshot.numOperationPositions() !=
+          stats.num_operation_positions.size()) {
+    Log::get().error("Unexpected number of counts in stats snapshot", true);
+  }
+  size_t i = 0;
+  int64_t count;
+  for (const auto& e : stats.num_constants) {
+    if (snapshot.getConstant(i) != e.first ||
+        snapshot.getConstantCount(i) != e.second ||
+        !snapshot.findConstantCount(e.first, count) || count != e.second) {
+      Log::get().error("Unexpected constant count in stats snapshot: " +
+                           e.first.to_string(),
+                       true);
+    }
+    i++;
+  }
+  i = 0;
+  for (const auto& e : stats.num_operations) {
+    if (snapshot.getOperation(i) != e.first ||
+        snapshot.getOperationCount(i) != e.second) {
+      Log::get().error("Unexpected operation count in stats snapshot", true);
+    }
+    i++;
+  }
+  i = 0;
+  for (const auto& e : stats.num_operation_positions) {
+    if (snapshot.getOperationPosition(i) != e.first ||
+        snapshot.getOperationPositionCount(i) != e.second) {
+      Log::get().error("Unexpected operation position count in stats snapshot",
+                       true);
+    }
+    i++;
+  }
+  if (loaded.num_programs_per_length != stats.num_programs_per_length ||
+      loaded.num_ops_per_type != stats.num_ops_per_type) {
+    Log::get().error("Unexpected length or type counts in stats snapshot",
+                     true);
+  }
+}
+
 void Test::optimizer() {
   Settings settings;
   Interpreter interpreter(settings);
   Optimizer optimizer(settings);
+  optimizer.setProfiling(true);
+  optimizer.setCaching(false);
   auto tests = loadInOutTests(std::string("tests") + FILE_SEP + "optimizer" +
                               FILE_SEP + "E");
   size_t i = 1;
@@ -1535,14 +2464,31 @@ void Test::optimizer() {
     }
     i++;
   }
+  // every pass runs at least once per program, and passes are skipped if
+  // the program did not change since their last run
+  size_t changes = 0, skipped = 0;
+  for (const auto& s : optimizer.getPassStats()) {
+    if (s.invocations < tests.size() || s.changes > s.invocations) {
+      Log::get().error("Unexpected statistics of optimizer pass " + s.name,
+                       true);
+    }
+    changes += s.changes;
+    skipped += s.skipped;
+  }
+  if (optimizer.getPassStats().empty() || changes == 0 || skipped == 0) {
+    Log::get().error("Unexpected optimizer pass statistics", true);
+  }
 }
 
 void Test::minimizer(size_t tests) {
   Evaluator evaluator(settings, EVAL_ALL, false);
   Minimizer minimizer(settings);
+  Minimizer par_minimizer(settings);
+  par_minimizer.setNumThreads(4);
+  par_minimizer.setCaching(false);
   MultiGenerator multi_generator(settings, getManager().getStats());
   Sequence s1, s2, s3;
-  Program program, minimized;
+  Program program, minimized, par_minimized;
   const int64_t num_tests = tests;
   for (int64_t i = 0; i < num_tests; i++) {
     if (i % (num_tests / 10) == 0) {
@@ -1560,8 +2506,10 @@ void Test::minimizer(size_t tests) {
       continue;
     }
     minimized = program;
+    par_minimized = program;
     try {
       minimizer.optimizeAndMinimize(minimized, s1.size());
+      par_minimizer.optimizeAndMinimize(par_minimized, s1.size());
     } catch (const std::exception& e) {
       ProgramUtil::print(program, std::cerr);
       Log::get().error("Error during minimization: " + std::string(e.what()),
@@ -1586,9 +2534,70 @@ void Test::minimizer(size_t tests) {
       Log::get().error(
           "Program evaluated to different sequence after minimization", true);
     }
+    if (par_minimized != minimized) {
+      ProgramUtil::print(minimized, std::cout);
+      ProgramUtil::print(par_minimized, std::cout);
+      Log::get().error("Parallel minimization produced a different program",
+                       true);
+    }
   }
 }
 
+void Test::resultCache() {
+  Log::get().info("Testing result cache");
+  Minimizer minimizer(settings), uncached(settings);
+  uncached.setCaching(false);
+  auto& cache = ResultCache::get();
+  cache.clear();
+  Parser parser;
+  std::vector<Program> inputs, outputs;
+  for (auto id : {5, 45, 108}) {
+    auto p = parser.parse(ProgramUtil::getProgramPath(UID('A', id)));
+    ProgramUtil::removeOps(p, Operation::Type::NOP);
+    Comments::removeComments(p);
+    p.ops.push_back(Operation(Operation::Type::ADD,
+                              Operand(Operand::Type::DIRECT, 0),
+                              Operand(Operand::Type::CONSTANT, 0)));
+    auto expected = p;
+    uncached.optimizeAndMinimize(expected, settings.num_terms);
+    inputs.push_back(p);
+    outputs.push_back(expected);
+  }
+  // first run fills the cache, second run hits it
+  for (int run = 0; run < 2; run++) {
+    for (size_t i = 0; i < inputs.size(); i++) {
+      cache.resetCounts();
+      auto p = inputs[i];
+      minimizer.optimizeAndMinimize(p, settings.num_terms);
+      if (p != outputs[i] || (run == 1 && cache.getNumHits() != 1)) {
+        Log::get().error("Unexpected result cache result", true);
+      }
+    }
+  }
+  // the minimized program is a fixpoint
+  auto p = outputs[0];
+  cache.resetCounts();
+  if (Optimizer(settings).optimize(p) || p != outputs[0] ||
+      cache.getNumHits() != 1) {
+    Log::get().error("Unexpected optimizer result from cache", true);
+  }
+  // save, load and evict entries
+  const std::string path = getTmpDir() + "result_cache_test.txt";
+  cache.save(path);
+  ResultCache loaded(2);
+  if (!loaded.load(path) || loaded.size() != 2) {
+    Log::get().error("Unexpected number of result cache entries", true);
+  }
+  bool changed = false;
+  p = inputs.back();
+  if (!loaded.lookup(p, settings.num_terms, settings, p, changed) ||
+      p != outputs.back() || !changed) {
+    Log::get().error("Unexpected result cache entry after loading", true);
+  }
+  std::remove(path.c_str());
+  cache.clear();
+}
+
 bool checkRange(const Sequence& seq, const Program& program, bool finiteInput) {
   auto offset = ProgramUtil::getOffset(program);
   Number inputUpperBound = finiteInput ? offset + seq.size() - 1 : Number::INF;
@@ -1688,6 +2697,54 @@ void Test::digitMatcher() {
   // testMatcherPair( decimal, 11557, 7 );
 }
 
+void Test::directMatcherRange() {
+  Log::get().info("Testing direct matcher ranges");
+  DirectMatcher matcher(false);
+  Range range(Number(-5), Number(5));
+  if (matcher.canMatch(range)) {
+    Log::get().error("Unexpected match of empty matcher", true);
+  }
+  matcher.insert(Sequence({1, 2, 3, 4}), UID('A', 1));
+  matcher.insert(Sequence({10, 20, 30, 40}), UID('A', 2));
+  std::vector<std::pair<Range, bool>> tests = {
+      {Range(Number(0), Number(5)), true},
+      {Range(Number(0), Number(3)), false},
+      {Range(Number(11), Number(50)), false},
+      {Range(Number(10), Number::INF), true},
+      {Range(Number::INF, Number(4)), true},
+      {Range(Number::INF, Number::INF), true}};
+  for (const auto& t : tests) {
+    if (matcher.canMatch(t.first) != t.second) {
+      Log::get().error("Unexpected direct matcher result for " +
+                           t.first.toString("x"),
+                       true);
+    }
+  }
+}
+
+void Test::rangePrefilter() {
+  Log::get().info("Testing range prefilter");
+  Evaluator evaluator(settings, EVAL_ALL, false);
+  Finder finder(settings, evaluator);
+  finder.setPrefilter(true);
+  auto& matchers = finder.getMatchers();
+  matchers.clear();
+  matchers.emplace_back(new DirectMatcher(false));
+  matchers.back()->insert(Sequence({5, 5, 5, 5, 5, 5, 5, 5}), UID('A', 1));
+  // the ranges of the cells are unbounded in both directions and pruned
+  Parser parser;
+  std::stringstream buf(
+      "mov $1,1\nlpb $0\n  sub $0,1\n  mul $1,-2\nlpe\nmov $0,$1\n");
+  const auto p = parser.parse(buf);
+  Sequence norm_seq;
+  SequenceIndex sequences;
+  finder.findSequence(p, norm_seq, sequences);
+  check_int("skipped", 0, finder.getNumPrefilterSkipped());
+  check_int("rejected", 0, finder.getNumPrefilterRejected());
+  check_str("sequence", "1,-2,4,-8,16",
+            norm_seq.subsequence(0, 5).to_string());
+}
+
 void Test::testBinary(const std::string& func, const std::string& file,
                       const std::vector<std::vector<int64_t>>& values) {
   Log::get().info("Testing " + file);
@@ -1890,3 +2947,89 @@ void Test::gzip() {
     std::remove(gz_path.c_str());
   }
 }
+
+void Test::toolWorker() {
+#ifndef _WIN64
+  Log::get().info("Testing tool worker pool");
+  // use the shell as stand-in for an external tool
+  ToolWorkerPool pool({"sh"}, "echo END", "END", 2);
+  std::vector<std::string> out;
+  for (int i = 0; i < 3; i++) {
+    auto code =
+        pool.eval("echo " + std::to_string(i) + "; echo x >&2", 10, out);
+    if (code != 0 || out != std::vector<std::string>{std::to_string(i), "x"}) {
+      Log::get().error("Unexpected tool worker output", true);
+    }
+  }
+  if (pool.getNumStarts() != 1) {
+    Log::get().error("Tool worker not reused", true);
+  }
+  // stuck workers are killed and replaced
+  if (pool.eval("sleep 10", 1, out) != PROCESS_ERROR_TIMEOUT) {
+    Log::get().error("Expected tool worker timeout", true);
+  }
+  if (pool.eval("echo 5", 10, out) != 0 || out.size() != 1 ||
+      pool.getNumStarts() != 2) {
+    Log::get().error("Tool worker not restarted", true);
+  }
+  // terminated workers report their exit code
+  if (pool.eval("exit 3", 10, out) != 3 ||
+      pool.eval("exit 0", 10, out) != PROCESS_ERROR_INCOMPLETE) {
+    Log::get().error("Unexpected tool worker exit code", true);
+  }
+  // writing large requests to a busy worker does not delay the timeout
+  const auto start = std::chrono::steady_clock::now();
+  const std::string large(1 << 20, ' ');
+  if (pool.eval("sleep 5\n#" + large, 1, out) != PROCESS_ERROR_TIMEOUT ||
+      std::chrono::steady_clock::now() - start > std::chrono::seconds(3)) {
+    Log::get().error("Expected tool worker timeout for large request", true);
+  }
+  Sequence seq;
+  if (!SequenceUtil::evalFormulaWithWorkerPool("echo 1; echo 2", "sh", pool, 10,
+                                               seq) ||
+      seq != Sequence({1, 2})) {
+    Log::get().error("Unexpected tool worker sequence: " + seq.to_string(),
+                     true);
+  }
+#endif
+}
+
+void Test::childProcesses() {
+#ifndef _WIN64
+  Log::get().info("Testing child process supervision");
+  // child processes that terminate after a delay with different exit codes
+  std::vector<HANDLE> pids = {0, 0, 0};
+  for (size_t i = 1; i < pids.size(); i++) {
+    const auto pid = ::fork();
+    if (pid == 0) {
+      usleep(i * 200000);
+      _exit(static_cast<int>(i + 10));
+    }
+    if (pid < 0) {
+      Log::get().error("Cannot fork child process", true);
+    }
+    pids[i] = pid;
+  }
+  int exit_code = 0;
+  if (waitForChildProcesses(pids, 10, exit_code) != -1) {
+    Log::get().error("Expected timeout waiting for child processes", true);
+  }
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 1; i < pids.size(); i++) {
+    const auto index = waitForChildProcesses(pids, 10000, exit_code);
+    check_int("index", i, index);
+    check_int("exit code", i + 10, exit_code);
+    pids[index] = 0;
+  }
+  // terminations must be noticed without waiting for the timeout
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  if (elapsed > 2000) {
+    Log::get().error("Child process termination noticed late", true);
+  }
+  if (waitForChildProcesses(pids, 10, exit_code) != -1) {
+    Log::get().error("Expected timeout without child processes", true);
+  }
+#endif
+}
@@ -26,12 +26,16 @@ class Test {
 
   void sequence();
 
+  void sequenceIndex();
+
   void memory();
 
   void operationMetadata();
 
   void programUtil();
 
+  void programCorpus();
+
   void iterator(size_t tests);
 
   void knownPrograms();
@@ -66,6 +70,8 @@ class Test {
 
   void minimizer(size_t tests);
 
+  void resultCache();
+
   void randomRange(size_t tests);
 
   void miner();
@@ -76,18 +82,53 @@ class Test {
 
   void digitMatcher();
 
+  void directMatcherRange();
+  void rangePrefilter();
+
   void stats();
 
+  void statsUpdate();
+
   void config();
 
   void memUsage();
 
   void formula();
 
+  void nativeFormula();
+
+  void expressionPool();
+
+  void formulaCache();
+
   void range();
 
+  void rangeCache();
+
+  void costModel();
+
+  void benchmarkResults();
+
+  void stageTimer();
+
+  void trace();
+
+  void profiler();
+
+  void memoryBudget();
+
+  void submissionQueue();
+
+  void publisher();
+
+  void logFile();
+
   void gzip();
 
+  void toolWorker();
+
+  void childProcesses();
+
   void virtualSeq();
 
   enum class FormulaType { FORMULA, PARI_FUNCTION, PARI_VECTOR, LEAN };
@@ -0,0 +1,104 @@
+#include "eval/cost_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+CostModel::CostModel()
+    : total(0), exponential(false), has_fit(false), ratio(0), degree(0) {}
+
+void CostModel::reset(bool exp) {
+  steps.clear();
+  total = 0;
+  exponential = exp;
+  has_fit = false;
+  start_time = std::chrono::steady_clock::now();
+}
+
+void CostModel::add(size_t s) {
+  steps.push_back(s);
+  total += s;
+  has_fit = false;
+  const size_t n = steps.size();
+  if (n < MIN_TERMS) {
+    return;
+  }
+  // the step counts of the last terms must be strictly increasing
+  for (size_t j = n - MIN_TERMS + 1; j < n; j++) {
+    if (steps[j - 1] < MIN_STEPS || steps[j] <= steps[j - 1]) {
+      return;
+    }
+  }
+  ratio = HUGE_VAL;
+  degree = HUGE_VAL;
+  for (size_t j = n - MIN_TERMS + 1; j < n; j++) {
+    const double r = static_cast<double>(steps[j]) / steps[j - 1];
+    ratio = std::min(ratio, r);
+    degree = std::min(degree, std::log(r) / std::log((j + 1.0) / j));
+  }
+  has_fit = true;
+}
+
+double CostModel::project(size_t index) const {
+  if (!has_fit) {
+    return -1;
+  }
+  const size_t last = steps.size() - 1;
+  if (index <= last) {
+    return steps[index];
+  }
+  const double base = steps[last];
+  const double exp_steps = base * std::pow(ratio, index - last);
+  if (exponential) {
+    return exp_steps;
+  }
+  const double poly_steps =
+      base * std::pow((index + 1.0) / (last + 1.0), degree);
+  return std::min(exp_steps, poly_steps);
+}
+
+bool CostModel::shouldAbort(size_t num_terms, int64_t max_term_steps,
+                            int64_t max_total_steps, int64_t max_secs,
+                            double &saved_seconds) const {
+  const size_t n = steps.size();
+  if (!has_fit || num_terms <= n) {
+    return false;
+  }
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start_time)
+                             .count();
+  const double secs_per_step = elapsed / std::max<size_t>(total, 1);
+  const double term_limit = SAFETY_FACTOR * max_term_steps;
+  const double total_limit = SAFETY_FACTOR * max_total_steps;
+  const double secs_limit = SAFETY_FACTOR * max_secs;
+
+  // quick check using the last term, which has the largest projection
+  const double last = project(num_terms - 1);
+  const double upper = total + (num_terms - n) * last;
+  if ((max_term_steps <= 0 || last <= term_limit) &&
+      (max_total_steps <= 0 || upper <= total_limit) &&
+      (max_secs <= 0 || upper * secs_per_step <= secs_limit)) {
+    return false;
+  }
+
+  // project the remaining terms until a limit is exceeded
+  double remaining = 0;
+  for (size_t k = n; k < num_terms; k++) {
+    const double p = project(k);
+    if (max_term_steps > 0 && p > term_limit) {
+      // the evaluation would fail at this term
+      saved_seconds = (remaining + max_term_steps) * secs_per_step;
+      return true;
+    }
+    remaining += p;
+    if (max_total_steps > 0 && total + remaining > total_limit) {
+      saved_seconds =
+          std::max<double>(max_total_steps - total, 0) * secs_per_step;
+      return true;
+    }
+    if (max_secs > 0 && elapsed + remaining * secs_per_step > secs_limit) {
+      saved_seconds = std::max(max_secs - elapsed, 0.0);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Predicts the number of interpreter steps of the remaining terms of an
+// evaluation from the steps of the terms evaluated so far. The step counts
+// are fitted to both a polynomial and an exponential growth model using the
+// last terms. Projections are conservative: the smallest observed growth
+// rate is used and, unless the growth is known to be exponential, the
+// smaller of the two projections.
+class CostModel {
+ public:
+  // minimum number of terms with increasing step counts needed for a fit
+  static constexpr size_t MIN_TERMS = 4;
+
+  // step counts of terms below this value are considered noise
+  static constexpr size_t MIN_STEPS = 100;
+
+  // factor by which a projection must exceed a limit to abort
+  static constexpr double SAFETY_FACTOR = 2.0;
+
+  CostModel();
+
+  // Starts a new evaluation. If exponential is set, e.g. based on a static
+  // analysis of the program, only the exponential model is used.
+  void reset(bool exponential);
+
+  // Adds the number of steps of the next term.
+  void add(size_t steps);
+
+  // Returns the projected number of steps of the term with the given index,
+  // or a negative value if there is no projection available.
+  double project(size_t index) const;
+
+  // Returns true if evaluating the terms up to num_terms (exclusive) is
+  // projected to exceed the steps per term, the total steps or the time
+  // limit in seconds. Non-positive limits are ignored. If true is returned,
+  // saved_seconds is set to the estimated time saved by aborting.
+  bool shouldAbort(size_t num_terms, int64_t max_term_steps,
+                   int64_t max_total_steps, int64_t max_secs,
+                   double &saved_seconds) const;
+
+ private:
+  std::vector<size_t> steps;
+  size_t total;
+  bool exponential;
+  bool has_fit;
+  double ratio;   // growth factor per term (exponential model)
+  double degree;  // growth degree (polynomial model)
+  std::chrono::time_point<std::chrono::steady_clock> start_time;
+};
@@ -2,8 +2,10 @@
 
 #include <sstream>
 
+#include "lang/analyzer.hpp"
 #include "lang/program_util.hpp"
 #include "sys/log.hpp"
+#include "sys/trace.hpp"
 
 steps_t::steps_t() : min(0), max(0), total(0), runs(0) {}
 
@@ -31,10 +33,14 @@ Evaluator::Evaluator(const Settings &settings, eval_mode_t eval_modes,
       use_vir_eval(eval_modes & EVAL_VIRTUAL),
       check_range(check_range),
       check_eval_time(settings.max_eval_secs >= 0),
-      is_debug(Log::get().level == Log::Level::DEBUG) {}
+      is_debug(Log::get().level == Log::Level::DEBUG),
+      use_cost_model(false),
+      num_cost_aborts(0),
+      cost_saved_secs(0) {}
 
 steps_t Evaluator::eval(const Program &p, Sequence &seq, int64_t num_terms,
                         const bool throw_on_error) {
+  Trace::Span span("eval", "eval");
   if (num_terms < 0) {
     num_terms = settings.num_terms;
   }
@@ -47,6 +53,11 @@ steps_t Evaluator::eval(const Program &p, Sequence &seq, int64_t num_terms,
   size_t s;
   const bool use_inc = use_inc_eval && inc_evaluator.init(p);
   const bool use_vir = !use_inc && use_vir_eval && vir_evaluator.init(p);
+  const bool use_cost =
+      use_cost_model && throw_on_error && !use_inc && !use_vir;
+  if (use_cost) {
+    cost_model.reset(Analyzer::hasExponentialComplexity(p));
+  }
   std::pair<Number, size_t> tmp_result;
   const int64_t offset = ProgramUtil::getOffset(p);
   for (int64_t i = 0; i < num_terms; i++) {
@@ -65,6 +76,10 @@ steps_t Evaluator::eval(const Program &p, Sequence &seq, int64_t num_terms,
         mem.set(Program::INPUT_CELL, index);
         s = interpreter.run(p, mem);
         seq[i] = mem.get(Program::OUTPUT_CELL);
+        if (use_cost) {
+          cost_model.add(s);
+          checkCost(num_terms, 0);
+        }
       }
       if (check_eval_time) {
         checkEvalTime();
@@ -95,6 +110,7 @@ steps_t Evaluator::eval(const Program &p, Sequence &seq, int64_t num_terms,
 
 steps_t Evaluator::eval(const Program &p, std::vector<Sequence> &seqs,
                         int64_t num_terms) {
+  Trace::Span span("eval", "eval");
   if (num_terms < 0) {
     num_terms = settings.num_terms;
   }
@@ -107,11 +123,20 @@ steps_t Evaluator::eval(const Program &p, std::vector<Sequence> &seqs,
   Memory mem;
   steps_t steps;
   // note: we can't use the incremental evaluator here
+  if (use_cost_model) {
+    cost_model.reset(Analyzer::hasExponentialComplexity(p));
+  }
   const int64_t offset = ProgramUtil::getOffset(p);
+  size_t s;
   for (int64_t i = 0; i < num_terms; i++) {
     mem.clear();
     mem.set(Program::INPUT_CELL, i + offset);
-    steps.add(interpreter.run(p, mem));
+    s = interpreter.run(p, mem);
+    steps.add(s);
+    if (use_cost_model) {
+      cost_model.add(s);
+      checkCost(num_terms, 0);
+    }
     for (size_t s = 0; s < seqs.size(); s++) {
       seqs[s][i] = mem.get(s);
     }
@@ -127,17 +152,15 @@ std::string rangeStr(const Range &r, int64_t n) {
 }
 
 Range Evaluator::generateRange(const Program &p, int64_t inputUpperBound) {
-  RangeMap ranges;
+  Range range(Number::INF, Number::INF);
   range_generator.setInputUpperBound(Number(inputUpperBound));
   try {
-    if (!range_generator.generate(p, ranges)) {
-      ranges.clear();
-    }
+    range_generator.generateOutput(p, range);
   } catch (const std::exception &e) {
     Log::get().error("Error during range generation: " + std::string(e.what()),
                      true);
   }
-  return ranges.get(Program::OUTPUT_CELL);
+  return range;
 }
 
 void printb(int64_t index, const std::string &val) {
@@ -147,7 +170,11 @@ void printb(int64_t index, const std::string &val) {
 std::pair<status_t, steps_t> Evaluator::check(const Program &p,
                                               const Sequence &expected_seq,
                                               int64_t num_required_terms,
-                                              UID id) {
+                                              UID id, size_t max_total_steps) {
+  Trace::Span span("eval", "check");
+  if (span) {
+    span.setArg(id.string());
+  }
   if (num_required_terms < 0) {
     num_required_terms = expected_seq.size();
   }
@@ -173,8 +200,13 @@ std::pair<status_t, steps_t> Evaluator::check(const Program &p,
   interpreter.clearCaches();
   const bool use_inc = use_inc_eval && inc_evaluator.init(p);
   const bool use_vir = !use_inc && use_vir_eval && vir_evaluator.init(p);
+  const bool use_cost = use_cost_model && !use_inc && !use_vir;
+  if (use_cost) {
+    cost_model.reset(Analyzer::hasExponentialComplexity(p));
+  }
   std::pair<Number, size_t> tmp_result;
   result.first = status_t::OK;
+  size_t s;
   Memory mem;
   Number out;
   for (size_t i = 0; i < expected_seq.size(); i++) {
@@ -191,8 +223,20 @@ std::pair<status_t, steps_t> Evaluator::check(const Program &p,
         } else {
           mem.clear();
           mem.set(Program::INPUT_CELL, index);
-          result.second.add(interpreter.run(p, mem, id));
+          s = interpreter.run(p, mem, id);
+          result.second.add(s);
           out = mem.get(Program::OUTPUT_CELL);
+          if (max_total_steps > 0 && result.second.total > max_total_steps) {
+            if (settings.print_as_b_file) {
+              printb(index, "-> maximum number of steps exceeded");
+            }
+            result.first = status_t::ERROR;
+            return result;
+          }
+          if (use_cost) {
+            cost_model.add(s);
+            checkCost(static_cast<size_t>(num_required_terms), max_total_steps);
+          }
         }
         if (check_eval_time) {
           checkEvalTime();
@@ -254,6 +298,21 @@ bool Evaluator::supportsEvalModes(const Program &p, eval_mode_t eval_modes) {
 
 void Evaluator::clearCaches() { interpreter.clearCaches(); }
 
+void Evaluator::resetCostCounts() {
+  num_cost_aborts = 0;
+  cost_saved_secs = 0;
+}
+
+void Evaluator::checkCost(size_t num_terms, size_t max_total_steps) {
+  double saved_secs = 0;
+  if (cost_model.shouldAbort(num_terms, settings.max_cycles, max_total_steps,
+                             settings.max_eval_secs, saved_secs)) {
+    num_cost_aborts++;
+    cost_saved_secs += saved_secs;
+    throw std::runtime_error("projected evaluation cost exceeded");
+  }
+}
+
 void Evaluator::checkEvalTime() const {
   const int64_t millis = std::chrono::duration_cast<std::chrono::milliseconds>(
                              std::chrono::steady_clock::now() - start_time)
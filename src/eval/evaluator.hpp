@@ -2,6 +2,7 @@
 
 #include <chrono>
 
+#include "eval/cost_model.hpp"
 #include "eval/evaluator_inc.hpp"
 #include "eval/evaluator_vir.hpp"
 #include "eval/interpreter.hpp"
@@ -38,17 +39,36 @@ class Evaluator {
   steps_t eval(const Program &p, std::vector<Sequence> &seqs,
                int64_t num_terms = -1);
 
+  // Check a program against an expected sequence. Stops at the first term
+  // that does not match. If max_total_steps is positive, the check also fails
+  // as soon as the total number of interpreter steps exceeds it.
   std::pair<status_t, steps_t> check(const Program &p,
                                      const Sequence &expected_seq,
                                      int64_t num_required_terms = -1,
-                                     UID id = UID());
+                                     UID id = UID(),
+                                     size_t max_total_steps = 0);
 
   bool supportsEvalModes(const Program &p, eval_mode_t eval_modes);
 
   IncrementalEvaluator &getIncEvaluator() { return inc_evaluator; }
 
+  Interpreter &getInterpreter() { return interpreter; }
+
   void clearCaches();
 
+  // Enables aborting evaluations early if the projected number of steps of
+  // the remaining terms exceeds the limits. Only applies to the regular
+  // interpreter, and to eval() only if errors are thrown.
+  void setCostModel(bool enabled) { use_cost_model = enabled; }
+
+  // number of evaluations aborted using the cost model
+  size_t getNumCostAborts() const { return num_cost_aborts; }
+
+  // estimated evaluation time saved by aborting early
+  double getCostSavedSeconds() const { return cost_saved_secs; }
+
+  void resetCostCounts();
+
  private:
   const Settings &settings;
   Interpreter interpreter;
@@ -61,8 +81,14 @@ class Evaluator {
   const bool check_eval_time;
   const bool is_debug;
   std::chrono::time_point<std::chrono::steady_clock> start_time;
+  CostModel cost_model;
+  bool use_cost_model;
+  size_t num_cost_aborts;
+  double cost_saved_secs;
 
   Range generateRange(const Program &p, int64_t inputUpperBound);
 
   void checkEvalTime() const;
+
+  void checkCost(size_t num_terms, size_t max_total_steps);
 };
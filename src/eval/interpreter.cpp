@@ -1,6 +1,8 @@
 #include "eval/interpreter.hpp"
 
+#include <algorithm>
 #include <array>
+#include <chrono>
 #include <exception>
 #include <fstream>
 #include <iostream>
@@ -11,9 +13,12 @@
 #include "lang/parser.hpp"
 #include "lang/program.hpp"
 #include "lang/program_util.hpp"
+#include "math/big_number.hpp"
 #include "seq/managed_seq.hpp"
 #include "sys/log.hpp"
+#include "sys/memory_budget.hpp"
 #include "sys/setup.hpp"
+#include "sys/trace.hpp"
 
 #ifdef _WIN64
 #include <io.h>
@@ -32,8 +37,9 @@ using SizeStack = std::stack<size_t>;
 Interpreter::Interpreter(const Settings& settings)
     : settings(settings),
       is_debug(Log::get().level == Log::Level::DEBUG),
-      has_memory(true),
-      num_memory_checks(0) {}
+      profiler(nullptr),
+      num_memory_checks(0),
+      terms_cache_usage(MemoryBudget::Subsystem::TERMS_CACHE) {}
 
 Number Interpreter::calc(const Operation::Type type, const Number& target,
                          const Number& source) {
@@ -170,6 +176,13 @@ size_t Interpreter::run(const Program& p, Memory& mem) {
   int64_t start, length, length2;
   Operation lpb;
 
+  // optional profiling
+  Profiler::ProgramStats* prof = profiler ? &profiler->getStats(p) : nullptr;
+  Profiler::time_point run_start, op_start;
+  if (prof) {
+    run_start = std::chrono::steady_clock::now();
+  }
+
   // start program execution
   pc = 0;
   while (pc < num_ops) {
@@ -180,6 +193,15 @@ size_t Interpreter::run(const Program& p, Memory& mem) {
     auto& op = p.ops[pc];
     size_t pc_next = pc + 1;
 
+    if (prof) {
+      if (Operation::Metadata::get(op.type).num_operands > 0 &&
+          op.target.type != Operand::Type::CONSTANT) {
+        prof->largest_cell = std::max(prof->largest_cell,
+                                      get(op.target, mem, true).asInt());
+      }
+      op_start = std::chrono::steady_clock::now();
+    }
+
     switch (op.type) {
       case Operation::Type::NOP: {
         break;
@@ -292,9 +314,21 @@ size_t Interpreter::run(const Program& p, Memory& mem) {
           source = get(op.source, mem);
         }
         set(op.target, calc(op.type, target, source), mem, op);
+        if (prof) {
+          auto& s = prof->ops[pc];
+          s.arithmetic++;
+          if (target.isBig() ||
+              (Operation::Metadata::get(op.type).num_operands == 2 &&
+               source.isBig())) {
+            s.big++;
+          }
+        }
         break;
       }
     }
+    if (prof && op.type != Operation::Type::NOP) {
+      profiler->addOp(*prof, pc, op_start);
+    }
     pc = pc_next;
 
     // the rest of the logic should be ommitted for nops
@@ -341,6 +375,9 @@ size_t Interpreter::run(const Program& p, Memory& mem) {
     Log::get().debug("Finished execution after " + std::to_string(cycles) +
                      " cycles");
   }
+  if (prof) {
+    profiler->addRun(*prof, run_start);
+  }
   return cycles;
 }
 
@@ -434,6 +471,13 @@ std::pair<Number, size_t> Interpreter::callSeq(UID id, const Number& arg) {
   }
 
   // evaluate program
+  if (profiler) {
+    profiler->getStats(call_program).id = id;
+  }
+  Trace::Span span("eval", "seq");
+  if (span) {
+    span.setArg(id.string());
+  }
   std::pair<Number, size_t> result;
   running_programs.insert(id);
   Memory tmp;
@@ -447,12 +491,25 @@ std::pair<Number, size_t> Interpreter::callSeq(UID id, const Number& arg) {
     std::rethrow_exception(std::current_exception());
   }
 
-  // add to cache if there is memory available
+  // add to cache if the memory budget allows it
   if (++num_memory_checks % 10000 == 0) {
-    has_memory = Setup::hasMemory();
+    MemoryBudget::get().update();
+    if (terms_cache_usage.shouldShrink()) {
+      terms_cache.clear();
+      terms_cache_usage.set(0);
+    }
   }
-  if (has_memory || terms_cache.size() < 10000) {  // magic number
+  if (terms_cache_usage.mayGrow() ||
+      terms_cache.size() < 10000) {  // magic number
     terms_cache[key] = result;
+    int64_t bytes = sizeof(key) + sizeof(result) + MemoryBudget::NODE_OVERHEAD;
+    if (arg.isBig()) {
+      bytes += sizeof(BigNumber);
+    }
+    if (result.first.isBig()) {
+      bytes += sizeof(BigNumber);
+    }
+    terms_cache_usage.add(bytes);
   }
   return result;
 }
@@ -481,6 +538,13 @@ size_t Interpreter::callPrg(UID id, int64_t start, Memory& mem) {
   }
 
   // evaluate program
+  if (profiler) {
+    profiler->getStats(call_program).id = id;
+  }
+  Trace::Span span("eval", "prg");
+  if (span) {
+    span.setArg(id.string());
+  }
   size_t steps = 0;
   running_programs.insert(id);
   try {
@@ -506,4 +570,5 @@ size_t Interpreter::getMaxCycles() const {
 void Interpreter::clearCaches() {
   program_cache.clear();
   terms_cache.clear();
+  terms_cache_usage.set(0);
 }
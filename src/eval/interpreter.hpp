@@ -4,7 +4,9 @@
 #include <unordered_set>
 
 #include "eval/memory.hpp"
+#include "eval/profiler.hpp"
 #include "lang/program_cache.hpp"
+#include "sys/memory_budget.hpp"
 #include "sys/util.hpp"
 
 class Interpreter {
@@ -24,6 +26,10 @@ class Interpreter {
 
   void clearCaches();
 
+  // Enables collecting per-operation statistics (nullptr to disable). The
+  // profiler is not owned by the interpreter.
+  void setProfiler(Profiler *p) { profiler = p; }
+
   ProgramCache program_cache;
 
   const Settings &settings;
@@ -42,7 +48,7 @@ class Interpreter {
   size_t callPrg(UID id, int64_t start, Memory &mem);
 
   const bool is_debug;
-  bool has_memory;
+  Profiler *profiler;
   size_t num_memory_checks;
 
   struct UIDNumberPairHasher {
@@ -55,4 +61,5 @@ class Interpreter {
   std::unordered_map<std::pair<UID, Number>, std::pair<Number, size_t>,
                      UIDNumberPairHasher>
       terms_cache;
+  MemoryBudget::Usage terms_cache_usage;
 };
@@ -1,20 +1,51 @@
 #include "eval/minimizer.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <set>
 
 #include "eval/optimizer.hpp"
+#include "eval/result_cache.hpp"
 #include "eval/semantics.hpp"
 #include "lang/constants.hpp"
 #include "lang/program_util.hpp"
 #include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/setup.hpp"
+#include "sys/thread_pool.hpp"
 #include "sys/util.hpp"
 
+Minimizer::Minimizer(const Settings& settings)
+    : settings(settings),
+      optimizer(settings),
+      evaluator(this->settings, EVAL_ALL, false),
+      caching(true) {}
+
+Minimizer::~Minimizer() = default;
+
+void Minimizer::setCaching(bool enabled) {
+  caching = enabled;
+  optimizer.setCaching(enabled);
+}
+
+void Minimizer::setNumThreads(size_t num_threads) {
+  pool.reset();
+  worker_evaluators.clear();
+  if (num_threads > 1) {
+    pool.reset(new ThreadPool(num_threads));
+    for (size_t i = 0; i < num_threads; i++) {
+      worker_evaluators.emplace_back(new Evaluator(settings, EVAL_ALL, false));
+    }
+  }
+}
+
 bool Minimizer::minimize(Program& p, size_t num_terms) const {
   Log::get().debug("Minimizing program");
   evaluator.clearCaches();
+  for (auto& e : worker_evaluators) {
+    e->clearCaches();
+  }
 
   // calculate target sequence
   Sequence target_sequence;
@@ -42,98 +73,207 @@ bool Minimizer::minimize(Program& p, size_t num_terms) const {
   }
 
   // remove or replace operations
-  for (int64_t i = 0; i < (int64_t)p.ops.size(); ++i) {
-    bool local_change = false;
-    const auto op = p.ops[i];  // make a backup of the original operation
-    if (op.type == Operation::Type::LPE) {
-      continue;
-    } else if (op.type == Operation::Type::TRN) {
-      p.ops[i].type = Operation::Type::SUB;
-      if (check(p, target_sequence, target_steps.total)) {
-        local_change = true;
-      } else {
-        // revert change
-        p.ops[i] = op;
-      }
-    } else if (op.type == Operation::Type::LPB) {
-      if (op.source.type != Operand::Type::CONSTANT || op.source.value != 1) {
-        p.ops[i].source = Operand(Operand::Type::CONSTANT, 1);
-        if (check(p, target_sequence, target_steps.total)) {
-          local_change = true;
-        } else {
-          // revert change
-          p.ops[i] = op;
+  if (removeOperations(p, target_sequence, target_steps.total)) {
+    global_change = true;
+  }
+  return global_change;
+}
+
+bool isChunkRemovable(const Operation& op) {
+  return op.type != Operation::Type::LPB && op.type != Operation::Type::LPE &&
+         op.type != Operation::Type::TRN;
+}
+
+// Apply the default edit to the operation at the given index: loops are
+// changed to use a constant counter, truncations are replaced by subtractions
+// and all other operations are removed. Returns false if there is no edit.
+bool editOperation(Program& p, size_t i) {
+  auto& op = p.ops[i];
+  if (op.type == Operation::Type::LPE) {
+    return false;
+  } else if (op.type == Operation::Type::TRN) {
+    op.type = Operation::Type::SUB;
+    return true;
+  } else if (op.type == Operation::Type::LPB) {
+    if (op.source.type != Operand::Type::CONSTANT || op.source.value != 1) {
+      op.source = Operand(Operand::Type::CONSTANT, 1);
+      return true;
+    }
+    return false;
+  } else if (p.ops.size() > 1) {
+    // keep at least one operation (see A000004)
+    p.ops.erase(p.ops.begin() + i);
+    return true;
+  }
+  return false;
+}
+
+bool isGcdCandidate(const Operation& op) {
+  return op.type == Operation::Type::GCD &&
+         op.target.type == Operand::Type::DIRECT &&
+         op.source.type == Operand::Type::CONSTANT &&
+         op.source.value != Number::ZERO &&
+         Minimizer::getPowerOf(op.source.value) != 0;
+}
+
+bool Minimizer::removeOperations(Program& p, const Sequence& seq,
+                                 size_t max_total) const {
+  // Operations are processed from left to right. After a successful removal,
+  // we try to remove chunks of following operations with doubling sizes,
+  // falling back to smaller chunks on failure (similar to delta debugging).
+  // Single edits are checked speculatively ahead on all threads; the first
+  // valid edit is applied, which is the one a sequential scan would find.
+  const size_t batch_size = std::max<size_t>(worker_evaluators.size(), 1);
+  std::vector<Program> candidates;
+  std::vector<size_t> positions;
+  bool changed = false;
+  size_t chunk = 1;
+  size_t i = 0;
+  while (i < p.ops.size() && !Signals::HALT) {
+    if (chunk > 1) {
+      // try chunks of decreasing size at the current position
+      candidates.clear();
+      positions.clear();
+      for (size_t size = chunk; size > 1; size /= 2) {
+        if (i + size > p.ops.size() || size >= p.ops.size() ||
+            !std::all_of(p.ops.begin() + i, p.ops.begin() + i + size,
+                         isChunkRemovable)) {
+          continue;
         }
+        candidates.push_back(p);
+        auto& ops = candidates.back().ops;
+        ops.erase(ops.begin() + i, ops.begin() + i + size);
+        positions.push_back(size);
+      }
+      auto index = findFirstValid(candidates, seq, max_total);
+      if (index >= 0) {
+        p = candidates[index];
+        changed = true;
+        chunk = 2 * positions[index];
+        continue;
       }
-    } else if (p.ops.size() > 1) {
-      // try to remove the current operation (if there is at least one
-      // operation, see A000004)
-      p.ops.erase(p.ops.begin() + i, p.ops.begin() + i + 1);
-      if (check(p, target_sequence, target_steps.total)) {
-        local_change = true;
-        --i;
+      chunk = 1;
+    }
+
+    // try single edits of the next operations
+    candidates.clear();
+    positions.clear();
+    size_t end = i;
+    bool has_gcd = false;
+    while (end < p.ops.size() && candidates.size() < batch_size) {
+      candidates.push_back(p);
+      if (editOperation(candidates.back(), end)) {
+        positions.push_back(end);
       } else {
-        // revert change
-        p.ops.insert(p.ops.begin() + i, op);
+        candidates.pop_back();
+      }
+      // gcd operations can be replaced if they cannot be removed, which
+      // changes the program => stop here
+      has_gcd = isGcdCandidate(p.ops[end++]);
+      if (has_gcd) {
+        break;
       }
     }
+    auto index = findFirstValid(candidates, seq, max_total);
+    if (index >= 0) {
+      const size_t pos = positions[index];
+      const bool removed = candidates[index].ops.size() < p.ops.size();
+      p = candidates[index];
+      changed = true;
+      i = removed ? pos : pos + 1;
+      chunk = removed ? 2 : 1;
+      continue;
+    }
+    if (has_gcd && replaceGcd(p, end - 1, seq)) {
+      changed = true;
+    }
+    i = end;
+  }
+  return changed;
+}
+
+// Replace a gcd with a larger power of a small constant by a loop.
+bool Minimizer::replaceGcd(Program& p, size_t i, const Sequence& seq) const {
+  const auto op = p.ops[i];
+  const int64_t base = getPowerOf(op.source.value);
+  int64_t largest_used = 0;
+  if (!ProgramUtil::getUsedMemoryCells(p, nullptr, nullptr, largest_used,
+                                       settings.max_memory)) {
+    return false;
+  }
+  auto tmp = Operand(Operand::Type::DIRECT, largest_used + 1);
+  p.ops[i] =
+      Operation(Operation::Type::MOV, tmp, Operand(Operand::Type::CONSTANT, 1));
+  p.ops.insert(p.ops.begin() + i + 1,
+               Operation(Operation::Type::LPB, op.target,
+                         Operand(Operand::Type::CONSTANT, 1)));
+  p.ops.insert(p.ops.begin() + i + 2,
+               Operation(Operation::Type::MUL, tmp,
+                         Operand(Operand::Type::CONSTANT, base)));
+  p.ops.insert(p.ops.begin() + i + 3,
+               Operation(Operation::Type::DIF, op.target,
+                         Operand(Operand::Type::CONSTANT, base)));
+  p.ops.insert(p.ops.begin() + i + 4, Operation(Operation::Type::LPE));
+  p.ops.insert(p.ops.begin() + i + 5,
+               Operation(Operation::Type::MOV, op.target, tmp));
+
+  // we don't check the number of steps here!
+  if (check(p, seq, 0)) {
+    return true;
+  }
+  // revert change
+  p.ops[i] = op;
+  p.ops.erase(p.ops.begin() + i + 1, p.ops.begin() + i + 6);
+  return false;
+}
 
-    if (!local_change) {
-      // gcd with larger power of small constant? => replace with a loop
-      if (op.type == Operation::Type::GCD &&
-          op.target.type == Operand::Type::DIRECT &&
-          op.source.type == Operand::Type::CONSTANT &&
-          op.source.value != Number::ZERO) {
-        int64_t base = getPowerOf(op.source.value);
-        if (base != 0) {
-          int64_t largest_used = 0;
-          if (ProgramUtil::getUsedMemoryCells(p, nullptr, nullptr, largest_used,
-                                              settings.max_memory)) {
-            // try to replace gcd by a loop
-            auto tmp = Operand(Operand::Type::DIRECT, largest_used + 1);
-            p.ops[i] = Operation(Operation::Type::MOV, tmp,
-                                 Operand(Operand::Type::CONSTANT, 1));
-            p.ops.insert(p.ops.begin() + i + 1,
-                         Operation(Operation::Type::LPB, op.target,
-                                   Operand(Operand::Type::CONSTANT, 1)));
-            p.ops.insert(p.ops.begin() + i + 2,
-                         Operation(Operation::Type::MUL, tmp,
-                                   Operand(Operand::Type::CONSTANT, base)));
-            p.ops.insert(p.ops.begin() + i + 3,
-                         Operation(Operation::Type::DIF, op.target,
-                                   Operand(Operand::Type::CONSTANT, base)));
-            p.ops.insert(p.ops.begin() + i + 4,
-                         Operation(Operation::Type::LPE));
-            p.ops.insert(p.ops.begin() + i + 5,
-                         Operation(Operation::Type::MOV, op.target, tmp));
-
-            // we don't check the number of steps here!
-            if (check(p, target_sequence, 0)) {
-              local_change = true;
-            } else {
-              // revert change
-              p.ops[i] = op;
-              p.ops.erase(p.ops.begin() + i + 1, p.ops.begin() + i + 6);
-            }
+int64_t Minimizer::findFirstValid(const std::vector<Program>& candidates,
+                                  const Sequence& seq, size_t max_total) const {
+  const int64_t num_candidates = candidates.size();
+  if (!pool || num_candidates <= 1) {
+    for (int64_t i = 0; i < num_candidates; i++) {
+      if (check(candidates[i], seq, max_total)) {
+        return i;
+      }
+    }
+    return -1;
+  }
+  // candidates are taken in order; the smallest valid index wins and
+  // candidates after it are skipped
+  std::atomic<int64_t> next(0);
+  std::atomic<int64_t> found(num_candidates);
+  const size_t num_workers =
+      std::min<size_t>(worker_evaluators.size(), num_candidates);
+  for (size_t w = 0; w < num_workers; w++) {
+    auto e = worker_evaluators[w].get();
+    pool->submit([&, e, num_candidates]() {
+      int64_t i;
+      while ((i = next++) < num_candidates && i < found) {
+        if (check(*e, candidates[i], seq, max_total)) {
+          auto current = found.load();
+          while (i < current && !found.compare_exchange_weak(current, i)) {
           }
         }
       }
-    }
-    global_change = global_change || local_change;
+    });
   }
-  return global_change;
+  pool->wait();
+  return found < num_candidates ? found.load() : -1;
 }
 
 bool Minimizer::check(const Program& p, const Sequence& seq,
                       size_t max_total) const {
+  return check(evaluator, p, seq, max_total);
+}
+
+bool Minimizer::check(Evaluator& e, const Program& p, const Sequence& seq,
+                      size_t max_total) {
   try {
-    auto res = evaluator.check(p, seq);
+    // abort on the first wrong term or if the steps exceed the maximum
+    auto res = e.check(p, seq, -1, UID(), max_total);
     if (res.first != status_t::OK) {
       return false;
     }
-    if (max_total > 0 && res.second.total > max_total) {
-      return false;
-    }
   } catch (const std::exception&) {
     return false;
   }
@@ -208,15 +348,22 @@ void dumpProgram(const Program& p) {
   ProgramUtil::print(p, out);
 }
 
-bool Minimizer::optimizeAndMinimize(Program& p, size_t num_terms) const {
+bool Minimizer::optimizeAndMinimize(Program& p, size_t num_terms) {
+  const bool use_cache = caching && ResultCache::isCacheable(p);
+  bool result = false;
+  if (use_cache &&
+      ResultCache::get().lookup(p, num_terms, settings, p, result)) {
+    return result;
+  }
   Program backup = p;
   try {
     std::set<Program> stages;
-    bool optimized = false, minimized = false, result = false;
+    bool optimized = false, minimized = false, fixpoint = true;
     do {
       if (stages.find(p) != stages.end()) {
         Log::get().warn("Detected optimization/minimization loop");
         dumpProgram(p);
+        fixpoint = false;
         break;
       }
       stages.insert(p);
@@ -224,6 +371,15 @@ bool Minimizer::optimizeAndMinimize(Program& p, size_t num_terms) const {
       minimized = minimize(p, num_terms);
       result = result || optimized || minimized;
     } while (optimized || minimized);
+    if (use_cache && !Signals::HALT) {
+      auto& cache = ResultCache::get();
+      cache.insert(backup, num_terms, settings, p, result);
+      if (fixpoint) {
+        // the result cannot be optimized or minimized further
+        cache.insert(p, 0, settings, p, false);
+        cache.insert(p, num_terms, settings, p, false);
+      }
+    }
     return result;
   } catch (std::exception& e) {
     // revert change
@@ -1,29 +1,61 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 #include "eval/evaluator.hpp"
 #include "eval/optimizer.hpp"
 #include "lang/program.hpp"
 #include "sys/util.hpp"
 
+class ThreadPool;
+
 class Minimizer {
  public:
-  explicit Minimizer(const Settings &settings)
-      : settings(settings),
-        optimizer(settings),
-        evaluator(settings, EVAL_ALL, false) {}
+  explicit Minimizer(const Settings &settings);
+
+  ~Minimizer();
+
+  Minimizer(const Minimizer &) = delete;
+  Minimizer &operator=(const Minimizer &) = delete;
+
+  // Check candidate programs concurrently using the given number of threads.
+  // The result of the minimization does not depend on the number of threads.
+  void setNumThreads(size_t num_threads);
 
   bool minimize(Program &p, size_t num_terms) const;
 
-  bool optimizeAndMinimize(Program &p, size_t num_terms) const;
+  // Optimize and minimize until a fixpoint is reached. Results are looked up
+  // in and added to the shared result cache if caching is enabled.
+  bool optimizeAndMinimize(Program &p, size_t num_terms);
+
+  void setCaching(bool enabled);
 
   static int64_t getPowerOf(const Number &v);
 
  private:
   bool replaceConstantLoop(Program &p, const Sequence &seq, int64_t exp) const;
 
+  bool removeOperations(Program &p, const Sequence &seq,
+                        size_t max_total) const;
+
+  bool replaceGcd(Program &p, size_t i, const Sequence &seq) const;
+
+  // Returns the index of the first candidate that passes the check, or -1.
+  int64_t findFirstValid(const std::vector<Program> &candidates,
+                         const Sequence &seq, size_t max_total) const;
+
   bool check(const Program &p, const Sequence &seq, size_t max_total) const;
 
+  static bool check(Evaluator &e, const Program &p, const Sequence &seq,
+                    size_t max_total);
+
   Settings settings;
   Optimizer optimizer;
   mutable Evaluator evaluator;
+  bool caching;
+
+  // used for checking candidates concurrently
+  std::unique_ptr<ThreadPool> pool;
+  std::vector<std::unique_ptr<Evaluator>> worker_evaluators;
 };
@@ -1,78 +1,127 @@
 #include "eval/optimizer.hpp"
 
+#include <chrono>
+#include <functional>
 #include <map>
 #include <set>
 #include <stack>
 
 #include "eval/evaluator_par.hpp"
 #include "eval/interpreter.hpp"
+#include "eval/result_cache.hpp"
 #include "eval/semantics.hpp"
 #include "lang/program_util.hpp"
 #include "sys/log.hpp"
+#include "sys/trace.hpp"
 #include "sys/util.hpp"
 
-bool Optimizer::optimize(Program &p) const {
+using OptimizerPass = std::function<bool(Optimizer &, Program &)>;
+
+// passes in the order they are executed in optimize(). Attention:
+// fixSandwich() should be executed directly before mergeOps()
+const std::vector<std::pair<std::string, OptimizerPass>> OPTIMIZER_PASSES = {
+    {"collapseMovChains", &Optimizer::collapseMovChains},
+    {"simplifyOperations", &Optimizer::simplifyOperations},
+    {"fixSandwich", &Optimizer::fixSandwich},
+    {"mergeOps", &Optimizer::mergeOps},
+    {"mergeRepeated", &Optimizer::mergeRepeated},
+    {"removeNops", &Optimizer::removeNops},
+    {"removeEmptyLoops", &Optimizer::removeEmptyLoops},
+    {"reduceMemoryCells", &Optimizer::reduceMemoryCells},
+    {"partialEval", &Optimizer::partialEval},
+    {"sortOperations", &Optimizer::sortOperations},
+    {"mergeLoops", &Optimizer::mergeLoops},
+    {"collapseMovLoops", &Optimizer::collapseMovLoops},
+    {"collapseDifLoops", &Optimizer::collapseDifLoops},
+    {"collapseArithmeticLoops", &Optimizer::collapseArithmeticLoops},
+    {"pullUpMov", &Optimizer::pullUpMov},
+    {"removeCommutativeDetour", &Optimizer::removeCommutativeDetour}};
+
+Optimizer::Optimizer(const Settings &settings)
+    : settings(settings),
+      profiling(Log::get().level == Log::Level::DEBUG),
+      caching(true),
+      program_version(-1),
+      largest_used_version(-1),
+      largest_used_valid(false),
+      largest_used_cell(0) {}
+
+Optimizer::~Optimizer() = default;
+
+Optimizer::Optimizer(const Optimizer &other) : Optimizer(other.settings) {
+  profiling = other.profiling;
+  caching = other.caching;
+}
+
+bool Optimizer::optimize(Program &p) {
+  if (!caching || !ResultCache::isCacheable(p)) {
+    return runPasses(p);
+  }
+  auto &cache = ResultCache::get();
+  bool changed;
+  if (cache.lookup(p, 0, settings, p, changed)) {
+    return changed;
+  }
+  const Program input = p;
+  changed = runPasses(p);
+  if (!Signals::HALT) {
+    cache.insert(input, 0, settings, p, changed);
+  }
+  return changed;
+}
+
+bool Optimizer::runPasses(Program &p) {
   if (Log::get().level == Log::Level::DEBUG) {
     Log::get().debug("Starting optimization of program with " +
                      std::to_string(p.ops.size()) + " operations");
   }
+  if (profiling && pass_stats.empty()) {
+    for (const auto &pass : OPTIMIZER_PASSES) {
+      pass_stats.push_back({pass.first});
+    }
+  }
+  // passes are deterministic, hence a pass that did not change the program
+  // does not need to run again until another pass changes it
+  std::vector<int64_t> unchanged_version(OPTIMIZER_PASSES.size(), -1);
+  program_version = 0;
+  largest_used_version = -1;
   bool changed = true;
   bool result = false;
   while (changed) {
     changed = false;
-    if (collapseMovChains(p)) {
-      changed = true;
-    }
-    if (simplifyOperations(p)) {
-      changed = true;
-    }
-    {
-      // attention: fixSandwich() should be executed directly before mergeOps()
-      if (fixSandwich(p)) {
-        changed = true;
+    for (size_t i = 0; i < OPTIMIZER_PASSES.size(); i++) {
+      if (unchanged_version[i] == program_version) {
+        if (profiling) {
+          pass_stats[i].skipped++;
+        }
+        continue;
       }
-      if (mergeOps(p)) {
-        changed = true;
+      Trace::Span span("optimizer", OPTIMIZER_PASSES[i].first.c_str());
+      bool pass_changed;
+      if (profiling) {
+        auto start_time = std::chrono::steady_clock::now();
+        pass_changed = OPTIMIZER_PASSES[i].second(*this, p);
+        auto end_time = std::chrono::steady_clock::now();
+        auto &stats = pass_stats[i];
+        stats.invocations++;
+        stats.changes += pass_changed;
+        stats.microseconds +=
+            std::chrono::duration_cast<std::chrono::microseconds>(end_time -
+                                                                  start_time)
+                .count();
+      } else {
+        pass_changed = OPTIMIZER_PASSES[i].second(*this, p);
       }
-      if (mergeRepeated(p)) {
+      if (pass_changed) {
+        program_version++;
         changed = true;
+      } else {
+        unchanged_version[i] = program_version;
       }
     }
-    if (removeNops(p)) {
-      changed = true;
-    }
-    if (removeEmptyLoops(p)) {
-      changed = true;
-    }
-    if (reduceMemoryCells(p)) {
-      changed = true;
-    }
-    if (partialEval(p)) {
-      changed = true;
-    }
-    if (sortOperations(p)) {
-      changed = true;
-    }
-    if (mergeLoops(p)) {
-      changed = true;
-    }
-    if (collapseMovLoops(p)) {
-      changed = true;
-    }
-    if (collapseDifLoops(p)) {
-      changed = true;
-    }
-    if (collapseArithmeticLoops(p)) {
-      changed = true;
-    }
-    if (pullUpMov(p)) {
-      changed = true;
-    }
-    if (removeCommutativeDetour(p)) {
-      changed = true;
-    }
     result = result || changed;
   }
+  program_version = -1;
   if (Log::get().level == Log::Level::DEBUG) {
     Log::get().debug("Finished optimization; program now has " +
                      std::to_string(p.ops.size()) + " operations");
@@ -80,6 +129,16 @@ bool Optimizer::optimize(Program &p) const {
   return result;
 }
 
+bool Optimizer::getLargestUsedCell(const Program &p, int64_t &largest) {
+  if (program_version < 0 || largest_used_version != program_version) {
+    largest_used_valid = ProgramUtil::getUsedMemoryCells(
+        p, nullptr, nullptr, largest_used_cell, settings.max_memory);
+    largest_used_version = program_version;
+  }
+  largest = largest_used_cell;
+  return largest_used_valid;
+}
+
 bool Optimizer::removeNops(Program &p) const {
   bool removed = false;
   auto it = p.ops.begin();
@@ -413,7 +472,7 @@ std::pair<int64_t, int64_t> findConsecutiveMovOps(const Program &p,
   return pos;
 }
 
-bool Optimizer::mergeRepeated(Program &p) const {
+bool Optimizer::mergeRepeated(Program &p) {
   // merge consecutive mov operations into fil/clr
   auto mov_pos = findConsecutiveMovOps(p, 3);
   if (mov_pos.first != -1) {
@@ -454,8 +513,7 @@ bool Optimizer::mergeRepeated(Program &p) const {
                                    ? Operation::Type::MUL
                                    : Operation::Type::POW;
   int64_t largest = 0;
-  if (!ProgramUtil::getUsedMemoryCells(p, nullptr, nullptr, largest,
-                                       settings.max_memory)) {
+  if (!getLargestUsedCell(p, largest)) {
     return false;
   }
   Operand tmp_cell(Operand::Type::DIRECT, largest + 1);
@@ -740,13 +798,15 @@ bool Optimizer::reduceMemoryCells(Program &p) const {
   return false;
 }
 
-bool Optimizer::partialEval(Program &p) const {
+bool Optimizer::partialEval(Program &p) {
   int64_t largest_used = 0;
-  if (!ProgramUtil::getUsedMemoryCells(p, nullptr, nullptr, largest_used,
-                                       settings.max_memory)) {
+  if (!getLargestUsedCell(p, largest_used)) {
     return false;
   }
-  PartialEvaluator eval(settings);
+  if (!partial_evaluator) {
+    partial_evaluator.reset(new PartialEvaluator(settings));
+  }
+  auto &eval = *partial_evaluator;
   eval.initZeros(NUM_INITIALIZED_CELLS, largest_used);
   bool changed = false;
   for (size_t i = 0; i < p.ops.size(); i++) {
@@ -770,7 +830,7 @@ bool Optimizer::partialEval(Program &p) const {
   return changed;
 }
 
-bool Optimizer::sortOperations(Program &p) const {
+bool Optimizer::sortOperations(Program &p) {
   opMover.init(p);
   for (size_t i = 0; i < p.ops.size(); i++) {
     int64_t oldScore = 0, maxScore = 0;
@@ -1,13 +1,44 @@
 #pragma once
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "lang/program.hpp"
 #include "sys/util.hpp"
 
+class PartialEvaluator;
+
 class Optimizer {
  public:
-  explicit Optimizer(const Settings &settings) : settings(settings) {}
+  explicit Optimizer(const Settings &settings);
+
+  ~Optimizer();
+
+  Optimizer(const Optimizer &other);
+
+  Optimizer &operator=(const Optimizer &other) = delete;
+
+  // Run all passes until none of them changes the program anymore. A pass is
+  // only rerun if the program was changed since its last run. Results are
+  // looked up in and added to the shared result cache if caching is enabled.
+  bool optimize(Program &p);
 
-  bool optimize(Program &p) const;
+  void setCaching(bool enabled) { caching = enabled; }
+
+  struct PassStats {
+    std::string name;
+    size_t invocations = 0;
+    size_t changes = 0;
+    size_t skipped = 0;
+    int64_t microseconds = 0;
+  };
+
+  // Collect per-pass statistics in optimize(). Enabled by default if the log
+  // level is debug.
+  void setProfiling(bool enabled) { profiling = enabled; }
+
+  const std::vector<PassStats> &getPassStats() const { return pass_stats; }
 
   bool removeNops(Program &p) const;
 
@@ -15,7 +46,7 @@ class Optimizer {
 
   bool mergeOps(Program &p) const;
 
-  bool mergeRepeated(Program &p) const;
+  bool mergeRepeated(Program &p);
 
   bool simplifyOperations(Program &p) const;
 
@@ -25,9 +56,9 @@ class Optimizer {
 
   bool canChangeVariableOrder(const Program &p) const;
 
-  bool partialEval(Program &p) const;
+  bool partialEval(Program &p);
 
-  bool sortOperations(Program &p) const;
+  bool sortOperations(Program &p);
 
   bool mergeLoops(Program &p) const;
 
@@ -47,6 +78,8 @@ class Optimizer {
   static constexpr size_t NUM_INITIALIZED_CELLS = 1;
 
  private:
+  bool runPasses(Program &p);
+
   /*
    * Helper class for moving operations.
    */
@@ -67,6 +100,20 @@ class Optimizer {
     int64_t totalScore;
   };
 
+  bool getLargestUsedCell(const Program &p, int64_t &largest);
+
   Settings settings;
-  mutable OperationMover opMover;
+  OperationMover opMover;
+  std::unique_ptr<PartialEvaluator> partial_evaluator;
+  bool profiling;
+  bool caching;
+  std::vector<PassStats> pass_stats;
+
+  // version of the program during optimize(); -1 otherwise
+  int64_t program_version;
+
+  // cached result of getLargestUsedCell()
+  int64_t largest_used_version;
+  bool largest_used_valid;
+  int64_t largest_used_cell;
 };
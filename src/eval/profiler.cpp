@@ -0,0 +1,158 @@
+#include "eval/profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <stack>
+
+#include "lang/program_util.hpp"
+#include "sys/util.hpp"
+
+namespace {
+
+std::string formatNanos(int64_t nanos) {
+  if (nanos < 1000) {
+    return std::to_string(nanos) + "ns";
+  } else if (nanos < 1000000) {
+    std::stringstream buf;
+    buf.setf(std::ios::fixed);
+    buf.precision(1);
+    buf << nanos / 1000.0 << "µs";
+    return buf.str();
+  }
+  return formatDuration(nanos / 1000);
+}
+
+// right-aligns a string to the given number of UTF-8 characters
+std::string alignRight(const std::string& s, size_t width) {
+  size_t length = 0;
+  for (char c : s) {
+    if ((c & 0xC0) != 0x80) {
+      length++;
+    }
+  }
+  return std::string(length < width ? width - length : 0, ' ') + s;
+}
+
+std::string formatPercent(double part, double total) {
+  std::stringstream buf;
+  buf.setf(std::ios::fixed);
+  buf.precision(1);
+  buf << (total > 0 ? 100.0 * part / total : 0.0) << "%";
+  return buf.str();
+}
+
+}  // namespace
+
+Profiler::ProgramStats& Profiler::getStats(const Program& p) {
+  auto it = programs.find(&p);
+  if (it == programs.end()) {
+    it = programs.emplace(&p, ProgramStats()).first;
+    it->second.ops.resize(p.ops.size());
+    order.push_back(&p);
+  }
+  return it->second;
+}
+
+void Profiler::clear() {
+  programs.clear();
+  order.clear();
+}
+
+void Profiler::print(std::ostream& out) const {
+  auto sorted = order;
+  if (sorted.size() > 1) {
+    std::stable_sort(sorted.begin() + 1, sorted.end(),
+                     [&](const Program* a, const Program* b) {
+                       return programs.at(a).nanos > programs.at(b).nanos;
+                     });
+  }
+  size_t steps = 0, arithmetic = 0, big = 0;
+  int64_t largest_cell = 0;
+  for (auto p : sorted) {
+    const auto& stats = programs.at(p);
+    printProgram(*p, stats, out);
+    out << std::endl;
+    for (const auto& op : stats.ops) {
+      steps += op.count;
+      arithmetic += op.arithmetic;
+      big += op.big;
+    }
+    largest_cell = std::max(largest_cell, stats.largest_cell);
+  }
+  if (sorted.empty()) {
+    return;
+  }
+  const auto& main = programs.at(sorted.front());
+  out << "Total time:           " << formatNanos(main.nanos) << std::endl;
+  out << "Executed operations:  " << steps << std::endl;
+  out << "Big number ratio:     " << formatPercent(big, arithmetic) << " ("
+      << big << " of " << arithmetic << " arithmetic operations)"
+      << std::endl;
+  out << "Largest used cell:    $" << largest_cell << std::endl;
+}
+
+void Profiler::printProgram(const Program& p, const ProgramStats& stats,
+                            std::ostream& out) const {
+  // find the matching loop ends
+  std::vector<size_t> loop_end(p.ops.size(), 0);
+  std::stack<size_t> loop_begin;
+  for (size_t i = 0; i < p.ops.size(); i++) {
+    if (p.ops[i].type == Operation::Type::LPB) {
+      loop_begin.push(i);
+    } else if (p.ops[i].type == Operation::Type::LPE && !loop_begin.empty()) {
+      loop_end[loop_begin.top()] = i;
+      loop_begin.pop();
+    }
+  }
+  int64_t total = 0;
+  size_t steps = 0;
+  for (const auto& op : stats.ops) {
+    total += op.nanos;
+    steps += op.count;
+  }
+  const std::string name =
+      stats.id.number() == 0 ? "main program" : stats.id.string();
+  out << "; " << name << ": " << stats.runs << " runs, "
+      << formatNanos(stats.nanos) << ", " << steps
+      << " operations, largest used cell $" << stats.largest_cell << std::endl;
+  out << ";      count        time       %  operation" << std::endl;
+  int indent = 0;
+  for (size_t i = 0; i < p.ops.size(); i++) {
+    const auto& op = p.ops[i];
+    const auto& s = stats.ops[i];
+    if (op.type == Operation::Type::NOP) {
+      continue;
+    }
+    if (op.type == Operation::Type::LPE) {
+      indent -= 2;
+    }
+    out << std::setw(12) << s.count << alignRight(formatNanos(s.nanos), 12)
+        << alignRight(formatPercent(s.nanos, total), 8) << "  ";
+    auto plain = op;
+    plain.comment.clear();
+    ProgramUtil::print(plain, out, indent);
+    std::string note;
+    if (op.type == Operation::Type::LPB && loop_end[i] > i) {
+      // the loop end is executed once per iteration
+      const size_t iterations = stats.ops[loop_end[i]].count;
+      int64_t body = 0;
+      for (size_t j = i + 1; j <= loop_end[i]; j++) {
+        body += stats.ops[j].nanos;
+      }
+      note = std::to_string(iterations) + " iterations";
+      if (iterations > 0) {
+        note += ", avg body " + formatNanos(body / iterations);
+      }
+    } else if (s.big > 0) {
+      note = "big numbers " + formatPercent(s.big, s.arithmetic);
+    }
+    if (!note.empty()) {
+      out << "  ; " << note;
+    }
+    out << std::endl;
+    if (op.type == Operation::Type::LPB) {
+      indent += 2;
+    }
+  }
+}
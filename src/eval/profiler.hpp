@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include "base/uid.hpp"
+#include "lang/program.hpp"
+
+// Collects per-operation statistics of interpreter runs. The statistics are
+// kept per program, so that the time spent in programs called using seq or
+// prg operations is attributed to the called programs as well. The time of
+// a seq or prg operation includes the time of the called program.
+class Profiler {
+ public:
+  struct OpStats {
+    size_t count = 0;
+    int64_t nanos = 0;
+    size_t arithmetic = 0;  // executions of arithmetic operations
+    size_t big = 0;         // arithmetic executions with big numbers
+  };
+
+  struct ProgramStats {
+    UID id;
+    std::vector<OpStats> ops;
+    size_t runs = 0;
+    int64_t nanos = 0;  // total time of completed runs
+    int64_t largest_cell = 0;
+  };
+
+  using time_point = std::chrono::time_point<std::chrono::steady_clock>;
+
+  // Returns the statistics of a program. Programs are identified by their
+  // address, i.e. they must not be moved or modified while profiling.
+  ProgramStats& getStats(const Program& p);
+
+  void addRun(ProgramStats& stats, time_point start) const {
+    stats.runs++;
+    stats.nanos += elapsedNanos(start);
+  }
+
+  void addOp(ProgramStats& stats, size_t pc, time_point start) const {
+    auto& op = stats.ops[pc];
+    op.count++;
+    op.nanos += elapsedNanos(start);
+  }
+
+  static int64_t elapsedNanos(time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  // Prints the profiled programs as annotated listings followed by a
+  // summary. The first profiled program is printed first, the called
+  // programs by descending total time.
+  void print(std::ostream& out) const;
+
+  void clear();
+
+ private:
+  void printProgram(const Program& p, const ProgramStats& stats,
+                    std::ostream& out) const;
+
+  std::map<const Program*, ProgramStats> programs;
+  std::vector<const Program*> order;
+};
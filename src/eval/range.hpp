@@ -12,6 +12,11 @@ class Range {
   Range(const Number& lower, const Number& upper)
       : lower_bound(lower), upper_bound(upper) {}
 
+  bool operator==(const Range& r) const {
+    return lower_bound == r.lower_bound && upper_bound == r.upper_bound;
+  }
+  bool operator!=(const Range& r) const { return !(*this == r); }
+
   Range& operator+=(const Range& r);
   Range& operator-=(const Range& r);
   Range& operator*=(const Range& r);
@@ -0,0 +1,100 @@
+#include "eval/range_cache.hpp"
+
+#include "lang/program_util.hpp"
+
+bool RangeCache::Key::operator==(const Key &k) const {
+  return hash == k.hash && offset == k.offset &&
+         input_upper_bound == k.input_upper_bound;
+}
+
+std::size_t RangeCache::KeyHasher::operator()(const Key &k) const {
+  return k.hash ^ (static_cast<size_t>(k.offset) << 32) ^
+         (k.input_upper_bound.hash() * 31);
+}
+
+RangeCache::RangeCache(size_t max_entries)
+    : max_entries(max_entries), num_hits(0), num_misses(0) {}
+
+RangeCache &RangeCache::get() {
+  static RangeCache cache;
+  return cache;
+}
+
+RangeCache::Key RangeCache::makeKey(const Program &p,
+                                    const Number &input_upper_bound) {
+  Key key;
+  key.hash = ProgramUtil::hash(p);
+  key.offset = ProgramUtil::getOffset(p);
+  key.input_upper_bound = input_upper_bound;
+  return key;
+}
+
+bool RangeCache::lookup(const Program &p, const Number &input_upper_bound,
+                        bool &ok, Range &output) {
+  const auto key = makeKey(p, input_upper_bound);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto range = index.equal_range(key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->ops == p.ops) {
+      num_hits++;
+      entries.splice(entries.begin(), entries, it->second);
+      ok = it->second->ok;
+      output = it->second->output;
+      return true;
+    }
+  }
+  num_misses++;
+  return false;
+}
+
+void RangeCache::insert(const Program &p, const Number &input_upper_bound,
+                        bool ok, const Range &output) {
+  Entry entry;
+  entry.key = makeKey(p, input_upper_bound);
+  entry.ops = p.ops;
+  entry.ok = ok;
+  entry.output = output;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto range = index.equal_range(entry.key);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second->ops == p.ops) {
+      entries.erase(it->second);
+      index.erase(it);
+      break;
+    }
+  }
+  entries.push_front(std::move(entry));
+  index.emplace(entries.front().key, entries.begin());
+  while (entries.size() > max_entries) {
+    auto last = std::prev(entries.end());
+    auto candidates = index.equal_range(last->key);
+    for (auto it = candidates.first; it != candidates.second; ++it) {
+      if (it->second == last) {
+        index.erase(it);
+        break;
+      }
+    }
+    entries.pop_back();
+  }
+}
+
+size_t RangeCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void RangeCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  index.clear();
+}
+
+size_t RangeCache::getNumHits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_hits;
+}
+
+size_t RangeCache::getNumMisses() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_misses;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "eval/range.hpp"
+#include "lang/program.hpp"
+
+// Bounded cache of output ranges of programs, shared by all evaluators and
+// range generators. Entries are keyed by the program hash, the offset and the
+// input upper bound. The operations are stored as well to rule out hash
+// collisions. Failed range generations are cached, too. Least recently used
+// entries are evicted first.
+class RangeCache {
+ public:
+  static constexpr size_t DEFAULT_MAX_ENTRIES = 10000;
+
+  explicit RangeCache(size_t max_entries = DEFAULT_MAX_ENTRIES);
+
+  // Shared instance.
+  static RangeCache &get();
+
+  bool lookup(const Program &p, const Number &input_upper_bound, bool &ok,
+              Range &output);
+
+  void insert(const Program &p, const Number &input_upper_bound, bool ok,
+              const Range &output);
+
+  size_t size() const;
+
+  void clear();
+
+  size_t getNumHits() const;
+  size_t getNumMisses() const;
+
+ private:
+  struct Key {
+    size_t hash;
+    int64_t offset;
+    Number input_upper_bound;
+    bool operator==(const Key &k) const;
+  };
+
+  struct KeyHasher {
+    std::size_t operator()(const Key &k) const;
+  };
+
+  struct Entry {
+    Key key;
+    std::vector<Operation> ops;
+    bool ok;
+    Range output;
+  };
+
+  using EntryList = std::list<Entry>;
+
+  static Key makeKey(const Program &p, const Number &input_upper_bound);
+
+  mutable std::mutex mutex;
+  size_t max_entries;
+  EntryList entries;  // most recently used first
+  std::unordered_multimap<Key, EntryList::iterator, KeyHasher> index;
+  size_t num_hits;
+  size_t num_misses;
+};
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <unordered_set>
 
+#include "eval/range_cache.hpp"
 #include "eval/semantics.hpp"
 #include "lang/program_util.hpp"
 #include "sys/log.hpp"
@@ -41,6 +42,19 @@ bool RangeGenerator::generate(const Program& program, RangeMap& ranges) {
   return true;
 }
 
+bool RangeGenerator::generateOutput(const Program& program, Range& output) {
+  auto& cache = RangeCache::get();
+  bool ok;
+  if (cache.lookup(program, input_upper_bound, ok, output)) {
+    return ok;
+  }
+  RangeMap ranges;
+  ok = generate(program, ranges);
+  output = ok ? ranges.get(Program::OUTPUT_CELL) : Range(Number::INF, Number::INF);
+  cache.insert(program, input_upper_bound, ok, output);
+  return ok;
+}
+
 bool RangeGenerator::annotate(Program& program) {
   std::vector<RangeMap> collected;
   bool ok = collect(program, collected);
@@ -60,8 +74,33 @@ bool RangeGenerator::collect(const Program& program,
   if (!init(program, ranges)) {
     return false;
   }
+  const RangeMap init_ranges = ranges;
+  // reuse the ranges of the common loop-free prefix of the last program
+  size_t num_reused = 0;
+  if (ranges == prefix_init) {
+    while (num_reused < prefix_ops.size() &&
+           num_reused < program.ops.size() &&
+           program.ops[num_reused] == prefix_ops[num_reused]) {
+      num_reused++;
+    }
+  } else {
+    prefix_init = ranges;
+  }
+  prefix_ops.resize(num_reused);
+  prefix_ranges.resize(num_reused);
+  for (size_t i = 0; i < num_reused; ++i) {
+    if (is_range_before_op) {
+      collected.push_back(i == 0 ? init_ranges : prefix_ranges[i - 1]);
+    } else {
+      collected.push_back(prefix_ranges[i]);
+    }
+  }
+  if (num_reused > 0) {
+    ranges = prefix_ranges.back();
+  }
   bool ok = true, hasLoops = false;
-  for (auto& op : program.ops) {
+  for (size_t i = num_reused; i < program.ops.size(); ++i) {
+    auto& op = program.ops[i];
     if (is_range_before_op) {
       collected.push_back(ranges);
     }
@@ -73,12 +112,18 @@ bool RangeGenerator::collect(const Program& program,
       collected.push_back(ranges);
     }
     hasLoops = hasLoops || op.type == Operation::Type::LPB;
+    if (!hasLoops) {
+      prefix_ops.push_back(op);
+      prefix_ranges.push_back(ranges);
+    }
   }
-  // compute fixed point if the program has loops
+  // compute fixed point if the program has loops. The ranges of the
+  // loop-free prefix do not change, so only the rest is recomputed.
+  const size_t prefix_size = prefix_ops.size();
   for (size_t i = 0; i < program.ops.size() && ok && hasLoops; ++i) {
-    ranges = {};
-    init(program, ranges);
-    for (size_t j = 0; j < program.ops.size(); ++j) {
+    ranges = prefix_size > 0 ? prefix_ranges.back() : init_ranges;
+    loop_states = {};
+    for (size_t j = prefix_size; j < program.ops.size(); ++j) {
       auto& op = program.ops[j];
       if (op.type == Operation::Type::LPB) {
         auto loop = ProgramUtil::getEnclosingLoop(program, j);
@@ -247,11 +292,9 @@ bool RangeGenerator::handleSeqOperation(const Operation& op, Range& target) {
   } else {
     program_cache.collect(uid);  // ensures that there is no recursion
     RangeGenerator gen;
-    RangeMap tmp;
-    if (!gen.generate(program_cache.getProgram(uid), tmp)) {
+    if (!gen.generateOutput(program_cache.getProgram(uid), target)) {
       return false;
     }
-    target = tmp.get(Program::OUTPUT_CELL);
     seq_range_cache[uid] = target;
   }
   return true;
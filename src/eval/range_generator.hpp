@@ -42,6 +42,15 @@ class RangeGenerator {
    */
   bool generate(const Program& program, RangeMap& ranges);
 
+  /**
+   * Computes the range of the output cell after running the program. The
+   * result is looked up in and stored to the shared range cache.
+   * @param program The LODA program to analyze.
+   * @param output Output: range of the output cell.
+   * @return True if successful, false otherwise.
+   */
+  bool generateOutput(const Program& program, Range& output);
+
   /**
    * Annotates each operation in the program with a comment describing the range
    * of its target cell.
@@ -106,4 +115,11 @@ class RangeGenerator {
   ProgramCache program_cache;
   std::map<UID, Range> seq_range_cache;
   std::stack<LoopState> loop_states;
+
+  // Loop-free prefix of the last analyzed program. Its ranges are reused if
+  // the next program has the same initial ranges and starts with the same
+  // operations, which is typical for mutated programs.
+  RangeMap prefix_init;
+  std::vector<Operation> prefix_ops;
+  std::vector<RangeMap> prefix_ranges;  // ranges after each prefix operation
 };
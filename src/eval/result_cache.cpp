@@ -0,0 +1,241 @@
+#include "eval/result_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "lang/parser.hpp"
+#include "lang/program_util.hpp"
+#include "sys/log.hpp"
+
+const std::string ResultCache::FILENAME("result_cache.txt");
+
+const std::string RESULT_CACHE_HEADER("LODA result cache");
+
+// FNV-1a hash, which is stable across platforms and runs
+class Fingerprint {
+ public:
+  Fingerprint() : value(0xcbf29ce484222325ULL) {}
+
+  void add(const std::string& str) {
+    for (char c : str) {
+      value = (value ^ static_cast<uint8_t>(c)) * 0x100000001b3ULL;
+    }
+    value = (value ^ 0xff) * 0x100000001b3ULL;  // separator
+  }
+
+  uint64_t value;
+};
+
+bool ResultCache::Key::operator==(const Key& k) const {
+  return hash == k.hash && fingerprint == k.fingerprint &&
+         num_terms == k.num_terms && settings == k.settings;
+}
+
+std::size_t ResultCache::KeyHasher::operator()(const Key& k) const {
+  return k.fingerprint ^ (k.hash * 31) ^ (k.num_terms << 48) ^ k.settings;
+}
+
+ResultCache::ResultCache(size_t max_entries)
+    : max_entries(max_entries), num_hits(0), num_misses(0) {}
+
+ResultCache& ResultCache::get() {
+  static ResultCache cache;
+  return cache;
+}
+
+bool ResultCache::isCacheable(const Program& p) {
+  for (const auto& op : p.ops) {
+    if (op.type == Operation::Type::SEQ || op.type == Operation::Type::PRG) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ResultCache::Key ResultCache::makeKey(const Program& p, size_t num_terms,
+                                      const Settings& settings) {
+  Key key;
+  key.hash = ProgramUtil::hash(p);
+  Fingerprint f;
+  for (const auto& d : p.directives) {
+    f.add("#" + d.first + " " + std::to_string(d.second));
+  }
+  for (const auto& op : p.ops) {
+    f.add(ProgramUtil::operationToString(op));
+  }
+  key.fingerprint = f.value;
+  key.num_terms = num_terms;
+  Fingerprint s;
+  s.add(std::to_string(settings.num_terms));
+  s.add(std::to_string(settings.max_memory));
+  s.add(std::to_string(settings.max_cycles));
+  key.settings = s.value;
+  return key;
+}
+
+bool ResultCache::lookup(const Program& in, size_t num_terms,
+                         const Settings& settings, Program& out,
+                         bool& changed) {
+  const auto key = makeKey(in, num_terms, settings);
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(key);
+  if (it == index.end()) {
+    num_misses++;
+    return false;
+  }
+  num_hits++;
+  entries.splice(entries.begin(), entries, it->second);
+  changed = it->second->changed;
+  out = changed ? it->second->program : in;
+  return true;
+}
+
+void ResultCache::insert(const Program& in, size_t num_terms,
+                         const Settings& settings, const Program& out,
+                         bool changed) {
+  Entry entry;
+  entry.key = makeKey(in, num_terms, settings);
+  entry.changed = changed;
+  if (changed) {
+    entry.program = out;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  insertEntry(std::move(entry));
+}
+
+void ResultCache::insertEntry(Entry&& entry) {
+  auto it = index.find(entry.key);
+  if (it != index.end()) {
+    entries.erase(it->second);
+    index.erase(it);
+  }
+  entries.push_front(std::move(entry));
+  index[entries.front().key] = entries.begin();
+  while (entries.size() > max_entries) {
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+void ResultCache::setMaxEntries(size_t max) {
+  std::lock_guard<std::mutex> lock(mutex);
+  max_entries = max;
+  while (entries.size() > max_entries) {
+    index.erase(entries.back().key);
+    entries.pop_back();
+  }
+}
+
+size_t ResultCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+void ResultCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+  index.clear();
+}
+
+size_t ResultCache::getNumHits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_hits;
+}
+
+size_t ResultCache::getNumMisses() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_misses;
+}
+
+void ResultCache::resetCounts() {
+  std::lock_guard<std::mutex> lock(mutex);
+  num_hits = 0;
+  num_misses = 0;
+}
+
+bool ResultCache::load(const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  if (!std::getline(in, line) ||
+      line != RESULT_CACHE_HEADER + " " + Version::VERSION) {
+    Log::get().debug("Ignoring outdated result cache " + path);
+    return false;
+  }
+  std::vector<Entry> loaded;
+  Parser parser;
+  size_t num_lines;
+  try {
+    while (std::getline(in, line)) {
+      Entry entry;
+      std::istringstream header(line);
+      if (!(header >> entry.key.hash >> entry.key.fingerprint >>
+            entry.key.num_terms >> entry.key.settings >> entry.changed >>
+            num_lines)) {
+        throw std::runtime_error("invalid entry: " + line);
+      }
+      std::string text;
+      for (size_t i = 0; i < num_lines && std::getline(in, line); i++) {
+        text += line + "\n";
+      }
+      if (entry.changed) {
+        std::istringstream program_in(text);
+        entry.program = parser.parse(program_in);
+      }
+      loaded.emplace_back(std::move(entry));
+    }
+  } catch (const std::exception& e) {
+    Log::get().warn("Error loading result cache " + path + ": " + e.what());
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& entry : loaded) {
+    insertEntry(std::move(entry));
+  }
+  Log::get().debug("Loaded " + std::to_string(loaded.size()) +
+                   " entries from result cache");
+  return true;
+}
+
+void ResultCache::save(const std::string& path) const {
+  const auto tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::trunc);
+    out << RESULT_CACHE_HEADER << " " << Version::VERSION << "\n";
+    std::lock_guard<std::mutex> lock(mutex);
+    // least recently used first, so that loading restores the order
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      std::vector<std::string> lines;
+      for (const auto& d : it->program.directives) {
+        lines.push_back("#" + d.first + " " + std::to_string(d.second));
+      }
+      bool skip = false;
+      for (const auto& op : it->program.ops) {
+        lines.push_back(ProgramUtil::operationToString(op));
+        skip = skip || lines.back().empty();  // not preserved by the parser
+      }
+      if (skip) {
+        continue;
+      }
+      out << it->key.hash << " " << it->key.fingerprint << " "
+          << it->key.num_terms << " " << it->key.settings << " "
+          << it->changed << " " << lines.size() << "\n";
+      for (const auto& l : lines) {
+        out << l << "\n";
+      }
+    }
+    if (!out) {
+      Log::get().error("Error writing result cache " + tmp, true);
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    Log::get().warn("Cannot replace result cache " + path + ": " +
+                    ec.message());
+    std::filesystem::remove(tmp, ec);
+  }
+}
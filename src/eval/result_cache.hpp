@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "lang/program.hpp"
+#include "sys/util.hpp"
+
+// Bounded cache of optimizer and minimizer results. Entries are keyed by two
+// independent hashes of the input program (including comments), the number
+// of minimization terms (zero for optimizer results) and the settings that
+// affect the result. Least recently used entries are evicted first.
+class ResultCache {
+ public:
+  static const std::string FILENAME;
+  static constexpr size_t DEFAULT_MAX_ENTRIES = 10000;
+  static constexpr size_t SERVER_MAX_ENTRIES = 100000;
+
+  explicit ResultCache(size_t max_entries = DEFAULT_MAX_ENTRIES);
+
+  // Shared instance used by optimizers and minimizers.
+  static ResultCache &get();
+
+  // Programs calling other programs are not cached, because their results
+  // depend on the called programs.
+  static bool isCacheable(const Program &p);
+
+  bool lookup(const Program &in, size_t num_terms, const Settings &settings,
+              Program &out, bool &changed);
+
+  void insert(const Program &in, size_t num_terms, const Settings &settings,
+              const Program &out, bool changed);
+
+  void setMaxEntries(size_t max_entries);
+
+  size_t size() const;
+
+  void clear();
+
+  size_t getNumHits() const;
+  size_t getNumMisses() const;
+  void resetCounts();
+
+  // Load entries from a file written by save(). Returns false if the file is
+  // missing or was written by a different version.
+  bool load(const std::string &path);
+
+  void save(const std::string &path) const;
+
+ private:
+  struct Key {
+    uint64_t hash;
+    uint64_t fingerprint;
+    uint64_t num_terms;
+    uint64_t settings;
+    bool operator==(const Key &k) const;
+  };
+
+  struct KeyHasher {
+    std::size_t operator()(const Key &k) const;
+  };
+
+  struct Entry {
+    Key key;
+    bool changed;
+    Program program;  // empty if not changed
+  };
+
+  static Key makeKey(const Program &p, size_t num_terms,
+                     const Settings &settings);
+
+  void insertEntry(Entry &&entry);
+
+  mutable std::mutex mutex;
+  size_t max_entries;
+  std::list<Entry> entries;  // most recently used first
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> index;
+  size_t num_hits;
+  size_t num_misses;
+};
@@ -19,7 +19,7 @@ Expression::Expression(Type type, const std::string& name,
 
 Expression::Expression(const Expression& e) { *this = e; }
 
-Expression::Expression(Expression&& e) { *this = std::move(e); }
+Expression::Expression(Expression&& e) noexcept { *this = std::move(e); }
 
 Expression& Expression::operator=(const Expression& e) {
   if (this != &e) {
@@ -31,7 +31,7 @@ Expression& Expression::operator=(const Expression& e) {
   return *this;
 }
 
-Expression& Expression::operator=(Expression&& e) {
+Expression& Expression::operator=(Expression&& e) noexcept {
   if (this != &e) {
     type = e.type;
     name = std::move(e.name);
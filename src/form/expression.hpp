@@ -43,11 +43,11 @@ class Expression {
 
   Expression(const Expression& e);
 
-  Expression(Expression&& e);
+  Expression(Expression&& e) noexcept;
 
   Expression& operator=(const Expression& e);
 
-  Expression& operator=(Expression&& e);
+  Expression& operator=(Expression&& e) noexcept;
 
   inline bool operator==(const Expression& e) const { return compare(e) == 0; }
 
@@ -0,0 +1,62 @@
+#include "form/expression_pool.hpp"
+
+bool ExpressionPool::Node::operator==(const Node& n) const {
+  // children are already interned, so comparing their ids is sufficient
+  return hash == n.hash && type == n.type && name == n.name &&
+         value == n.value && children == n.children;
+}
+
+ExpressionPool::Id ExpressionPool::intern(const Expression& e) {
+  Node node;
+  node.type = e.type;
+  node.name = internName(e.name);
+  node.value = e.value;
+  node.num_terms = 1;
+  std::size_t seed = static_cast<std::size_t>(e.type);
+  seed ^= node.name + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  seed ^= e.value.hash() + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  node.children.reserve(e.children.size());
+  for (const auto& c : e.children) {
+    const auto id = intern(c);
+    node.children.push_back(id);
+    node.num_terms += nodes[id].num_terms;
+    seed ^= nodes[id].hash + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  node.hash = seed;
+  auto it = index.find(node);
+  if (it != index.end()) {
+    return it->second;
+  }
+  const auto id = static_cast<Id>(nodes.size());
+  nodes.push_back(node);
+  index.emplace(std::move(node), id);
+  return id;
+}
+
+ExpressionPool::Id ExpressionPool::internName(const std::string& name) {
+  auto it = name_index.find(name);
+  if (it != name_index.end()) {
+    return it->second;
+  }
+  const auto id = static_cast<Id>(names.size());
+  names.push_back(name);
+  name_index[name] = id;
+  return id;
+}
+
+Expression ExpressionPool::get(Id id) const {
+  const auto& node = nodes.at(id);
+  Expression e(node.type, names[node.name], node.value);
+  e.children.reserve(node.children.size());
+  for (auto c : node.children) {
+    e.children.emplace_back(get(c));
+  }
+  return e;
+}
+
+void ExpressionPool::clear() {
+  nodes.clear();
+  index.clear();
+  names.clear();
+  name_index.clear();
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "form/expression.hpp"
+
+/**
+ * Hash-consed expression storage. Every distinct (sub)expression is stored
+ * exactly once in an arena and identified by a small integer id. Names are
+ * interned, hashes and term counts are computed once per node, and two
+ * interned expressions are structurally equal if and only if their ids are
+ * equal. The pool is append-only, i.e. ids stay valid until clear() is
+ * called.
+ *
+ * Example: in a(n)+a(n-1), the sub-expression n is stored only once.
+ */
+class ExpressionPool {
+ public:
+  using Id = uint32_t;
+
+  // Returns the id of the given expression, adding it if necessary.
+  Id intern(const Expression& e);
+
+  // Returns the id of the given name, adding it if necessary.
+  Id internName(const std::string& name);
+
+  // Reconstructs the expression of the given id.
+  Expression get(Id id) const;
+
+  std::size_t hash(Id id) const { return nodes[id].hash; }
+
+  size_t numTerms(Id id) const { return nodes[id].num_terms; }
+
+  size_t size() const { return nodes.size(); }
+
+  void clear();
+
+ private:
+  struct Node {
+    Expression::Type type;
+    Id name;
+    Number value;
+    std::vector<Id> children;
+    std::size_t hash;
+    size_t num_terms;
+
+    bool operator==(const Node& n) const;
+  };
+
+  struct NodeHasher {
+    std::size_t operator()(const Node& n) const { return n.hash; }
+  };
+
+  std::vector<Node> nodes;
+  std::unordered_map<Node, Id, NodeHasher> index;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, Id> name_index;
+};
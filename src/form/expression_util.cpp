@@ -1,5 +1,6 @@
 #include "form/expression_util.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 
 #include "eval/semantics.hpp"
@@ -133,22 +134,22 @@ bool pullUpChildren(Expression& e) {
   if (e.type != Expression::Type::SUM && e.type != Expression::Type::PRODUCT) {
     return false;
   }
-  Expression result(e.type, e.name, e.value);
-  bool changed = false;
-  for (const auto& c : e.children) {
+  if (std::none_of(e.children.begin(), e.children.end(),
+                   [&](const Expression& c) { return c.type == e.type; })) {
+    return false;
+  }
+  std::vector<Expression> children;
+  for (auto& c : e.children) {
     if (c.type == e.type) {
-      for (const auto& d : c.children) {
-        result.newChild(d);
+      for (auto& d : c.children) {
+        children.emplace_back(std::move(d));
       }
-      changed = true;
     } else {
-      result.newChild(c);
+      children.emplace_back(std::move(c));
     }
   }
-  if (changed) {
-    e = result;
-  }
-  return changed;
+  e.children = std::move(children);
+  return true;
 }
 
 bool multiplyThrough(Expression& e) {
@@ -164,8 +165,8 @@ bool multiplyThrough(Expression& e) {
   if (e.children[1].type != Expression::Type::SUM) {
     return false;
   }
-  auto constant = e.children[0];  // copy
-  auto sum = e.children[1];       // copy
+  auto constant = std::move(e.children[0]);
+  auto sum = std::move(e.children[1]);
   e.type = Expression::Type::SUM;
   e.children.clear();
   for (const auto& c : sum.children) {
@@ -216,7 +217,8 @@ bool removeNeutral(Expression& e) {
     e = neutralExpr;
     changed = true;
   } else if (e.children.size() == 1) {
-    e = Expression(e.children[0]);  // copy first
+    Expression child = std::move(e.children[0]);
+    e = std::move(child);
     changed = true;
   }
   return changed;
@@ -283,7 +285,7 @@ bool ExpressionUtil::isSimpleFunction(const Expression& e, bool strict) {
   if (e.type != Expression::Type::FUNCTION || e.children.size() != 1) {
     return false;
   }
-  const auto arg = e.children.front();
+  const auto& arg = e.children.front();
   if (strict) {
     return arg.type == Expression::Type::PARAMETER;
   } else {
@@ -304,7 +306,7 @@ bool ExpressionUtil::isInitialTerm(const Expression& e) {
       e.children.size() != 1) {
     return false;
   }
-  const auto arg = e.children.front();
+  const auto& arg = e.children.front();
   return arg.type == Expression::Type::CONSTANT;
 }
 
@@ -0,0 +1,71 @@
+#include "form/formula_cache.hpp"
+
+FormulaCache::FormulaCache(size_t max_entries) : max_entries(max_entries) {}
+
+FormulaCache& FormulaCache::get() {
+  static FormulaCache cache;
+  return cache;
+}
+
+bool FormulaCache::lookup(UID id, size_t program_hash, int64_t offset,
+                          Entry& entry) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find({id, offset});
+  if (it == index.end() || it->second->program_hash != program_hash) {
+    num_misses++;
+    return false;
+  }
+  num_hits++;
+  items.splice(items.begin(), items, it->second);
+  entry = it->second->entry;
+  return true;
+}
+
+void FormulaCache::insert(UID id, size_t program_hash, int64_t offset,
+                          const Entry& entry) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const Key key(id, offset);
+  auto it = index.find(key);
+  if (it != index.end()) {
+    // replaces outdated entries of changed programs
+    items.erase(it->second);
+    index.erase(it);
+  }
+  items.push_front({key, program_hash, entry});
+  index[key] = items.begin();
+  evict();
+}
+
+void FormulaCache::evict() {
+  while (items.size() > max_entries) {
+    index.erase(items.back().key);
+    items.pop_back();
+  }
+}
+
+void FormulaCache::setMaxEntries(size_t max) {
+  std::lock_guard<std::mutex> lock(mutex);
+  max_entries = max;
+  evict();
+}
+
+size_t FormulaCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return items.size();
+}
+
+void FormulaCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  items.clear();
+  index.clear();
+}
+
+size_t FormulaCache::getNumHits() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_hits;
+}
+
+size_t FormulaCache::getNumMisses() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_misses;
+}
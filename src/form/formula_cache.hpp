@@ -0,0 +1,68 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "base/uid.hpp"
+#include "form/formula.hpp"
+
+/**
+ * Thread-safe and bounded cache of single formulas generated for
+ * dependencies, i.e. programs that are referenced using seq operations.
+ * Formulas are stored together with the first function name index used to
+ * generate them, so that callers can rename them to their first free name
+ * index. The generated formula also depends on the offset of the calling
+ * program, which is part of the key. Entries are invalidated if the program
+ * hash of a dependency changes. Failed generations are cached as well. Least
+ * recently used entries are evicted first.
+ */
+class FormulaCache {
+ public:
+  static constexpr size_t DEFAULT_MAX_ENTRIES = 10000;  // magic number
+
+  struct Entry {
+    bool success = false;
+    Formula formula;
+    std::map<int64_t, std::string> cell_names;
+    size_t name_base = 0;  // first function name index
+    size_t num_names = 0;
+  };
+
+  explicit FormulaCache(size_t max_entries = DEFAULT_MAX_ENTRIES);
+
+  // Shared instance used by formula generators.
+  static FormulaCache& get();
+
+  bool lookup(UID id, size_t program_hash, int64_t offset, Entry& entry);
+
+  void insert(UID id, size_t program_hash, int64_t offset, const Entry& entry);
+
+  void setMaxEntries(size_t max_entries);
+
+  size_t size() const;
+
+  void clear();
+
+  size_t getNumHits() const;
+  size_t getNumMisses() const;
+
+ private:
+  using Key = std::pair<UID, int64_t>;
+
+  struct Item {
+    Key key;
+    size_t program_hash;
+    Entry entry;
+  };
+
+  void evict();
+
+  mutable std::mutex mutex;
+  size_t max_entries;
+  std::list<Item> items;  // most recently used first
+  std::map<Key, std::list<Item>::iterator> index;
+  size_t num_hits = 0;
+  size_t num_misses = 0;
+};
@@ -2,25 +2,31 @@
 
 const UID FACTORIAL_SEQ_ID('A', 142);
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <stdexcept>
+#include <vector>
 
 #include "form/expression_util.hpp"
+#include "form/formula_cache.hpp"
 #include "form/formula_simplify.hpp"
 #include "form/formula_util.hpp"
 #include "form/variant.hpp"
 #include "lang/parser.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
 #include "seq/managed_seq.hpp"
 #include "sys/log.hpp"
+#include "sys/trace.hpp"
 
 FormulaGenerator::FormulaGenerator()
     : interpreter(settings),
       incEval(interpreter),
       freeNameIndex(0),
       offset(0),
-      maxInitialTerms(10) {}
+      maxInitialTerms(10),
+      useCache(false) {}
 
 std::string FormulaGenerator::newName() {
   std::string name = "a" + std::to_string(freeNameIndex);
@@ -728,16 +734,25 @@ void FormulaGenerator::simplifyFunctionNames() {
   }
 }
 
+Program loadDependency(UID id) {
+  auto corpus = ProgramCorpus::getDefault();
+  Program p;
+  if (!corpus || !corpus->getProgram(id, p)) {
+    Parser parser;
+    p = parser.parse(ProgramUtil::getProgramPath(id));
+  }
+  return p;
+}
+
 bool addProgramIds(const Program& p, std::set<int64_t>& ids) {
   // TODO: check for recursion
-  Parser parser;
   for (const auto& op : p.ops) {
     if (op.type == Operation::Type::SEQ) {
       auto id = op.source.value.asInt();
       if (ids.find(id) == ids.end()) {
         ids.insert(id);
         try {
-          auto q = parser.parse(ProgramUtil::getProgramPath(UID('A', id)));
+          auto q = loadDependency(UID('A', id));
           addProgramIds(q, ids);
         } catch (const std::exception&) {
           return false;
@@ -748,8 +763,90 @@ bool addProgramIds(const Program& p, std::set<int64_t>& ids) {
   return true;
 }
 
+// Returns the positions of the function names with the given indices when
+// sorted as strings, e.g. "a10" comes before "a9".
+static std::vector<size_t> getNameOrder(size_t nameBase, size_t numNames) {
+  std::vector<std::pair<std::string, size_t>> names;
+  for (size_t i = 0; i < numNames; i++) {
+    names.emplace_back("a" + std::to_string(nameBase + i), i);
+  }
+  std::sort(names.begin(), names.end());
+  std::vector<size_t> order;
+  for (const auto& n : names) {
+    order.push_back(n.second);
+  }
+  return order;
+}
+
+// Renames the function names of a cached dependency formula, so that they
+// start at the given name index.
+static void shiftNames(FormulaCache::Entry& entry, size_t nameBase) {
+  if (entry.name_base == nameBase) {
+    return;
+  }
+  // rename in an order that avoids clashes with names not yet renamed
+  std::map<std::string, std::string> renamed;
+  for (size_t k = 0; k < entry.num_names; k++) {
+    const size_t i = nameBase > entry.name_base ? entry.num_names - 1 - k : k;
+    const auto from = "a" + std::to_string(entry.name_base + i);
+    const auto to = "a" + std::to_string(nameBase + i);
+    entry.formula.replaceName(from, to);
+    renamed[from] = to;
+  }
+  for (auto& c : entry.cell_names) {
+    auto it = renamed.find(c.second);
+    if (it != renamed.end()) {
+      c.second = it->second;
+    }
+  }
+  entry.name_base = nameBase;
+}
+
+bool FormulaGenerator::generateDependency(UID id, const Program& p) {
+  // the result depends on the offset of the main program, so it is part of
+  // the cache key; cached formulas are renamed for the current free name
+  // index if the sort order of the names does not change
+  FormulaCache::Entry entry;
+  const auto hash = ProgramUtil::hash(p);
+  const auto nameBase = freeNameIndex;
+  if (useCache && FormulaCache::get().lookup(id, hash, offset, entry) &&
+      (!entry.success ||
+       getNameOrder(entry.name_base, entry.num_names) ==
+           getNameOrder(nameBase, entry.num_names))) {
+    if (entry.success) {
+      shiftNames(entry, nameBase);
+      formula = entry.formula;
+      cellNames = entry.cell_names;
+      freeNameIndex += entry.num_names;
+    }
+    return entry.success;
+  }
+  entry = FormulaCache::Entry();
+  entry.success = generateSingle(p);
+  if (entry.success) {
+    auto from = getCellName(Program::INPUT_CELL);
+    auto to = id.string();
+    Log::get().debug("Replacing " + from + " by " + to);
+    formula.replaceName(from, to);
+  }
+  if (useCache) {
+    if (entry.success) {
+      entry.formula = formula;
+      entry.cell_names = cellNames;
+      entry.name_base = nameBase;
+      entry.num_names = freeNameIndex - nameBase;
+    }
+    FormulaCache::get().insert(id, hash, offset, entry);
+  }
+  return entry.success;
+}
+
 bool FormulaGenerator::generate(const Program& p, int64_t id, Formula& result,
                                 bool withDeps) {
+  Trace::Span span("formula", "generate");
+  if (span && id > 0) {
+    span.setArg(UID('A', id).string());
+  }
   if (id > 0) {
     UID uid('A', id);
     Log::get().debug("Generating formula for " + uid.string());
@@ -768,7 +865,6 @@ bool FormulaGenerator::generate(const Program& p, int64_t id, Formula& result,
     if (!addProgramIds(p, ids)) {
       return false;
     }
-    Parser parser;
     for (auto id2 : ids) {
       if (id2 == FACTORIAL_SEQ_ID.number()) {
         continue;  // Skip dependency for A000142 (factorial)
@@ -777,19 +873,15 @@ bool FormulaGenerator::generate(const Program& p, int64_t id, Formula& result,
       Log::get().debug("Adding dependency " + uid2.string());
       Program p2;
       try {
-        p2 = parser.parse(ProgramUtil::getProgramPath(uid2));
+        p2 = loadDependency(uid2);
       } catch (const std::exception&) {
         result.clear();
         return false;
       }
-      if (!generateSingle(p2)) {
+      if (!generateDependency(uid2, p2)) {
         result.clear();
         return false;
       }
-      auto from = getCellName(Program::INPUT_CELL);
-      auto to = uid2.string();
-      Log::get().debug("Replacing " + from + " by " + to);
-      formula.replaceName(from, to);
       result.entries.insert(formula.entries.begin(), formula.entries.end());
     }
   }
@@ -30,9 +30,14 @@ class FormulaGenerator {
 
   bool generate(const Program& p, int64_t id, Formula& result, bool withDeps);
 
+  // Enable the shared cache for formulas of dependencies.
+  void setCaching(bool caching) { useCache = caching; }
+
  private:
   bool generateSingle(const Program& p);
 
+  bool generateDependency(UID id, const Program& p);
+
   void initFormula(int64_t numCells, bool useIncEval);
 
   Expression divToFraction(const Expression& numerator,
@@ -77,4 +82,5 @@ class FormulaGenerator {
   size_t freeNameIndex;
   int64_t offset;
   int64_t maxInitialTerms;
+  bool useCache;
 };
@@ -138,7 +138,7 @@ void replaceFunction(Expression& target, const std::string& func,
   auto updated = val;
   updated.replaceAll(param, target.children.front());
   ExpressionUtil::normalize(updated);
-  target = updated;
+  target = std::move(updated);
 }
 
 void FormulaSimplify::resolveSimpleFunctions(Formula& formula) {
@@ -155,6 +155,7 @@ void FormulaSimplify::resolveSimpleFunctions(Formula& formula) {
   // filter out non-simple functions
   auto deps = FormulaUtil::getDependencies(formula, Expression::Type::FUNCTION,
                                            false, false);
+  const auto functions = FormulaUtil::getDefinitions(formula);
   for (auto& e : formula.entries) {
     if (e.first.type != Expression::Type::FUNCTION) {
       continue;  // should not happen
@@ -164,8 +165,7 @@ void FormulaSimplify::resolveSimpleFunctions(Formula& formula) {
     if (!ExpressionUtil::isSimpleFunction(e.first)) {
       is_simple = false;
     }
-    for (auto it : deps) {
-      auto functions = FormulaUtil::getDefinitions(formula);
+    for (const auto& it : deps) {
       if (it.first == f && std::find(functions.begin(), functions.end(),
                                      it.second) != functions.end()) {
         is_simple = false;
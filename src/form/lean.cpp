@@ -11,6 +11,7 @@
 #include "sys/log.hpp"
 #include "sys/process.hpp"
 #include "sys/setup.hpp"
+#include "sys/trace.hpp"
 #include "sys/util.hpp"
 
 // cannot use "lean" here because it is a reserved package name
@@ -357,6 +358,7 @@ std::string getLeanProjectDir() {
 
 bool LeanFormula::eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
                        Sequence& result) const {
+  Trace::Span span("tool", "lean");
   // Initialize LEAN project if needed (only once)
   bool needsProject = !imports.empty();
   if (needsProject && !initializeLeanProject()) {
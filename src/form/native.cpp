@@ -0,0 +1,364 @@
+#include "form/native.hpp"
+
+#include <stdexcept>
+
+#include "eval/semantics.hpp"
+#include "form/expression_util.hpp"
+
+// built-in functions with their number of arguments
+static const std::map<std::string, size_t> NATIVE_BUILTINS = {
+    {"abs", 1},      {"binomial", 2}, {"bitand", 2},    {"bitor", 2},
+    {"bitxor", 2},   {"floor", 1},    {"gcd", 2},       {"logint", 2},
+    {"max", 2},      {"min", 2},      {"sign", 1},      {"sqrtint", 1},
+    {"sqrtnint", 2}, {"sumdigits", 2}, {"truncate", 1}};
+
+// maximum recursion depth of function calls (magic number)
+static constexpr size_t MAX_NATIVE_DEPTH = 2000;
+
+namespace {
+
+class NativeTimeout : public std::runtime_error {
+ public:
+  NativeTimeout() : std::runtime_error("timeout") {}
+};
+
+}  // namespace
+
+static void throwUndefined(const Expression& e) {
+  throw std::runtime_error("undefined value: " + e.toString());
+}
+
+static Number checkDefined(const Number& n, const Expression& e) {
+  if (n == Number::INF) {
+    throwUndefined(e);
+  }
+  return n;
+}
+
+static Number floorDiv(const Number& a, const Number& b) {
+  auto q = Semantics::div(a, b);
+  if (Semantics::mod(a, b) != Number::ZERO &&
+      ((a < Number::ZERO) != (b < Number::ZERO))) {
+    q = Semantics::sub(q, Number::ONE);
+  }
+  return q;
+}
+
+bool NativeFormula::isSupported(
+    const Expression& e, const std::map<std::string, Function>& functions) {
+  for (const auto& c : e.children) {
+    if (!isSupported(c, functions)) {
+      return false;
+    }
+  }
+  switch (e.type) {
+    case Expression::Type::CONSTANT:
+    case Expression::Type::PARAMETER:
+    case Expression::Type::SUM:
+    case Expression::Type::PRODUCT:
+      return true;
+    case Expression::Type::FRACTION:
+    case Expression::Type::POWER:
+    case Expression::Type::MODULUS:
+    case Expression::Type::EQUAL:
+    case Expression::Type::NOT_EQUAL:
+    case Expression::Type::LESS_EQUAL:
+    case Expression::Type::GREATER_EQUAL:
+      return e.children.size() == 2;
+    case Expression::Type::LOCAL:
+      return e.children.size() == 2;
+    case Expression::Type::IF:
+      return e.children.size() == 3;
+    case Expression::Type::FACTORIAL:
+      return e.children.size() == 1;
+    case Expression::Type::FUNCTION: {
+      if (functions.find(e.name) != functions.end()) {
+        return e.children.size() == 1;
+      }
+      auto it = NATIVE_BUILTINS.find(e.name);
+      return it != NATIVE_BUILTINS.end() && it->second == e.children.size();
+    }
+    case Expression::Type::VECTOR:
+      return false;
+  }
+  return false;
+}
+
+bool NativeFormula::convert(const Formula& formula, int64_t offset,
+                            bool as_vector, NativeFormula& native_formula) {
+  native_formula = {};
+  native_formula.main_formula = formula;
+  auto& functions = native_formula.functions;
+  for (const auto& entry : formula.entries) {
+    const auto& left = entry.first;
+    if (left.type != Expression::Type::FUNCTION || left.children.size() != 1 ||
+        NATIVE_BUILTINS.find(left.name) != NATIVE_BUILTINS.end()) {
+      return false;
+    }
+    auto& f = functions[left.name];
+    const auto& arg = left.children.front();
+    if (arg.type == Expression::Type::PARAMETER) {
+      if (f.has_definition) {
+        return false;
+      }
+      f.param = arg.name;
+      f.definition = entry.second;
+      f.has_definition = true;
+    } else if (arg.type == Expression::Type::CONSTANT) {
+      f.initial_terms[arg.value] = entry.second;
+    } else {
+      return false;
+    }
+  }
+  if (functions.find("a") == functions.end()) {
+    return false;
+  }
+  for (const auto& entry : formula.entries) {
+    if (!isSupported(entry.second, functions)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string NativeFormula::toString() const {
+  return main_formula.toString();
+}
+
+bool NativeFormula::eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
+                         Sequence& result) const {
+  for (const auto& f : functions) {
+    f.second.values.clear();
+  }
+  depth = 0;
+  num_steps = 0;
+  deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+  result.clear();
+  const auto& main = functions.at("a");
+  try {
+    for (int64_t n = offset; n < offset + numTerms; n++) {
+      result.push_back(call(main, Number(n)));
+    }
+  } catch (const NativeTimeout&) {
+    return false;
+  }
+  return true;
+}
+
+void NativeFormula::checkTimeout() const {
+  if (++num_steps % 1024 == 0 &&
+      std::chrono::steady_clock::now() > deadline) {
+    throw NativeTimeout();
+  }
+}
+
+Number NativeFormula::call(const Function& f, const Number& arg) const {
+  auto it = f.values.find(arg);
+  if (it != f.values.end()) {
+    return it->second;
+  }
+  if (depth >= MAX_NATIVE_DEPTH) {
+    throw std::runtime_error("maximum recursion depth exceeded");
+  }
+  depth++;
+  Number value;
+  Params params;
+  try {
+    auto init = f.initial_terms.find(arg);
+    if (init != f.initial_terms.end()) {
+      value = eval(init->second, params);
+    } else if (f.has_definition) {
+      params.emplace_back(f.param, arg);
+      value = eval(f.definition, params);
+    } else {
+      throw std::runtime_error("missing definition for argument " +
+                               arg.to_string());
+    }
+  } catch (...) {
+    depth--;
+    throw;
+  }
+  depth--;
+  f.values[arg] = value;
+  return value;
+}
+
+Number NativeFormula::eval(const Expression& e, Params& params) const {
+  checkTimeout();
+  switch (e.type) {
+    case Expression::Type::CONSTANT:
+      return e.value;
+    case Expression::Type::PARAMETER: {
+      for (auto it = params.rbegin(); it != params.rend(); ++it) {
+        if (it->first == e.name) {
+          return it->second;
+        }
+      }
+      throw std::runtime_error("unknown parameter: " + e.name);
+    }
+    case Expression::Type::SUM: {
+      auto r = Number::ZERO;
+      for (const auto& c : e.children) {
+        r = checkDefined(Semantics::add(r, eval(c, params)), e);
+      }
+      return r;
+    }
+    case Expression::Type::PRODUCT: {
+      auto r = Number::ONE;
+      for (const auto& c : e.children) {
+        r = checkDefined(Semantics::mul(r, eval(c, params)), e);
+      }
+      return r;
+    }
+    case Expression::Type::FRACTION: {
+      // only exact divisions are supported outside of floor/truncate
+      auto a = eval(e.children[0], params);
+      auto b = eval(e.children[1], params);
+      if (b == Number::ZERO || Semantics::mod(a, b) != Number::ZERO) {
+        throwUndefined(e);
+      }
+      return checkDefined(Semantics::div(a, b), e);
+    }
+    case Expression::Type::POWER: {
+      auto a = eval(e.children[0], params);
+      auto b = eval(e.children[1], params);
+      if (b < Number::ZERO && a != Number::ONE && a != -1) {
+        throwUndefined(e);  // not an integer
+      }
+      return checkDefined(Semantics::pow(a, b), e);
+    }
+    case Expression::Type::MODULUS: {
+      // the result is non-negative as in PARI/GP
+      auto a = eval(e.children[0], params);
+      auto b = eval(e.children[1], params);
+      if (b == Number::ZERO) {
+        throwUndefined(e);
+      }
+      auto r = Semantics::mod(a, b);
+      if (r < Number::ZERO) {
+        r = Semantics::add(r, Semantics::abs(b));
+      }
+      return checkDefined(r, e);
+    }
+    case Expression::Type::IF: {
+      auto n = eval(ExpressionUtil::newParameter(), params);
+      if (n == eval(e.children[0], params)) {
+        return eval(e.children[1], params);
+      }
+      return eval(e.children[2], params);
+    }
+    case Expression::Type::LOCAL: {
+      params.emplace_back(e.name, eval(e.children[0], params));
+      Number r;
+      try {
+        r = eval(e.children[1], params);
+      } catch (...) {
+        params.pop_back();
+        throw;
+      }
+      params.pop_back();
+      return r;
+    }
+    case Expression::Type::FACTORIAL: {
+      auto n = eval(e.children[0], params);
+      if (n < Number::ZERO) {
+        throwUndefined(e);
+      }
+      return checkDefined(Semantics::fac(Number::ONE, n), e);
+    }
+    case Expression::Type::EQUAL:
+      return Semantics::equ(eval(e.children[0], params),
+                            eval(e.children[1], params));
+    case Expression::Type::NOT_EQUAL:
+      return Semantics::neq(eval(e.children[0], params),
+                            eval(e.children[1], params));
+    case Expression::Type::LESS_EQUAL:
+      return Semantics::leq(eval(e.children[0], params),
+                            eval(e.children[1], params));
+    case Expression::Type::GREATER_EQUAL:
+      return Semantics::geq(eval(e.children[0], params),
+                            eval(e.children[1], params));
+    case Expression::Type::FUNCTION:
+      return evalFunction(e, params);
+    case Expression::Type::VECTOR:
+      break;
+  }
+  throw std::runtime_error("unsupported expression: " + e.toString());
+}
+
+// Evaluate the argument of floor() or truncate(). Fractions and negative
+// powers are rounded instead of requiring an integer result.
+Number NativeFormula::evalRounded(const Expression& e, Params& params,
+                                  bool floor) const {
+  if (e.type == Expression::Type::FRACTION && e.children.size() == 2) {
+    auto a = eval(e.children[0], params);
+    auto b = eval(e.children[1], params);
+    if (b == Number::ZERO) {
+      throwUndefined(e);
+    }
+    return checkDefined(floor ? floorDiv(a, b) : Semantics::div(a, b), e);
+  }
+  if (e.type == Expression::Type::POWER && e.children.size() == 2) {
+    auto a = eval(e.children[0], params);
+    auto b = eval(e.children[1], params);
+    if (b < Number::ZERO) {
+      if (a == Number::ZERO) {
+        throwUndefined(e);
+      }
+      if (a != Number::ONE && a != -1) {
+        // the absolute value of the result is between 0 and 1
+        const bool negative = a < Number::ZERO && b.odd();
+        return (floor && negative) ? Number(-1) : Number::ZERO;
+      }
+    }
+    return checkDefined(Semantics::pow(a, b), e);
+  }
+  return eval(e, params);
+}
+
+Number NativeFormula::evalFunction(const Expression& e,
+                                   Params& params) const {
+  auto f = functions.find(e.name);
+  if (f != functions.end()) {
+    return call(f->second, eval(e.children[0], params));
+  }
+  if (e.name == "floor" || e.name == "truncate") {
+    return evalRounded(e.children[0], params, e.name == "floor");
+  }
+  std::vector<Number> args;
+  for (const auto& c : e.children) {
+    args.push_back(eval(c, params));
+  }
+  Number r;
+  if (e.name == "abs") {
+    r = Semantics::abs(args[0]);
+  } else if (e.name == "sign") {
+    r = (args[0] < Number::ZERO) ? -1 : (args[0] == Number::ZERO ? 0 : 1);
+  } else if (e.name == "sqrtint") {
+    r = Semantics::nrt(args[0], 2);
+  } else if (e.name == "sqrtnint") {
+    r = Semantics::nrt(args[0], args[1]);
+  } else if (e.name == "sumdigits") {
+    r = Semantics::abs(Semantics::dgs(args[0], args[1]));
+  } else if (e.name == "binomial") {
+    r = Semantics::bin(args[0], args[1]);
+  } else if (e.name == "logint") {
+    r = Semantics::log(args[0], args[1]);
+  } else if (e.name == "gcd") {
+    r = Semantics::gcd(args[0], args[1]);
+  } else if (e.name == "min") {
+    r = Semantics::min(args[0], args[1]);
+  } else if (e.name == "max") {
+    r = Semantics::max(args[0], args[1]);
+  } else if (e.name == "bitand") {
+    r = Semantics::ban(args[0], args[1]);
+  } else if (e.name == "bitor") {
+    r = Semantics::bor(args[0], args[1]);
+  } else if (e.name == "bitxor") {
+    r = Semantics::bxo(args[0], args[1]);
+  } else {
+    throw std::runtime_error("unsupported function: " + e.name);
+  }
+  return checkDefined(r, e);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "form/formula.hpp"
+#include "math/sequence.hpp"
+
+/**
+ * Native formula evaluator. Takes a formula as input and evaluates it
+ * in-process using the same semantics as the generated PARI/GP code, but
+ * without invoking external tools. Function values are memoized, so that
+ * recursive definitions are evaluated in linear time.
+ *
+ * Example input formula:
+ * a(n) = n*a(n-1), a(0) = 1
+ */
+class NativeFormula {
+ public:
+  NativeFormula() {}
+
+  // Prepares a formula for evaluation. Returns false if the formula contains
+  // unsupported functions or definitions. The vector flag is ignored.
+  static bool convert(const Formula& formula, int64_t offset, bool as_vector,
+                      NativeFormula& native_formula);
+
+  std::string toString() const;
+
+  // Evaluates the formula for the given offset and number of terms, with a
+  // timeout in seconds. Returns true if successful, false if a timeout
+  // occurred. The result sequence is written to 'result'. Throws an exception
+  // if a term is undefined, e.g. because of a division by zero.
+  bool eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
+            Sequence& result) const;
+
+  std::string getName() const { return "native"; }
+
+ private:
+  struct Function {
+    std::string param;
+    Expression definition;
+    bool has_definition = false;
+    std::map<Number, Expression> initial_terms;
+    mutable std::map<Number, Number> values;
+  };
+
+  using Params = std::vector<std::pair<std::string, Number>>;
+
+  Number eval(const Expression& e, Params& params) const;
+
+  Number evalRounded(const Expression& e, Params& params, bool floor) const;
+
+  Number evalFunction(const Expression& e, Params& params) const;
+
+  Number call(const Function& f, const Number& arg) const;
+
+  static bool isSupported(const Expression& e,
+                          const std::map<std::string, Function>& functions);
+
+  void checkTimeout() const;
+
+  Formula main_formula;
+  std::map<std::string, Function> functions;
+
+  mutable size_t depth = 0;
+  mutable size_t num_steps = 0;
+  mutable std::chrono::time_point<std::chrono::steady_clock> deadline;
+};
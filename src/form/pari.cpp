@@ -7,9 +7,13 @@
 #include "form/formula_util.hpp"
 #include "seq/seq_util.hpp"
 #include "sys/log.hpp"
-#include "sys/process.hpp"
+#include "sys/thread_pool.hpp"
+#include "sys/tool_worker.hpp"
+#include "sys/trace.hpp"
 #include "sys/util.hpp"
 
+const std::string PARI_END_MARKER("LODA-END-OF-OUTPUT");
+
 bool convertExprToPari(Expression& expr, const Formula& f, bool as_vector) {
   // convert bottom-up!
   for (auto& c : expr.children) {
@@ -146,7 +150,8 @@ std::string PariFormula::toString() const {
   }
 }
 
-std::string PariFormula::printEvalCode(int64_t offset, int64_t numTerms) const {
+std::string PariFormula::printEvalCode(int64_t offset, int64_t numTerms,
+                                       bool quit) const {
   std::stringstream out;
 
   if (as_vector) {
@@ -168,13 +173,21 @@ std::string PariFormula::printEvalCode(int64_t offset, int64_t numTerms) const {
   } else {
     out << "print(a(n))";
   }
-  out << ")" << std::endl << "quit" << std::endl;
+  out << ")" << std::endl;
+  if (quit) {
+    out << "quit" << std::endl;
+  }
 
   return out.str();
 }
 
+#ifdef _WIN64
+
 bool PariFormula::eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
                        Sequence& result) const {
+  // tool workers are not supported on Windows, hence run a GP process per
+  // evaluation
+  Trace::Span span("tool", "pari");
   const std::string tmpFileId = std::to_string(Random::get().gen() % 1000);
   const std::string gpPath("pari-loda-" + tmpFileId + ".gp");
   const std::string gpResult("pari-result-" + tmpFileId + ".txt");
@@ -189,9 +202,41 @@ bool PariFormula::eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
       "recover=0",
       "-q",
       gpPath};
-  std::string evalCode = printEvalCode(offset, numTerms);
+  std::string evalCode = printEvalCode(offset, numTerms, true);
   // Provide "quit\n" on stdin to ensure PARI exits break loop cleanly on errors
   return SequenceUtil::evalFormulaWithExternalTool(
       evalCode, getName(), gpPath, gpResult, args, timeoutSeconds, result, "",
       "quit\n");
 }
+
+#else
+
+static ToolWorkerPool& getPariWorkers() {
+  // errors must not be fatal and must not enter the break loop, because the
+  // same GP process is used for subsequent evaluations
+  const int64_t maxparisize = 1024;  // in MB
+  static ToolWorkerPool pool(
+      {"gp", "-s", std::to_string(maxparisize) + "M", "--default",
+       "parisizemax=" + std::to_string(maxparisize) + "M", "--default",
+       "breakloop=0", "-q"},
+      "print(\"" + PARI_END_MARKER + "\")", PARI_END_MARKER,
+      ThreadPool::getDefaultNumThreads());
+  return pool;
+}
+
+bool PariFormula::eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
+                       Sequence& result) const {
+  Trace::Span span("tool", "pari");
+  auto evalCode = printEvalCode(offset, numTerms, false);
+  // remove the definitions, so that later formulas evaluated by the same GP
+  // process cannot use them
+  for (auto type : {Expression::Type::FUNCTION, Expression::Type::VECTOR}) {
+    for (const auto& name : FormulaUtil::getDefinitions(main_formula, type)) {
+      evalCode += "kill(" + name + ")\n";
+    }
+  }
+  return SequenceUtil::evalFormulaWithWorkerPool(
+      evalCode, getName(), getPariWorkers(), timeoutSeconds, result);
+}
+
+#endif
@@ -21,13 +21,15 @@ class PariFormula {
   static bool convert(const Formula& formula, int64_t offset, bool as_vector,
                       PariFormula& pari_formula);
 
-  std::string printEvalCode(int64_t offset, int64_t numTerms) const;
+  std::string printEvalCode(int64_t offset, int64_t numTerms,
+                            bool quit = true) const;
 
   std::string toString() const;
 
   // Evaluates the formula for the given offset and number of terms, with a
   // timeout in seconds. Returns true if successful, false if a timeout
-  // occurred. The result sequence is written to 'result'.
+  // occurred. The result sequence is written to 'result'. The evaluation
+  // uses a shared pool of long-lived GP processes.
   bool eval(int64_t offset, int64_t numTerms, int timeoutSeconds,
             Sequence& result) const;
 
@@ -41,13 +41,13 @@ bool VariantsManager::update(Variant new_variant) {
       new_variant.definition.name == new_variant.func) {
     return false;
   }
-  const auto num_terms = new_variant.definition.numTerms();
+  collectFuncs(new_variant);
+  const auto num_terms = pool.numTerms(new_variant.definition_id);
   if (num_terms > 200) {  // limit term count to reduce complexity
     Log::get().debug("Skipping variant with " + std::to_string(num_terms) +
                      " terms");
     return false;  // too many terms
   }
-  collectFuncs(new_variant);
   // if (new_variant.used_funcs.size() > 3) {  // magic number
   //   return false;
   // }
@@ -57,31 +57,43 @@ bool VariantsManager::update(Variant new_variant) {
     return false;
   }
   // prevent rapid increases of variant sizes
-  if (!std::all_of(vs.begin(), vs.end(), [new_variant](const Variant& v) {
+  if (!std::all_of(vs.begin(), vs.end(), [&new_variant](const Variant& v) {
         return v.used_funcs.size() + 1 >= new_variant.used_funcs.size();
       })) {
     return false;
   }
   for (size_t i = 0; i < vs.size(); i++) {
     if (vs[i].used_funcs == new_variant.used_funcs) {
-      if (num_terms < vs[i].definition.numTerms()) {
+      if (num_terms < pool.numTerms(vs[i].definition_id)) {
         // update existing variant but don't report as new
-        vs[i] = new_variant;
-        debugUpdate("Updated variant to ", new_variant);
+        vs[i] = std::move(new_variant);
+        debugUpdate("Updated variant to ", vs[i]);
       }
       return false;
     }
   }
   // add new variant
-  vs.push_back(new_variant);
-  debugUpdate("Found variant ", new_variant);
+  vs.push_back(std::move(new_variant));
+  debugUpdate("Found variant ", vs.back());
   return true;
 }
 
-void VariantsManager::collectFuncs(Variant& variant) const {
+bool VariantsManager::markCombined(const Variant& target,
+                                   const Variant& lookup) {
+  const std::array<int64_t, 6> key = {pool.internName(target.func),
+                                      target.definition_id,
+                                      target.num_initial_terms,
+                                      pool.internName(lookup.func),
+                                      lookup.definition_id,
+                                      lookup.num_initial_terms};
+  return combined.insert(key).second;
+}
+
+void VariantsManager::collectFuncs(Variant& variant) {
   variant.used_funcs.clear();
   variant.required_funcs.clear();
   collectFuncs(variant, variant.definition);
+  variant.definition_id = pool.intern(variant.definition);
 }
 
 void VariantsManager::collectFuncs(Variant& variant,
@@ -207,12 +219,18 @@ bool gaussElim(const Variant& lookup, Variant& target) {
 }
 
 bool findVariants(VariantsManager& manager) {
-  auto variants = manager.variants;  // copy
+  const auto variants = manager.variants;  // copy
   bool updated = false;
   for (const auto& target : variants) {
     for (const auto& target_variant : target.second) {
       for (const auto& lookup : variants) {
         for (const auto& lookup_variant : lookup.second) {
+          if (lookup_variant.func == target_variant.func ||
+              !target_variant.definition.contains(Expression::Type::FUNCTION,
+                                                  lookup_variant.func) ||
+              !manager.markCombined(target_variant, lookup_variant)) {
+            continue;  // nothing to resolve or already combined
+          }
           auto new_variant = target_variant;  // copy
           if (resolve(lookup_variant, new_variant) &&
               manager.update(new_variant)) {
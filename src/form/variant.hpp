@@ -1,9 +1,11 @@
 #pragma once
 
+#include <array>
 #include <map>
 #include <set>
 #include <vector>
 
+#include "form/expression_pool.hpp"
 #include "form/formula.hpp"
 
 /**
@@ -18,6 +20,7 @@ class Variant {
 
   std::set<std::string> used_funcs;      // derived from definition
   std::set<std::string> required_funcs;  // derived from definition
+  ExpressionPool::Id definition_id = 0;  // derived from definition
 };
 
 /**
@@ -35,10 +38,18 @@ class VariantsManager {
 
   size_t numVariants() const;
 
+  // Returns false if the given pair of variants was already combined.
+  // Combining variants is deterministic and the acceptance criteria of
+  // update() only get stricter, so every pair needs to be tried only once.
+  bool markCombined(const Variant& target, const Variant& lookup);
+
  private:
-  void collectFuncs(Variant& variant) const;
+  void collectFuncs(Variant& variant);
 
   void collectFuncs(Variant& variant, const Expression& expr) const;
+
+  ExpressionPool pool;
+  std::set<std::array<int64_t, 6>> combined;
 };
 
 bool simplifyFormulaUsingVariants(
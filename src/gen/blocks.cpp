@@ -38,7 +38,23 @@ void Blocks::Interface::clear() {
   all.clear();
 }
 
-void Blocks::Collector::add(const Program &p) {
+void Blocks::Collector::add(const Program &p) { collect(p, true); }
+
+void Blocks::Collector::add(const Blocks &b) {
+  for (size_t i = 0; i < b.offsets.size(); i++) {
+    blocks[b.getBlock(i)] += static_cast<size_t>(b.rates[i]);
+  }
+}
+
+void Blocks::Collector::remove(const Program &p) { collect(p, false); }
+
+void Blocks::Collector::merge(const Collector &other) {
+  for (const auto &it : other.blocks) {
+    blocks[it.first] += it.second;
+  }
+}
+
+void Blocks::Collector::collect(const Program &p, bool add) {
   interface.clear();
   Program block;
   for (auto op : p.ops) {
@@ -79,7 +95,7 @@ void Blocks::Collector::add(const Program &p) {
           block.ops.pop_back();
         }
         if (!block.ops.empty()) {
-          blocks[block]++;
+          update(block, add);
           block.ops.clear();
         }
       }
@@ -92,7 +108,18 @@ void Blocks::Collector::add(const Program &p) {
 
   // final block
   if (!block.ops.empty()) {
+    update(block, add);
+  }
+}
+
+void Blocks::Collector::update(const Program &block, bool add) {
+  if (add) {
     blocks[block]++;
+    return;
+  }
+  auto it = blocks.find(block);
+  if (it != blocks.end() && --it->second == 0) {
+    blocks.erase(it);
   }
 }
 
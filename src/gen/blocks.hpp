@@ -26,11 +26,21 @@ class Blocks {
    public:
     void add(const Program& p);
 
+    void add(const Blocks& blocks);
+
+    void remove(const Program& p);
+
+    void merge(const Collector& other);
+
     Blocks finalize();
 
     bool empty() const;
 
    private:
+    void collect(const Program& p, bool add);
+
+    void update(const Program& block, bool add);
+
     Interface interface;  // cached
     std::map<Program, size_t> blocks;
   };
@@ -81,10 +81,10 @@ GeneratorV1::GeneratorV1(const Config &config, const Stats &stats)
   }
 
   // initialize distributions
-  constants.resize(stats.num_constants.size());
-  size_t i = 0;
-  for (const auto &c : stats.num_constants) {
-    constants[i++] = c.first;
+  const auto &snapshot = stats.getSnapshot();
+  constants.resize(snapshot.numConstants());
+  for (size_t i = 0; i < constants.size(); i++) {
+    constants[i] = snapshot.getConstant(i);
   }
 
   constants_dist = constantsDist(constants, stats);
@@ -16,13 +16,12 @@ GeneratorV2::GeneratorV2(const Config &config, const Stats &stats)
   length_dist = std::discrete_distribution<>(probs.begin(), probs.end());
 
   // operations distribution
-  operations.resize(stats.num_operations.size());
-  probs.resize(stats.num_operations.size());
-  i = 0;
-  for (const auto &it : stats.num_operations) {
-    operations[i] = it.first;
-    probs[i] = it.second;
-    i++;
+  const auto &snapshot = stats.getSnapshot();
+  operations.resize(snapshot.numOperations());
+  probs.resize(snapshot.numOperations());
+  for (i = 0; i < snapshot.numOperations(); i++) {
+    operations[i] = snapshot.getOperation(i);
+    probs[i] = snapshot.getOperationCount(i);
   }
   operation_dist = std::discrete_distribution<>(probs.begin(), probs.end());
 }
@@ -29,11 +29,13 @@ GeneratorV3::GeneratorV3(const Config &config, const Stats &stats)
 
   // initialize operation distributions
   OpProb p;
-  for (const auto &it : stats.num_operation_positions) {
-    i = getIndex(it.first.pos, it.first.len);
+  const auto &snapshot = stats.getSnapshot();
+  for (size_t j = 0; j < snapshot.numOperationPositions(); j++) {
+    const auto op_pos = snapshot.getOperationPosition(j);
+    i = getIndex(op_pos.pos, op_pos.len);
     auto &op_dist = operation_dists.at(i);
-    p.operation = it.first.op;
-    p.partial_sum = it.second;
+    p.operation = op_pos.op;
+    p.partial_sum = snapshot.getOperationPositionCount(j);
     if (!op_dist.empty()) {
       p.partial_sum += op_dist.back().partial_sum;
     }
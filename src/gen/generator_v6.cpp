@@ -1,6 +1,7 @@
 #include "gen/generator_v6.hpp"
 
 #include "lang/parser.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
 #include "seq/managed_seq.hpp"
 #include "sys/log.hpp"
@@ -25,11 +26,14 @@ Program GeneratorV6::generateProgram() {
 
 void GeneratorV6::nextProgram() {
   Parser parser;
+  auto corpus = ProgramCorpus::getDefault();
   for (int64_t i = 0; i < 10; i++) {
     const auto id = random_program_ids.get();
     const std::string path = ProgramUtil::getProgramPath(id);
     try {
-      program = parser.parse(path);
+      if (!corpus || !corpus->getProgram(id, program)) {
+        program = parser.parse(path);
+      }
       ProgramUtil::removeOps(program, Operation::Type::NOP);
       // Log::get().info("Loaded template: " + path);
       return;
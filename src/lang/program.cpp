@@ -183,6 +183,18 @@ const Operation::Metadata& Operation::Metadata::get(const std::string& name) {
   throw std::runtime_error("invalid operation: " + name);
 }
 
+const Operation::Metadata* Operation::Metadata::findByRefId(int64_t ref_id) {
+  static const auto by_ref_id = [] {
+    std::map<int64_t, const Metadata*> result;
+    for (auto t : Operation::Types) {
+      result[get(t).ref_id] = &get(t);
+    }
+    return result;
+  }();
+  auto it = by_ref_id.find(ref_id);
+  return it != by_ref_id.end() ? it->second : nullptr;
+}
+
 void Program::push_front(Operation::Type t, Operand::Type tt, const Number& tv,
                          Operand::Type st, const Number& sv) {
   ops.insert(ops.begin(), Operation(t, Operand(tt, tv), Operand(st, sv)));
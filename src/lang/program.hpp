@@ -82,6 +82,9 @@ class Operation {
 
     static const Metadata &get(const std::string &name);
 
+    // Returns nullptr if there is no operation type with this ref ID.
+    static const Metadata *findByRefId(int64_t ref_id);
+
     Type type;
     std::string name;
     int64_t ref_id;
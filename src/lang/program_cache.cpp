@@ -7,16 +7,42 @@
 
 #include "lang/parser.hpp"
 #include "lang/program_util.hpp"
+#include "sys/setup.hpp"
+
+namespace {
+
+int64_t getMemoryUsage(const Program& p) {
+  return sizeof(UID) + sizeof(Program) + p.ops.capacity() * sizeof(Operation) +
+         MemoryBudget::NODE_OVERHEAD;
+}
+
+}  // namespace
+
+ProgramCache::ProgramCache()
+    : use_default_corpus(true),
+      memory_usage(MemoryBudget::Subsystem::PROGRAM_CACHE) {}
 
 const Program& ProgramCache::getProgram(UID id) {
   if (missing.find(id) != missing.end()) {
     throw std::runtime_error("Program not found: " + id.string());
   }
   if (programs.find(id) == programs.end()) {
+    if (use_default_corpus) {
+      use_default_corpus = false;
+      if (Setup::getMiningMode() == MINING_MODE_CLIENT) {
+        corpus = ProgramCorpus::getDefault();
+      }
+    }
+    Program p;
+    if (corpus && corpus->getProgram(id, p)) {
+      memory_usage.add(getMemoryUsage(p));
+      return programs[id] = std::move(p);
+    }
     try {
       Parser parser;
       auto path = ProgramUtil::getProgramPath(id);
-      programs[id] = parser.parse(path);
+      auto& parsed = programs[id] = parser.parse(path);
+      memory_usage.add(getMemoryUsage(parsed));
     } catch (...) {
       missing.insert(id);
       std::rethrow_exception(std::current_exception());
@@ -93,15 +119,26 @@ void ProgramCache::setOverhead(UID id, int64_t overhead) {
 }
 
 void ProgramCache::insert(UID id, const Program& p) {
+  auto it = programs.find(id);
+  if (it != programs.end()) {
+    memory_usage.add(-getMemoryUsage(it->second));
+  }
   programs[id] = p;
+  memory_usage.add(getMemoryUsage(p));
   missing.erase(id);
   offsets.erase(id);
 }
 
+void ProgramCache::setCorpus(std::shared_ptr<const ProgramCorpus> c) {
+  corpus = c;
+  use_default_corpus = false;
+}
+
 void ProgramCache::clear() {
   programs.clear();
   offsets.clear();
   overheads.clear();
   missing.clear();
   skip_check_offsets.clear();
+  memory_usage.set(0);
 }
@@ -1,13 +1,18 @@
 #pragma once
 
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
 #include "base/uid.hpp"
 #include "lang/program.hpp"
+#include "lang/program_corpus.hpp"
+#include "sys/memory_budget.hpp"
 
 class ProgramCache {
  public:
+  ProgramCache();
+
   const Program &getProgram(UID id);
 
   int64_t getOffset(UID id);
@@ -26,10 +31,18 @@ class ProgramCache {
 
   void clear();
 
+  // Use the given corpus for looking up programs before parsing program files.
+  // By default, the shared program corpus is used in client mining mode, where
+  // program files are only changed by updates.
+  void setCorpus(std::shared_ptr<const ProgramCorpus> corpus);
+
  private:
+  std::shared_ptr<const ProgramCorpus> corpus;
+  bool use_default_corpus;
   std::unordered_map<UID, Program> programs;
   std::unordered_map<UID, int64_t> offsets;
   std::unordered_map<UID, int64_t> overheads;
   std::unordered_set<UID> missing;
   std::unordered_set<UID> skip_check_offsets;
+  MemoryBudget::Usage memory_usage;
 };
@@ -0,0 +1,519 @@
+#include "lang/program_corpus.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "lang/parser.hpp"
+#include "lang/program_util.hpp"
+#include "sys/file.hpp"
+#include "sys/git.hpp"
+#include "sys/log.hpp"
+#include "sys/mapped_file.hpp"
+#include "sys/setup.hpp"
+#include "sys/thread_pool.hpp"
+
+const char CORPUS_MAGIC[8] = {'L', 'O', 'D', 'A', 'P', 'R', 'O', 'G'};
+const uint32_t CORPUS_FORMAT_VERSION = 1;
+const uint32_t CORPUS_BYTE_ORDER = 0x01020304;
+
+// flags for operands that do not fit into 64 bits. Their decimal
+// representation is stored in the string pool instead.
+const uint8_t CORPUS_BIG_TARGET = 1;
+const uint8_t CORPUS_BIG_SOURCE = 2;
+
+struct ProgramCorpus::Header {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t byte_order;
+  uint64_t num_programs;
+  uint64_t num_directives;
+  uint64_t num_operations;
+  uint64_t pool_size;
+  uint64_t commit_pos;
+  uint64_t commit_len;
+  uint64_t home_pos;
+  uint64_t home_len;
+};
+
+struct ProgramCorpus::Entry {
+  int64_t id;
+  uint64_t first_operation;
+  uint64_t first_directive;
+  uint32_t num_operations;
+  uint32_t num_directives;
+};
+
+struct ProgramCorpus::OperationRecord {
+  int64_t target;
+  int64_t source;
+  uint64_t comment_pos;
+  uint32_t comment_len;
+  uint8_t type;  // ref ID of the operation type
+  uint8_t target_type;
+  uint8_t source_type;
+  uint8_t flags;
+};
+
+struct ProgramCorpus::DirectiveRecord {
+  uint64_t name_pos;
+  uint64_t name_len;
+  int64_t value;
+};
+
+// all sections must keep the 8-byte alignment of the mapped file
+static_assert(sizeof(ProgramCorpus::Header) == 80, "unexpected header size");
+static_assert(sizeof(ProgramCorpus::Entry) == 32, "unexpected size");
+static_assert(sizeof(ProgramCorpus::OperationRecord) == 32, "unexpected size");
+static_assert(sizeof(ProgramCorpus::DirectiveRecord) == 24, "unexpected size");
+
+// Writes operations and the string pool to temporary files while programs are
+// added, so that building the corpus needs little memory.
+class CorpusWriter {
+ public:
+  explicit CorpusWriter(const std::string& path)
+      : path(path),
+        ops_path(path + ".ops.tmp"),
+        pool_path(path + ".pool.tmp"),
+        ops_out(ops_path, std::ios::binary | std::ios::trunc),
+        pool_out(pool_path, std::ios::binary | std::ios::trunc),
+        num_operations(0),
+        pool_size(0) {
+    if (!ops_out || !pool_out) {
+      Log::get().error("Cannot write program corpus " + path, true);
+    }
+  }
+
+  void add(UID id, const Program& p) {
+    ProgramCorpus::Entry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.id = id.castToInt();
+    entry.first_operation = num_operations;
+    entry.first_directive = directives.size();
+    entry.num_operations = static_cast<uint32_t>(p.ops.size());
+    entry.num_directives = static_cast<uint32_t>(p.directives.size());
+    entries.push_back(entry);
+    for (const auto& d : p.directives) {
+      directives.push_back({addString(d.first), d.first.size(), d.second});
+    }
+    for (const auto& op : p.ops) {
+      ProgramCorpus::OperationRecord r;
+      std::memset(&r, 0, sizeof(r));
+      r.type = static_cast<uint8_t>(Operation::Metadata::get(op.type).ref_id);
+      r.target_type = static_cast<uint8_t>(op.target.type);
+      r.source_type = static_cast<uint8_t>(op.source.type);
+      r.target = encode(op.target.value, r.flags, CORPUS_BIG_TARGET);
+      r.source = encode(op.source.value, r.flags, CORPUS_BIG_SOURCE);
+      if (!op.comment.empty()) {
+        r.comment_pos = addString(op.comment);
+        r.comment_len = static_cast<uint32_t>(op.comment.size());
+      }
+      ops_out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+      num_operations++;
+    }
+  }
+
+  void save(const std::string& commit, const std::string& home) {
+    ProgramCorpus::Header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, CORPUS_MAGIC, sizeof(h.magic));
+    h.format_version = CORPUS_FORMAT_VERSION;
+    h.byte_order = CORPUS_BYTE_ORDER;
+    h.num_programs = entries.size();
+    h.num_directives = directives.size();
+    h.num_operations = num_operations;
+    h.commit_pos = addString(commit);
+    h.commit_len = commit.size();
+    h.home_pos = addString(home);
+    h.home_len = home.size();
+    h.pool_size = pool_size;
+    ops_out.close();
+    pool_out.close();
+    const auto tmp = path + ".tmp";
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+      out.write(reinterpret_cast<const char*>(entries.data()),
+                entries.size() * sizeof(ProgramCorpus::Entry));
+      out.write(reinterpret_cast<const char*>(directives.data()),
+                directives.size() * sizeof(ProgramCorpus::DirectiveRecord));
+      for (const auto& part : {ops_path, pool_path}) {
+        std::ifstream in(part, std::ios::binary);
+        if (in.peek() != EOF) {
+          out << in.rdbuf();
+        }
+      }
+      if (!out) {
+        Log::get().error("Error writing program corpus " + tmp, true);
+      }
+    }
+    std::error_code ec;
+    std::filesystem::remove(ops_path, ec);
+    std::filesystem::remove(pool_path, ec);
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+      // e.g. on Windows if the old corpus is still mapped
+      Log::get().warn("Cannot replace program corpus " + path + ": " +
+                      ec.message());
+      std::filesystem::remove(tmp, ec);
+    }
+  }
+
+  size_t size() const { return entries.size(); }
+
+ private:
+  uint64_t addString(const std::string& s) {
+    const auto pos = pool_size;
+    pool_out.write(s.data(), s.size());
+    pool_size += s.size();
+    return pos;
+  }
+
+  int64_t encode(const Number& n, uint8_t& flags, uint8_t big_flag) {
+    try {
+      if (n.getNumUsedWords() == 1) {
+        const auto value = n.asInt();
+        if (Number(value) == n) {
+          return value;
+        }
+      }
+    } catch (const std::exception&) {
+      // not representable as 64-bit integer
+    }
+    flags |= big_flag;
+    auto pos = addString(n.to_string());
+    addString(std::string(1, '\0'));
+    return pos;
+  }
+
+  const std::string path;
+  const std::string ops_path;
+  const std::string pool_path;
+  std::ofstream ops_out;
+  std::ofstream pool_out;
+  std::vector<ProgramCorpus::Entry> entries;
+  std::vector<ProgramCorpus::DirectiveRecord> directives;
+  uint64_t num_operations;
+  uint64_t pool_size;
+};
+
+ProgramCorpus::ProgramCorpus()
+    : header(nullptr),
+      entries(nullptr),
+      directives(nullptr),
+      operations(nullptr),
+      pool(nullptr) {}
+
+void ProgramCorpus::build(const std::string& path, const std::string& commit) {
+  // collect program IDs
+  std::vector<UID> ids;
+  for (char domain : {'A', 'P', 'V'}) {
+    const auto dir = ProgramUtil::getProgramsDir(domain);
+    if (!isDir(dir)) {
+      continue;
+    }
+    for (const auto& f : std::filesystem::recursive_directory_iterator(dir)) {
+      const auto stem = f.path().stem().string();
+      if (f.is_regular_file() && f.path().extension() == ".asm" &&
+          UID::valid(stem) && stem[0] == domain) {
+        ids.push_back(UID(stem));
+      }
+    }
+  }
+  std::sort(ids.begin(), ids.end());
+  build(path, ids, commit);
+}
+
+void ProgramCorpus::build(const std::string& path, const std::vector<UID>& ids,
+                          const std::string& commit) {
+  Log::get().info("Building program corpus");
+  auto start_time = std::chrono::steady_clock::now();
+
+  // parse programs in parallel and add them in order. Only a limited number
+  // of chunks is kept in memory at the same time.
+  static constexpr size_t CHUNK_SIZE = 1000;  // magic number
+  CorpusWriter writer(path);
+  ThreadPool pool(ThreadPool::getDefaultNumThreads());
+  const size_t num_chunks = (ids.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  const size_t batch_size = 4 * pool.size();  // magic number
+  for (size_t batch = 0; batch < num_chunks; batch += batch_size) {
+    const size_t batch_end = std::min(num_chunks, batch + batch_size);
+    std::vector<std::vector<std::pair<UID, Program>>> chunks(batch_end -
+                                                             batch);
+    for (size_t c = batch; c < batch_end; c++) {
+      pool.submit([&, c]() {
+        Parser parser;
+        auto& chunk = chunks[c - batch];
+        const size_t end = std::min(ids.size(), (c + 1) * CHUNK_SIZE);
+        for (size_t i = c * CHUNK_SIZE; i < end; i++) {
+          const auto file_name = ProgramUtil::getProgramPath(ids[i]);
+          try {
+            chunk.emplace_back(ids[i], parser.parse(file_name));
+          } catch (const std::exception& e) {
+            Log::get().warn("Skipping " + file_name + ": " + e.what());
+          }
+        }
+      });
+    }
+    pool.wait();
+    for (const auto& chunk : chunks) {
+      for (const auto& e : chunk) {
+        writer.add(e.first, e.second);
+      }
+    }
+  }
+  writer.save(commit, Setup::getProgramsHome());
+
+  auto cur_time = std::chrono::steady_clock::now();
+  auto duration =
+      std::chrono::duration_cast<std::chrono::seconds>(cur_time - start_time)
+          .count();
+  Log::get().info("Built program corpus with " +
+                  std::to_string(writer.size()) + " programs in " +
+                  std::to_string(duration) + "s");
+}
+
+bool ProgramCorpus::load(const std::string& path) {
+  std::shared_ptr<const MappedFile> mapped;
+  try {
+    mapped = std::make_shared<MappedFile>(path);
+  } catch (const std::exception& e) {
+    Log::get().debug("Cannot load program corpus: " + std::string(e.what()));
+    return false;
+  }
+  if (!attach(mapped->data(), mapped->size())) {
+    Log::get().warn("Ignoring invalid program corpus " + path);
+    *this = ProgramCorpus();
+    return false;
+  }
+  file = mapped;
+  return true;
+}
+
+std::string ProgramCorpus::getDefaultPath() {
+  return Setup::getCacheHome() + "programs.bin";
+}
+
+std::string ProgramCorpus::getProgramsCommit() {
+  const auto progs_dir = Setup::getProgramsHome();
+  if (!isDir(progs_dir + ".git") || !Git::status(progs_dir).empty()) {
+    return "";
+  }
+  auto commits = Git::log(progs_dir, 1);
+  return commits.empty() ? "" : commits.front();
+}
+
+namespace {
+
+std::mutex default_corpus_mutex;
+std::shared_ptr<const ProgramCorpus> default_corpus;
+bool default_corpus_loaded = false;
+
+}  // namespace
+
+std::shared_ptr<const ProgramCorpus> ProgramCorpus::getDefault() {
+  std::lock_guard<std::mutex> lock(default_corpus_mutex);
+  if (!default_corpus_loaded) {
+    default_corpus_loaded = true;
+    const auto path = getDefaultPath();
+    auto corpus = std::make_shared<ProgramCorpus>();
+    if (isFile(path) && corpus->load(path) &&
+        corpus->getProgramsHome() == Setup::getProgramsHome()) {
+      // programs may have changed since the corpus was built
+      const auto commit = getProgramsCommit();
+      if (!commit.empty() && corpus->getCommit() == commit) {
+        Log::get().debug("Using program corpus " + path);
+        default_corpus = corpus;
+      } else {
+        Log::get().debug("Ignoring outdated program corpus " + path);
+      }
+    }
+  }
+  return default_corpus;
+}
+
+void ProgramCorpus::resetDefault() {
+  std::lock_guard<std::mutex> lock(default_corpus_mutex);
+  default_corpus.reset();
+  default_corpus_loaded = false;
+}
+
+size_t ProgramCorpus::size() const {
+  return header ? header->num_programs : 0;
+}
+
+UID ProgramCorpus::getId(size_t index) const {
+  return UID::castFromInt(entries[index].id);
+}
+
+Program ProgramCorpus::getProgram(size_t index) const {
+  if (!validate(index)) {
+    throw std::runtime_error("Invalid program records in corpus: " +
+                             getId(index).string());
+  }
+  const auto& e = entries[index];
+  Program p;
+  for (uint32_t i = 0; i < e.num_directives; i++) {
+    const auto& d = directives[e.first_directive + i];
+    p.directives[getString(d.name_pos, d.name_len)] = d.value;
+  }
+  p.ops.resize(e.num_operations);
+  for (uint32_t i = 0; i < e.num_operations; i++) {
+    const auto& r = operations[e.first_operation + i];
+    auto& op = p.ops[i];
+    op.type = Operation::Metadata::findByRefId(r.type)->type;
+    op.target = Operand(static_cast<Operand::Type>(r.target_type),
+                        getNumber(r.target, r.flags & CORPUS_BIG_TARGET));
+    op.source = Operand(static_cast<Operand::Type>(r.source_type),
+                        getNumber(r.source, r.flags & CORPUS_BIG_SOURCE));
+    if (r.comment_len) {
+      op.comment = getString(r.comment_pos, r.comment_len);
+    }
+  }
+  return p;
+}
+
+bool ProgramCorpus::getProgram(UID id, Program& program) const {
+  size_t index;
+  if (!find(id, index)) {
+    return false;
+  }
+  if (!validate(index)) {
+    Log::get().warn("Invalid program records in corpus: " + id.string());
+    return false;
+  }
+  program = getProgram(index);
+  return true;
+}
+
+bool ProgramCorpus::exists(UID id) const {
+  size_t index;
+  return find(id, index);
+}
+
+std::string ProgramCorpus::getCommit() const {
+  return header ? getString(header->commit_pos, header->commit_len) : "";
+}
+
+std::string ProgramCorpus::getProgramsHome() const {
+  return header ? getString(header->home_pos, header->home_len) : "";
+}
+
+bool ProgramCorpus::attach(const char* data, size_t size) {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  auto h = reinterpret_cast<const Header*>(data);
+  if (std::memcmp(h->magic, CORPUS_MAGIC, sizeof(h->magic)) != 0 ||
+      h->format_version != CORPUS_FORMAT_VERSION ||
+      h->byte_order != CORPUS_BYTE_ORDER) {
+    return false;
+  }
+  // check the section sizes before computing any pointers
+  const uint64_t limit = size;
+  uint64_t pos = sizeof(Header);
+  const std::pair<uint64_t, uint64_t> sections[] = {
+      {h->num_programs, sizeof(Entry)},
+      {h->num_directives, sizeof(DirectiveRecord)},
+      {h->num_operations, sizeof(OperationRecord)},
+      {h->pool_size, 1}};
+  for (const auto& s : sections) {
+    if (s.first > (limit - pos) / s.second) {
+      return false;
+    }
+    pos += s.first * s.second;
+  }
+  if (pos != limit) {
+    return false;
+  }
+  const char* p = data + sizeof(Header);
+  entries = reinterpret_cast<const Entry*>(p);
+  p += h->num_programs * sizeof(Entry);
+  directives = reinterpret_cast<const DirectiveRecord*>(p);
+  p += h->num_directives * sizeof(DirectiveRecord);
+  operations = reinterpret_cast<const OperationRecord*>(p);
+  p += h->num_operations * sizeof(OperationRecord);
+  pool = p;
+
+  // validate the header strings and the index eagerly; the records of the
+  // individual programs are validated when they are accessed
+  if (!validString(h, h->commit_pos, h->commit_len) ||
+      !validString(h, h->home_pos, h->home_len)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < h->num_programs; i++) {
+    const auto& e = entries[i];
+    if ((i > 0 && entries[i - 1].id >= e.id) ||
+        e.first_operation > h->num_operations ||
+        e.num_operations > h->num_operations - e.first_operation ||
+        e.first_directive > h->num_directives ||
+        e.num_directives > h->num_directives - e.first_directive) {
+      return false;
+    }
+  }
+  header = h;
+  return true;
+}
+
+bool ProgramCorpus::validString(const Header* h, uint64_t pos,
+                                uint64_t len) {
+  return pos <= h->pool_size && len <= h->pool_size - pos;
+}
+
+bool ProgramCorpus::validNumber(int64_t value, bool big) const {
+  return !big ||
+         (value >= 0 && static_cast<uint64_t>(value) < header->pool_size &&
+          std::memchr(pool + value, '\0', header->pool_size - value));
+}
+
+bool ProgramCorpus::validate(size_t index) const {
+  const auto& e = entries[index];
+  for (uint32_t i = 0; i < e.num_directives; i++) {
+    const auto& d = directives[e.first_directive + i];
+    if (!validString(header, d.name_pos, d.name_len)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < e.num_operations; i++) {
+    const auto& r = operations[e.first_operation + i];
+    if (!Operation::Metadata::findByRefId(r.type) ||
+        r.target_type > static_cast<uint8_t>(Operand::Type::INDIRECT) ||
+        r.source_type > static_cast<uint8_t>(Operand::Type::INDIRECT) ||
+        !validNumber(r.target, r.flags & CORPUS_BIG_TARGET) ||
+        !validNumber(r.source, r.flags & CORPUS_BIG_SOURCE) ||
+        !validString(header, r.comment_pos, r.comment_len)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ProgramCorpus::find(UID id, size_t& index) const {
+  const auto begin = entries;
+  const auto end = entries + size();
+  auto it = std::lower_bound(
+      begin, end, id.castToInt(),
+      [](const Entry& e, int64_t value) { return e.id < value; });
+  if (it == end || it->id != id.castToInt()) {
+    return false;
+  }
+  index = it - begin;
+  return true;
+}
+
+std::string ProgramCorpus::getString(uint64_t pos, uint64_t len) const {
+  return std::string(pool + pos, len);
+}
+
+Number ProgramCorpus::getNumber(int64_t value, bool big) const {
+  if (big) {
+    return Number(std::string(pool + value));
+  }
+  return Number(value);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/uid.hpp"
+#include "lang/program.hpp"
+
+class MappedFile;
+
+// Binary file containing pre-parsed programs of the programs repository,
+// sorted by their IDs. Operations are stored as fixed-size records, while
+// comments, directive names and big constants are stored in a separate string
+// pool. The file is memory-mapped on load and programs are decoded on access.
+class ProgramCorpus {
+ public:
+  ProgramCorpus();
+
+  // Parse all programs of the programs repository and write them to a corpus
+  // file. The commit should be the programs commit if the repository has no
+  // local changes, or empty otherwise.
+  static void build(const std::string &path, const std::string &commit);
+
+  // Parse the programs with the given IDs and write them to a corpus file.
+  static void build(const std::string &path, const std::vector<UID> &ids,
+                    const std::string &commit);
+
+  // Load a corpus file. Returns false if the file is missing, has an
+  // unsupported format or an inconsistent header or index. The records of
+  // the individual programs are validated when they are accessed.
+  bool load(const std::string &path);
+
+  static std::string getDefaultPath();
+
+  // Returns the commit of the programs repository if it has no local
+  // changes, otherwise an empty string.
+  static std::string getProgramsCommit();
+
+  // Shared corpus loaded from the default path. Returns nullptr if it is not
+  // available, was built for a different programs folder or does not match
+  // the current programs commit.
+  static std::shared_ptr<const ProgramCorpus> getDefault();
+
+  // Discard the shared corpus, e.g. after it was rebuilt.
+  static void resetDefault();
+
+  size_t size() const;
+
+  UID getId(size_t index) const;
+
+  // Throws an exception if the records of the program are inconsistent.
+  Program getProgram(size_t index) const;
+
+  // Look up a program using binary search. Returns false if it is not
+  // contained or its records are inconsistent.
+  bool getProgram(UID id, Program &program) const;
+
+  bool exists(UID id) const;
+
+  // Programs commit used for building the corpus; empty if unknown.
+  std::string getCommit() const;
+
+  std::string getProgramsHome() const;
+
+  struct Header;
+  struct Entry;
+  struct OperationRecord;
+  struct DirectiveRecord;
+
+ private:
+  bool attach(const char *data, size_t size);
+
+  bool find(UID id, size_t &index) const;
+
+  static bool validString(const Header *h, uint64_t pos, uint64_t len);
+
+  bool validNumber(int64_t value, bool big) const;
+
+  bool validate(size_t index) const;
+
+  std::string getString(uint64_t pos, uint64_t len) const;
+
+  Number getNumber(int64_t value, bool big) const;
+
+  std::shared_ptr<const MappedFile> file;
+  const Header *header;
+  const Entry *entries;
+  const DirectiveRecord *directives;
+  const OperationRecord *operations;
+  const char *pool;
+};
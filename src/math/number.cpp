@@ -425,6 +425,8 @@ int64_t Number::getNumUsedWords() const {
   return 1;
 }
 
+bool Number::isBig() const { return big && big != INF_PTR; }
+
 bool Number::odd() const {
   if (big == INF_PTR) {
     return false;  // by convention
@@ -66,6 +66,8 @@ class Number {
 
   int64_t getNumUsedWords() const;
 
+  bool isBig() const;
+
   bool odd() const;
 
   std::size_t hash() const;
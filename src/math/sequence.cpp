@@ -3,6 +3,8 @@
 #include <sstream>
 #include <unordered_set>
 
+#include "math/big_number.hpp"
+
 Sequence::Sequence(const std::vector<int64_t> &s) {
   const auto t = s.size();
   resize(t);
@@ -11,6 +13,16 @@ Sequence::Sequence(const std::vector<int64_t> &s) {
   }
 }
 
+size_t Sequence::getMemoryUsage() const {
+  size_t bytes = sizeof(Sequence) + capacity() * sizeof(Number);
+  for (const auto &n : *this) {
+    if (n.isBig()) {
+      bytes += sizeof(BigNumber);
+    }
+  }
+  return bytes;
+}
+
 Sequence Sequence::subsequence(size_t start, size_t length) const {
   Sequence s;
   if (start < size() && length > 0) {
@@ -31,6 +31,9 @@ class Sequence : public std::vector<Number> {
   void to_b_file(std::ostream &out, int64_t offset) const;
 
   std::string to_string() const;
+
+  // Returns the estimated memory usage in bytes.
+  size_t getMemoryUsage() const;
 };
 
 struct SequenceHasher {
@@ -36,6 +36,18 @@ ApiClient::ApiClient()
   oeis_fetch_direct = Setup::getSetupFlag("LODA_OEIS_FETCH_DIRECT", false);
 }
 
+ApiClient::~ApiClient() {
+  if (!submission_queue) {
+    return;
+  }
+  if (!submission_queue->flush(std::chrono::seconds(FLUSH_TIMEOUT_SECS))) {
+    Log::get().warn(std::to_string(submission_queue->size()) +
+                    " program submissions pending; retrying on next start");
+  }
+  submission_queue.reset();
+  spill_lock.reset();
+}
+
 ApiClient& ApiClient::getDefaultInstance() {
   static ApiClient api_client;
   return api_client;
@@ -57,24 +69,43 @@ std::string ApiClient::toJson(const Program& program){
          "\"content\":\"" + escapeJsonString(content) + "\"}";
 }
 
-void ApiClient::postProgram(const Program& program, size_t max_buffer) {
-  // attention: curl sometimes has problems with absolute paths.
-  // so we use a relative path here!
-  const std::string tmp = "post_program_" + std::to_string(client_id) + ".json";
-  out_queue.push_back(program);
-  while (!out_queue.empty()) {
-    {
-      std::ofstream out(tmp);
-      out << toJson(out_queue.back());
-      out.close();
-    }
-    if (postSubmission(tmp, out_queue.size() > max_buffer)) {
-      out_queue.pop_back();
-    } else {
+void ApiClient::startSubmissions(const std::string& spill_file) {
+  if (submission_queue && spill_file == spill_base) {
+    return;
+  }
+  submission_queue.reset();  // release the previous spill file first
+  spill_lock.reset();
+  // use a spill file that is not locked by another miner instance
+  auto ext = spill_file.find_last_of('.');
+  const auto sep = spill_file.find_last_of("/\\");
+  if (ext == std::string::npos || (sep != std::string::npos && ext < sep)) {
+    ext = spill_file.size();
+  }
+  std::string file = spill_file;
+  for (size_t i = 1; i <= MAX_SPILL_FILES; i++) {
+    spill_lock.reset(new FileLock(file + ".lock"));
+    if (spill_lock->isLocked()) {
       break;
     }
+    file = spill_file.substr(0, ext) + "_" + std::to_string(i) +
+           spill_file.substr(ext);
+  }
+  if (!spill_lock->isLocked()) {
+    Log::get().error("Cannot lock spill file " + spill_file, true);
+  }
+  spill_base = spill_file;
+  const std::string url = base_url_v2 + "submissions";
+  submission_queue.reset(
+      new SubmissionQueue(file, [url](const std::string& body) {
+        return WebClient::postContent(url, body);
+      }));
+}
+
+void ApiClient::postProgram(const Program& program) {
+  if (!submission_queue) {
+    startSubmissions(Setup::getCacheHome() + "submissions.jsonl");
   }
-  std::remove(tmp.c_str());
+  submission_queue->push(toJson(program));
 }
 
 bool ApiClient::postSubmission(const std::string& path, bool fail_on_error) {
@@ -97,24 +128,16 @@ bool ApiClient::postSubmission(const std::string& path, bool fail_on_error) {
 }
 
 void ApiClient::postCPUHour() {
-  const auto tmp_file_id = Random::get().gen() % 1000;
-  // attention: curl sometimes has problems with absolute paths.
-  // so we use a relative path here!
-  // TODO: extend WebClient::postFile to support content directly
-  const std::string tmp_file =
-      "loda_usage_" + std::to_string(tmp_file_id) + ".json";
-  std::ofstream out(tmp_file);
-  out << "{\"version\":\"" << Version::VERSION << "\", \"platform\":\""
-      << Version::PLATFORM << "\", \"cpuHours\":1" << "}\n";
-  out.close();
+  const std::string content = "{\"version\":\"" + Version::VERSION +
+                              "\", \"platform\":\"" + Version::PLATFORM +
+                              "\", \"cpuHours\":1}\n";
   const std::vector<std::string> headers = {"Content-Type: application/json"};
   const std::string url = base_url + "cpuhours";
-  if (!WebClient::postFile(url, tmp_file, {}, headers)) {
-    WebClient::postFile(url, tmp_file, {}, headers,
-                        true);  // for debugging
+  if (!WebClient::postContent(url, content, {}, headers)) {
+    WebClient::postContent(url, content, {}, headers,
+                           true);  // for debugging
     Log::get().error("Error reporting usage", false);
   }
-  std::remove(tmp_file.c_str());
 }
 
 void ApiClient::reportBrokenBFile(const UID& id) {
@@ -122,22 +145,14 @@ void ApiClient::reportBrokenBFile(const UID& id) {
   if (id.domain() != 'A') {
     return;
   }
-  const auto tmp_file_id = Random::get().gen() % 1000;
-  // attention: curl sometimes has problems with absolute paths.
-  // so we use a relative path here!
-  const std::string tmp_file =
-      "loda_bfile_removal_" + std::to_string(tmp_file_id) + ".json";
-  std::ofstream out(tmp_file);
-  out << "{\"id\":\"" << escapeJsonString(id.string())
-      << "\",\"mode\":\"remove\",\"type\":\"bfile\"}\n";
-  out.close();
+  const std::string content = "{\"id\":\"" + escapeJsonString(id.string()) +
+                              "\",\"mode\":\"remove\",\"type\":\"bfile\"}\n";
   const std::string url = base_url_v2 + "submissions";
-  if (!WebClient::postFile(url, tmp_file)) {
+  if (!WebClient::postContent(url, content)) {
     Log::get().warn("Failed to report broken b-file for " + id.string());
   } else {
     Log::get().info("Reported broken b-file for " + id.string());
   }
-  std::remove(tmp_file.c_str());
 }
 
 void ApiClient::getOeisFile(const std::string& filename,
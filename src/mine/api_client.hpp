@@ -1,20 +1,34 @@
 #pragma once
 
 #include <chrono>
+#include <memory>
 
 #include "lang/program.hpp"
 #include "mine/submission.hpp"
+#include "mine/submission_queue.hpp"
+#include "sys/file.hpp"
 #include "sys/jute.h"
 
 class ApiClient {
  public:
   ApiClient();
 
+  // Waits a few seconds for pending program submissions to be sent.
+  ~ApiClient();
+
   static ApiClient& getDefaultInstance();
 
   std::string toJson(const Program& program);
 
-  void postProgram(const Program& program, size_t max_buffer = 0);
+  // Starts the background submission of programs using the given spill
+  // file for pending submissions. Called on the first postProgram() using a
+  // default spill file if not called before. Does nothing if the submissions
+  // were already started with the same spill file. If the spill file is used
+  // by another process, a numbered variant of it is used instead.
+  void startSubmissions(const std::string& spill_file);
+
+  // Queues a program for submission to the API server.
+  void postProgram(const Program& program);
 
   //void postSubmission(const Submission& submission, size_t max_buffer = 0);
 
@@ -32,6 +46,10 @@ class ApiClient {
   // throttle download of OEIS file from API server
   static constexpr int64_t OEIS_THROTTLING_SECS = 10;  // magic number
 
+  static constexpr int64_t FLUSH_TIMEOUT_SECS = 10;  // magic number
+
+  static constexpr size_t MAX_SPILL_FILES = 1000;  // magic number
+
   class Page {
    public:
     int64_t limit;
@@ -48,7 +66,9 @@ class ApiClient {
   int64_t fetched_oeis_files;
   std::vector<Page> pages;
   std::vector<Submission> in_queue;
-  std::vector<Program> out_queue;
+  std::string spill_base;
+  std::unique_ptr<FileLock> spill_lock;
+  std::unique_ptr<SubmissionQueue> submission_queue;
   std::chrono::time_point<std::chrono::steady_clock> last_oeis_time;
   bool printed_throttling_warning;
 
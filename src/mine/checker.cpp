@@ -9,6 +9,7 @@
 #include "lang/constants.hpp"
 #include "lang/program_cache.hpp"
 #include "lang/program_util.hpp"
+#include "mine/stage_timer.hpp"
 #include "seq/managed_seq.hpp"
 #include "seq/seq_program.hpp"
 #include "sys/file.hpp"
@@ -181,7 +182,10 @@ check_result_t Checker::checkProgramExtended(Program program, Program existing,
   }
   
   // minimize based on number of terminating terms
-  minimizer.optimizeAndMinimize(program, num_minimize);
+  {
+    StageTimer::Span span(StageTimer::Stage::MINIMIZE);
+    minimizer.optimizeAndMinimize(program, num_minimize);
+  }
   if (program != result.program) {
     // minimization changed program => check the minimized program
     num_required = SequenceProgram::getNumRequiredTerms(program);
@@ -232,8 +236,10 @@ check_result_t Checker::checkProgramBasic(const Program& program,
   if (!is_new) {
     // check if another miner already submitted a program for this sequence
     if (change_type == first) {
-      Log::get().debug("Skipping update of " + seq.id.string() +
-                       " because program is not new");
+      Log::get().debug([&]() {
+        return "Skipping update of " + seq.id.string() +
+               " because program is not new";
+      });
       return result;
     }
     // fall back to extended validation if the program is fast, if metadata is
@@ -244,15 +250,18 @@ check_result_t Checker::checkProgramBasic(const Program& program,
     if (is_fast || change_type.empty() || !previous_hash ||
         forced_submitter_checks.find(submitter) !=
             forced_submitter_checks.end()) {
-      Log::get().debug("Falling back to extended validation for " +
-                       seq.id.string());
+      Log::get().debug([&]() {
+        return "Falling back to extended validation for " + seq.id.string();
+      });
       return checkProgramExtended(program, existing, is_new, seq, full_check,
                                   num_usages);
     }
     // compare with hash of existing program
     if (previous_hash != SequenceProgram::getTransitiveProgramHash(existing)) {
-      Log::get().debug("Skipping update of " + seq.id.string() +
-                       " because of hash mismatch");
+      Log::get().debug([&]() {
+        return "Skipping update of " + seq.id.string() +
+               " because of hash mismatch";
+      });
       return result;
     }
   }
@@ -140,6 +140,7 @@ Miner::Config ConfigLoader::load(const Settings &settings) {
         mc.type = matchers[j].as_string();
         config.matchers.push_back(mc);
       }
+      config.prefilter = getJBool(m, "prefilter", false);
 
       // load generator configs
       auto gen_names = m["generators"];
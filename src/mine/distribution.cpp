@@ -10,9 +10,10 @@ std::discrete_distribution<> uniformDist(size_t size) {
 std::discrete_distribution<> constantsDist(const std::vector<Number> &constants,
                                            const Stats &stats) {
   std::vector<double> p(constants.size());
+  int64_t count;
   for (size_t i = 0; i < constants.size(); i++) {
-    auto it = stats.num_constants.find(constants[i]);
-    p[i] = (it != stats.num_constants.end()) ? it->second : 1.0;
+    p[i] = stats.getSnapshot().findConstantCount(constants[i], count) ? count
+                                                                      : 1.0;
   }
   return std::discrete_distribution<>(p.begin(), p.end());
 }
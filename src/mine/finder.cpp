@@ -1,9 +1,11 @@
 #include "mine/finder.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <set>
 #include <sstream>
+#include <unordered_set>
 
 #include "lang/analyzer.hpp"
 #include "lang/constants.hpp"
@@ -11,10 +13,12 @@
 #include "lang/subprogram.hpp"
 #include "mine/config.hpp"
 #include "mine/invalid_matches.hpp"
+#include "mine/stage_timer.hpp"
 #include "seq/seq_list.hpp"
 #include "seq/seq_program.hpp"
 #include "sys/file.hpp"
 #include "sys/log.hpp"
+#include "sys/memory_budget.hpp"
 #include "sys/setup.hpp"
 #include "sys/util.hpp"
 
@@ -24,12 +28,16 @@ Finder::Finder(const Settings &settings, Evaluator &evaluator)
       optimizer(settings),
       minimizer(settings),
       num_find_attempts(0),
+      num_prefilter_rejected(0),
+      num_prefilter_skipped(0),
+      num_evaluated_cells(0),
       invalid_matches(),
       checker(settings, evaluator, minimizer, invalid_matches) {
   auto config = ConfigLoader::load(settings);
   if (config.matchers.empty()) {
     Log::get().error("No matchers defined", true);
   }
+  use_prefilter = config.prefilter;
 
   // create matchers
   matchers.clear();
@@ -58,12 +66,9 @@ void Finder::remove(const Sequence &norm_seq, UID id) {
 Matcher::seq_programs_t Finder::findSequence(const Program &p,
                                              Sequence &norm_seq,
                                              const SequenceIndex &sequences) {
-  // update memory usage info
+  // update memory budget
   if (num_find_attempts++ % 1000 == 0) {
-    bool has_memory = Setup::hasMemory();
-    for (const auto &matcher : matchers) {
-      matcher->has_memory = has_memory;
-    }
+    MemoryBudget::get().update();
   }
 
   // determine largest memory cell to check
@@ -75,20 +80,37 @@ Matcher::seq_programs_t Finder::findSequence(const Program &p,
     max_index = largest_used_cell;
   }
 
-  // interpret program
-  tmp_seqs.resize(std::max<size_t>(2, max_index + 1));
+  // skip the evaluation if no output cell can be matched
+  const size_t num_cells = std::max<size_t>(2, max_index + 1);
   Matcher::seq_programs_t result;
+  if (use_prefilter && !prefilter(p, num_cells)) {
+    norm_seq.clear();
+    return result;
+  }
+
+  // interpret program
+  tmp_seqs.resize(num_cells);
+  bool ok = true;
+  evaluator.setCostModel(true);
   try {
+    StageTimer::Span span(StageTimer::Stage::EVALUATE);
     evaluator.eval(p, tmp_seqs);
     norm_seq = tmp_seqs[1];
   } catch (const std::exception &) {
-    // evaluation error
+    ok = false;  // evaluation error
+  }
+  evaluator.setCostModel(false);
+  if (!ok) {
     return result;
   }
   Program p2 = p;
   p2.push_back(Operation::Type::MOV, Operand::Type::DIRECT,
                Program::OUTPUT_CELL, Operand::Type::DIRECT, 0);
   for (size_t i = 0; i < tmp_seqs.size(); i++) {
+    if (use_prefilter && !tmp_accepted_cells[i]) {
+      continue;
+    }
+    num_evaluated_cells++;
     if (i == Program::OUTPUT_CELL) {
       findAll(p, tmp_seqs[i], sequences, result);
     } else {
@@ -99,6 +121,63 @@ Matcher::seq_programs_t Finder::findSequence(const Program &p,
   return result;
 }
 
+bool Finder::prefilter(const Program &p, size_t num_cells) {
+  tmp_accepted_cells.assign(num_cells, true);
+  RangeMap ranges;
+  bool ok;
+  try {
+    range_generator.setInputUpperBound(
+        Number(ProgramUtil::getOffset(p) + settings.num_terms - 1));
+    ok = range_generator.generate(p, ranges);
+  } catch (const std::exception &) {
+    ok = false;
+  }
+  std::unordered_set<int64_t> used_cells;
+  int64_t largest_used = 0;
+  if (!ok || !ProgramUtil::getUsedMemoryCells(p, nullptr, &used_cells,
+                                              largest_used, -1)) {
+    return true;  // no ranges available: evaluate all cells
+  }
+  bool any_accepted = false;
+  for (size_t i = 0; i < num_cells; i++) {
+    // used cells not in the map are unbounded, because their ranges were
+    // pruned; unused cells remain zero, except for the input cell
+    auto it = ranges.find(i);
+    Range range(Number::ZERO, Number::ZERO);
+    if (it != ranges.end()) {
+      range = it->second;
+    } else if (used_cells.count(i) || i == Program::INPUT_CELL) {
+      range = Range(Number::INF, Number::INF);
+    }
+    bool accept;
+    if (range.isConstant()) {
+      accept = false;
+    } else if (range.isFinite() && range.upper_bound < range.lower_bound) {
+      accept = false;  // empty range
+    } else {
+      accept = std::any_of(
+          matchers.begin(), matchers.end(),
+          [&](const std::unique_ptr<Matcher> &m) {
+            return m->canMatch(range);
+          });
+    }
+    tmp_accepted_cells[i] = accept;
+    any_accepted = any_accepted || accept;
+    if (!accept) {
+      num_prefilter_rejected++;
+    }
+  }
+  if (!any_accepted) {
+    num_prefilter_skipped++;
+  }
+  return any_accepted;
+}
+
+void Finder::resetPrefilterCounts() {
+  num_prefilter_rejected = 0;
+  num_prefilter_skipped = 0;
+}
+
 void Finder::findAll(const Program &p, const Sequence &norm_seq,
                      const SequenceIndex &sequences,
                      Matcher::seq_programs_t &result) {
@@ -106,18 +185,21 @@ void Finder::findAll(const Program &p, const Sequence &norm_seq,
   std::pair<UID, Program> last(UID('A', 0), Program());
   for (size_t i = 0; i < matchers.size(); i++) {
     tmp_result.clear();
-    matchers[i]->match(p, norm_seq, tmp_result);
+    {
+      StageTimer::Span span(StageTimer::Stage::MATCH);
+      matchers[i]->match(p, norm_seq, tmp_result);
+    }
 
     // validate the found matches
     for (auto t : tmp_result) {
-      auto &s = sequences.get(t.first);
       if (t == last) {
         // Log::get().warn("Ignoring duplicate match for " + s.id_str());
         continue;
       }
       last = t;
-      auto expected_seq = s.getTerms(s.numExistingTerms());
+      auto expected_seq = sequences.getTerms(t.first);
       auto num_required = SequenceProgram::getNumRequiredTerms(t.second);
+      StageTimer::Span span(StageTimer::Stage::CHECK);
       auto res = evaluator.check(t.second, expected_seq, num_required, t.first);
       if (res.first == status_t::ERROR) {
         invalid_matches.insert(t.first);
@@ -131,12 +213,21 @@ void Finder::findAll(const Program &p, const Sequence &norm_seq,
 }
 
 void Finder::logSummary(size_t loaded_count) {
-  std::stringstream buf;
-  buf << "Matcher compaction ratios: ";
-  for (size_t i = 0; i < matchers.size(); i++) {
-    if (i > 0) buf << ", ";
-    buf << matchers[i]->getName() << ": " << std::setprecision(3)
-        << matchers[i]->getCompationRatio() << "%";
+  Log::get().debug([&]() {
+    std::stringstream buf;
+    buf << "Matcher compaction ratios: ";
+    for (size_t i = 0; i < matchers.size(); i++) {
+      if (i > 0) buf << ", ";
+      buf << matchers[i]->getName() << ": " << std::setprecision(3)
+          << matchers[i]->getCompationRatio() << "%";
+    }
+    return buf.str();
+  });
+  if (use_prefilter) {
+    Log::get().debug([&]() {
+      return "Range prefilter rejected " +
+             std::to_string(num_prefilter_rejected) + " cells and skipped " +
+             std::to_string(num_prefilter_skipped) + " evaluations";
+    });
   }
-  Log::get().debug(buf.str());
 }
\ No newline at end of file
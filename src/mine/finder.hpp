@@ -5,6 +5,7 @@
 #include "base/uid.hpp"
 #include "eval/evaluator.hpp"
 #include "eval/minimizer.hpp"
+#include "eval/range_generator.hpp"
 #include "mine/checker.hpp"
 #include "mine/invalid_matches.hpp"
 #include "mine/matcher.hpp"
@@ -29,9 +30,28 @@ class Finder {
 
   Checker &getChecker() { return checker; }
 
+  Evaluator &getEvaluator() { return evaluator; }
+
   void logSummary(size_t loaded_count);
 
+  bool usesPrefilter() const { return use_prefilter; }
+
+  void setPrefilter(bool enabled) { use_prefilter = enabled; }
+
+  // number of output cells rejected by the range prefilter
+  size_t getNumPrefilterRejected() const { return num_prefilter_rejected; }
+
+  // number of programs not evaluated because all cells were rejected
+  size_t getNumPrefilterSkipped() const { return num_prefilter_skipped; }
+
+  void resetPrefilterCounts();
+
+  // number of memory cells of evaluated programs passed to the matchers
+  size_t getNumEvaluatedCells() const { return num_evaluated_cells; }
+
  private:
+  bool prefilter(const Program &p, size_t num_cells);
+
   void findAll(const Program &p, const Sequence &norm_seq,
                const SequenceIndex &sequences, Matcher::seq_programs_t &result);
 
@@ -43,12 +63,18 @@ class Finder {
   Minimizer minimizer;
   std::vector<std::unique_ptr<Matcher>> matchers;
   mutable size_t num_find_attempts;
+  bool use_prefilter;
+  size_t num_prefilter_rejected;
+  size_t num_prefilter_skipped;
+  size_t num_evaluated_cells;
+  RangeGenerator range_generator;
   InvalidMatches invalid_matches;
   Checker checker;
 
   // temporary containers (cached as members)
   mutable std::unordered_set<int64_t> tmp_used_cells;
   mutable std::vector<Sequence> tmp_seqs;
+  mutable std::vector<bool> tmp_accepted_cells;
   mutable Matcher::seq_programs_t tmp_result;
   mutable std::map<std::string, std::string> tmp_matcher_labels;
 };
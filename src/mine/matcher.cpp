@@ -1,5 +1,7 @@
 #include "mine/matcher.hpp"
 
+#include <algorithm>
+
 #include "eval/optimizer.hpp"
 #include "eval/semantics.hpp"
 #include "mine/reducer.hpp"
@@ -34,7 +36,13 @@ void AbstractMatcher<T>::insert(const Sequence &norm_seq, UID id) {
   auto reduced = reduce(norm_seq, false);
   if (!reduced.first.empty()) {
     data[id] = reduced.second;
-    ids[reduced.first].push_back(id);
+    auto &bucket = ids[reduced.first];
+    if (bucket.empty()) {
+      table_usage.add(reduced.first.getMemoryUsage() +
+                      sizeof(std::vector<UID>) + MemoryBudget::NODE_OVERHEAD);
+    }
+    bucket.push_back(id);
+    table_usage.add(ENTRY_BYTES);
   }
 }
 
@@ -43,7 +51,9 @@ void AbstractMatcher<T>::remove(const Sequence &norm_seq, UID id) {
   auto reduced = reduce(norm_seq, false);
   if (!reduced.first.empty()) {
     ids.remove(reduced.first, id);
-    data.erase(id);
+    if (data.erase(id)) {
+      table_usage.add(-ENTRY_BYTES);
+    }
   }
 }
 
@@ -81,10 +91,16 @@ bool AbstractMatcher<T>::shouldMatchSequence(const Sequence &seq) const {
       // seq.to_string() );
       return false;
     }
-    if ((has_memory || match_attempts.size() < 1000) &&  // magic number
-        (Random::get().gen() % 10) == 0)                 // magic number
+    if (backoff_usage.shouldShrink()) {
+      match_attempts.clear();
+      backoff_usage.set(0);
+    }
+    if ((backoff_usage.mayGrow() ||
+         match_attempts.size() < 1000) &&  // magic number
+        (Random::get().gen() % 10) == 0)   // magic number
     {
       match_attempts.insert(seq);
+      backoff_usage.add(seq.getMemoryUsage() + MemoryBudget::NODE_OVERHEAD);
     }
   }
   return true;
@@ -102,6 +118,34 @@ std::pair<Sequence, int> DirectMatcher::reduce(const Sequence &seq,
 
 bool DirectMatcher::extend(Program &p, int base, int gen) const { return true; }
 
+void DirectMatcher::insert(const Sequence &norm_seq, UID id) {
+  AbstractMatcher::insert(norm_seq, id);
+  if (norm_seq.empty()) {
+    return;
+  }
+  auto minmax = std::minmax_element(norm_seq.begin(), norm_seq.end());
+  if (min_max_term == Number::INF || *minmax.second < min_max_term) {
+    min_max_term = *minmax.second;
+  }
+  if (max_min_term == Number::INF || max_min_term < *minmax.first) {
+    max_min_term = *minmax.first;
+  }
+}
+
+bool DirectMatcher::canMatch(const Range &range) const {
+  // a sequence can only match if all its terms are in the range
+  if (min_max_term == Number::INF) {
+    return false;  // nothing indexed
+  }
+  if (range.upper_bound != Number::INF && range.upper_bound < min_max_term) {
+    return false;
+  }
+  if (range.lower_bound != Number::INF && max_min_term < range.lower_bound) {
+    return false;
+  }
+  return true;
+}
+
 // --- Linear Matcher ---------------------------------------------------------
 
 std::pair<Sequence, line_t> LinearMatcher::reduce(const Sequence &seq,
@@ -4,9 +4,11 @@
 #include <unordered_set>
 
 #include "base/uid.hpp"
+#include "eval/range.hpp"
 #include "lang/program.hpp"
 #include "mine/extender.hpp"
 #include "mine/reducer.hpp"
+#include "sys/memory_budget.hpp"
 
 class Matcher {
  public:
@@ -34,18 +36,23 @@ class Matcher {
   virtual void match(const Program &p, const Sequence &norm_seq,
                      seq_programs_t &result) const = 0;
 
+  // Returns false if no indexed sequence can be matched by a sequence whose
+  // terms are all in the given range. Used to skip evaluation of programs.
+  virtual bool canMatch(const Range &range) const { return true; }
+
   virtual const std::string &getName() const = 0;
 
   virtual double getCompationRatio() const = 0;
-
-  bool has_memory = true;
 };
 
 template <class T>
 class AbstractMatcher : public Matcher {
  public:
   AbstractMatcher(const std::string &name, bool backoff)
-      : name(name), backoff(backoff) {}
+      : name(name),
+        backoff(backoff),
+        table_usage(MemoryBudget::Subsystem::MATCHERS),
+        backoff_usage(MemoryBudget::Subsystem::BACKOFF) {}
 
   virtual ~AbstractMatcher() {}
 
@@ -71,24 +78,43 @@ class AbstractMatcher : public Matcher {
  private:
   bool shouldMatchSequence(const Sequence &seq) const;
 
+  // estimated memory usage of an indexed ID (data entry and ID list element)
+  static constexpr int64_t ENTRY_BYTES =
+      2 * sizeof(UID) + sizeof(T) + MemoryBudget::NODE_OVERHEAD;
+
   std::string name;
   SequenceToIdsMap ids;
   std::unordered_map<UID, T> data;
   mutable std::unordered_set<Sequence, SequenceHasher> match_attempts;
   bool backoff;
+  MemoryBudget::Usage table_usage;
+  mutable MemoryBudget::Usage backoff_usage;
 };
 
 class DirectMatcher : public AbstractMatcher<int> {
  public:
-  DirectMatcher(bool backoff) : AbstractMatcher("direct", backoff) {}
+  DirectMatcher(bool backoff)
+      : AbstractMatcher("direct", backoff),
+        min_max_term(Number::INF),
+        max_min_term(Number::INF) {}
 
   virtual ~DirectMatcher() {}
 
+  virtual void insert(const Sequence &norm_seq, UID id) override;
+
+  virtual bool canMatch(const Range &range) const override;
+
  protected:
   virtual std::pair<Sequence, int> reduce(const Sequence &seq,
                                           bool match) const override;
 
   virtual bool extend(Program &p, int base, int gen) const override;
+
+ private:
+  // Summary of the indexed sequences: smallest maximum term and largest
+  // minimum term. Not updated on removal, which keeps it conservative.
+  Number min_max_term;
+  Number max_min_term;
 };
 
 class LinearMatcher : public AbstractMatcher<line_t> {
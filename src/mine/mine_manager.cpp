@@ -4,11 +4,13 @@
 #include <time.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <limits>
+#include <mutex>
 #include <sstream>
 
 #include "eval/fold.hpp"
@@ -16,8 +18,10 @@
 #include "eval/optimizer.hpp"
 #include "form/formula_gen.hpp"
 #include "lang/comments.hpp"
+#include "lang/program_corpus.hpp"
 #include "lang/program_util.hpp"
 #include "mine/config.hpp"
+#include "mine/stage_timer.hpp"
 #include "mine/stats.hpp"
 #include "seq/seq_list.hpp"
 #include "seq/seq_program.hpp"
@@ -26,6 +30,7 @@
 #include "sys/log.hpp"
 #include "sys/metrics.hpp"
 #include "sys/setup.hpp"
+#include "sys/thread_pool.hpp"
 #include "sys/util.hpp"
 #include "sys/web_client.hpp"
 
@@ -296,10 +301,65 @@ void MineManager::update(bool force) {
       }
     }
   }
+
+  // rebuild the program corpus after updating the programs; it is not used
+  // without a commit to key it on or in server mode
+  if (Setup::getMiningMode() == MINING_MODE_SERVER) {
+    return;
+  }
+  const auto commit = ProgramCorpus::getProgramsCommit();
+  const auto corpus_path = ProgramCorpus::getDefaultPath();
+  if (!commit.empty() && (update_programs || !isFile(corpus_path))) {
+    ProgramCorpus::build(corpus_path, commit);
+    ProgramCorpus::resetDefault();
+  }
 }
 
-void MineManager::generateStats(int64_t age_in_days) {
+struct StatsProgram {
+  Program program;
+  std::string submitter;
+  std::string formula;
+  int64_t offset;
+};
+
+// extract the information needed for the stats from a program
+static StatsProgram toStatsProgram(Program program) {
+  StatsProgram result;
+  result.program = std::move(program);
+  result.formula =
+      Comments::getCommentField(result.program, Comments::PREFIX_FORMULA);
+  result.submitter = Comments::getSubmitter(result.program);
+  result.offset = ProgramUtil::getOffset(result.program);
+  ProgramUtil::removeOps(result.program, Operation::Type::NOP);
+  return result;
+}
+
+// parse a program and extract the information needed for the stats
+static StatsProgram parseStatsProgram(Parser& parser, std::istream& in) {
+  return toStatsProgram(parser.parse(in));
+}
+
+static void logStatsDuration(
+    const std::string& prefix, size_t num_processed,
+    const std::chrono::time_point<std::chrono::steady_clock>& start_time) {
+  auto cur_time = std::chrono::steady_clock::now();
+  double duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        cur_time - start_time)
+                        .count() /
+                    1000.0;
+  std::stringstream buf;
+  buf.setf(std::ios::fixed);
+  buf.precision(2);
+  buf << duration;
+  Log::get().info(prefix + " stats for " + std::to_string(num_processed) +
+                  " programs in " + buf.str() + "s");
+}
+
+void MineManager::generateStats(int64_t age_in_days, bool incremental) {
   load();
+  if (incremental && age_in_days >= 0 && updateStatsIncrementally()) {
+    return;
+  }
   std::string msg;
   if (age_in_days < 0) {
     msg = "Generating program stats at \"" + stats_home + "\"";
@@ -310,63 +370,196 @@ void MineManager::generateStats(int64_t age_in_days) {
   Log::get().info(msg);
   auto start_time = std::chrono::steady_clock::now();
   stats.reset(new Stats());
+  const auto programs_commit = ProgramCorpus::getProgramsCommit();
 
-  size_t num_processed = 0;
-  Program program;
-  std::string file_name, submitter;
-  bool has_program, has_formula;
+  // use the program corpus only if it was built from the same programs
+  auto corpus = ProgramCorpus::getDefault();
+  if (corpus && (programs_commit.empty() ||
+                 corpus->getCommit() != programs_commit)) {
+    corpus.reset();
+  }
 
-  AdaptiveScheduler notify(20);  // magic number
+  // process programs in chunks of consecutive sequences using partial stats,
+  // which are merged in order to obtain deterministic results; partials are
+  // merged as soon as their predecessors are done to limit memory usage
+  std::vector<UID> ids;
   for (const auto& s : sequences) {
-    file_name = ProgramUtil::getProgramPath(s.id);
-    std::ifstream program_file(file_name);
-    has_program = false;
-    has_formula = false;
-    if (program_file.good()) {
+    ids.push_back(s.id);
+  }
+  static constexpr size_t CHUNK_SIZE = 1000;  // magic number
+  const size_t num_chunks = (ids.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  std::vector<std::unique_ptr<Stats>> partials(num_chunks);
+  std::vector<char> has_program(ids.size(), false);
+  std::vector<char> has_formula(ids.size(), false);
+  std::atomic<size_t> num_processed(0);
+  std::mutex merge_mutex;
+  size_t next_merge = 0;
+  AdaptiveScheduler notify(20);  // magic number
+  ThreadPool pool(ThreadPool::getDefaultNumThreads());
+  for (size_t c = 0; c < num_chunks; c++) {
+    pool.submit([&, c]() {
+      Parser chunk_parser;
+      std::unique_ptr<Stats> partial(new Stats());
+      const size_t end = std::min(ids.size(), (c + 1) * CHUNK_SIZE);
+      for (size_t i = c * CHUNK_SIZE; i < end; i++) {
+        const auto file_name = ProgramUtil::getProgramPath(ids[i]);
+        Program program;
+        std::ifstream program_file;
+        const bool in_corpus = corpus && corpus->getProgram(ids[i], program);
+        if (!in_corpus) {
+          program_file.open(file_name);
+          if (!program_file.good()) {
+            continue;
+          }
+        }
+        try {
+          auto p = in_corpus ? toStatsProgram(std::move(program))
+                             : parseStatsProgram(chunk_parser, program_file);
+          has_program[i] = true;
+          has_formula[i] = !p.formula.empty();
+
+          // update stats
+          partial->updateProgramStats(ids[i], p.program, p.submitter,
+                                      p.formula, p.offset);
+          num_processed++;
+        } catch (const std::exception& exc) {
+          Log::get().error(
+              "Error parsing " + file_name + ": " + std::string(exc.what()),
+              false);
+        }
+      }
+      std::lock_guard<std::mutex> lock(merge_mutex);
+      partials[c] = std::move(partial);
+      while (next_merge < num_chunks && partials[next_merge]) {
+        stats->merge(*partials[next_merge]);
+        partials[next_merge].reset();
+        next_merge++;
+      }
+      if (notify.isTargetReached()) {
+        notify.reset();
+        Log::get().info("Processed " + std::to_string(num_processed) +
+                        " programs");
+      }
+    });
+  }
+  pool.wait();
+  for (size_t i = 0; i < ids.size(); i++) {
+    stats->updateSequenceStats(ids[i], has_program[i], has_formula[i]);
+  }
+
+  // remember the programs commit only if it did not change in the meantime
+  if (!programs_commit.empty() &&
+      ProgramCorpus::getProgramsCommit() == programs_commit) {
+    stats->programs_commit = programs_commit;
+  }
+  stats->version = Version::VERSION;
+
+  // write stats
+  stats->finalize();
+  stats->save(stats_home);
+
+  // print summary
+  logStatsDuration("Generated", num_processed, start_time);
+}
+
+bool MineManager::updateStatsIncrementally() {
+  std::unique_ptr<Stats> updated(new Stats());
+  try {
+    updated->load(stats_home);
+  } catch (const std::exception&) {
+    return false;
+  }
+  const auto base_commit = updated->programs_commit;
+  if (base_commit.empty() || updated->version != Version::VERSION) {
+    return false;
+  }
+  const auto head_commit = ProgramCorpus::getProgramsCommit();
+  if (head_commit.empty()) {
+    return false;
+  }
+  Log::get().info("Updating program stats since commit " +
+                  base_commit.substr(0, 8));
+  auto start_time = std::chrono::steady_clock::now();
+
+  // collect changed programs and programs of removed sequences
+  const auto progs_dir = Setup::getProgramsHome();
+  std::set<UID> changed;
+  for (const auto& c : Git::diff(progs_dir, base_commit)) {
+    const auto& path = c.second;
+    if (path.rfind("oeis/", 0) == 0 && path.size() >= 11 &&
+        path.substr(path.size() - 4) == ".asm") {
       try {
-        program = parser.parse(program_file);
-        has_program = true;
-        std::string formula_str =
-            Comments::getCommentField(program, Comments::PREFIX_FORMULA);
-        has_formula = !formula_str.empty();
-        submitter = Comments::getSubmitter(program);
-        int64_t offset = ProgramUtil::getOffset(program);
-        ProgramUtil::removeOps(program, Operation::Type::NOP);
-
-        // update stats
-        stats->updateProgramStats(s.id, program, submitter, formula_str,
-                                  offset);
-        num_processed++;
+        changed.insert(UID(path.substr(path.size() - 11, 7)));
+      } catch (const std::exception&) {
+        // ignore because it is not a program of an OEIS sequence
+      }
+    }
+  }
+  for (auto id : updated->all_program_ids) {
+    if (!sequences.exists(id)) {
+      changed.insert(id);
+    }
+  }
+
+  // subtract the previous and add the current versions of changed programs
+  updated->prepareIncrementalUpdate();
+  size_t num_processed = 0;
+  for (auto id : changed) {
+    if (updated->program_lengths.count(id)) {
+      const std::string path =
+          "oeis/" + ProgramUtil::dirStr(id) + "/" + id.string() + ".asm";
+      const auto tmp_file = Git::extractVersion(progs_dir, base_commit, path);
+      if (tmp_file.empty()) {
+        Log::get().warn("Cannot read previous version of " + id.string());
+        return false;
+      }
+      std::ifstream in(tmp_file);
+      try {
+        auto p = parseStatsProgram(parser, in);
+        updated->removeProgramStats(id, p.program, p.submitter);
       } catch (const std::exception& exc) {
-        Log::get().error(
-            "Error parsing " + file_name + ": " + std::string(exc.what()),
-            false);
+        Log::get().warn("Error parsing previous version of " + id.string() +
+                        ": " + std::string(exc.what()));
+        in.close();
+        std::remove(tmp_file.c_str());
+        return false;
       }
+      in.close();
+      std::remove(tmp_file.c_str());
     }
-    stats->updateSequenceStats(s.id, has_program, has_formula);
-    if (notify.isTargetReached()) {
-      notify.reset();
-      Log::get().info("Processed " + std::to_string(num_processed) +
-                      " programs");
+    if (sequences.exists(id)) {
+      const auto file_name = ProgramUtil::getProgramPath(id);
+      std::ifstream program_file(file_name);
+      if (program_file.good()) {
+        try {
+          auto p = parseStatsProgram(parser, program_file);
+          updated->updateProgramStats(id, p.program, p.submitter, p.formula,
+                                      p.offset);
+          num_processed++;
+        } catch (const std::exception& exc) {
+          Log::get().error(
+              "Error parsing " + file_name + ": " + std::string(exc.what()),
+              false);
+        }
+      }
     }
   }
 
+  // sequence stats are cheap to recompute
+  for (const auto& s : sequences) {
+    updated->updateSequenceStats(s.id, updated->program_lengths.count(s.id),
+                                 updated->has_formula.exists(s.id));
+  }
+  updated->programs_commit = head_commit;
+
   // write stats
-  stats->finalize();
-  stats->save(stats_home);
+  updated->finalize();
+  updated->save(stats_home);
+  stats = std::move(updated);
 
   // print summary
-  auto cur_time = std::chrono::steady_clock::now();
-  double duration = std::chrono::duration_cast<std::chrono::milliseconds>(
-                        cur_time - start_time)
-                        .count() /
-                    1000.0;
-  std::stringstream buf;
-  buf.setf(std::ios::fixed);
-  buf.precision(2);
-  buf << duration;
-  Log::get().info("Generated stats for " + std::to_string(num_processed) +
-                  " programs in " + buf.str() + "s");
+  logStatsDuration("Updated", num_processed, start_time);
+  return true;
 }
 
 void MineManager::cleanupListFiles() {
@@ -460,11 +653,11 @@ const Stats& MineManager::getStats() {
       cleanupListFiles();
     }
     try {
-      stats->load(stats_home);
+      stats->load(stats_home, true);
     } catch (const std::exception& e) {
       Log::get().warn("Exception during stats loading, regenerating...");
-      generateStats(age_in_days);
-      stats->load(stats_home);  // reload
+      generateStats(age_in_days, false);
+      stats->load(stats_home, true);  // reload
     }
     // lock released at the end of this block
   }
@@ -498,7 +691,7 @@ void MineManager::addSeqComments(Program& p) const {
         op.source.type == Operand::Type::CONSTANT) {
       const auto id = UID::castFromInt(op.source.value.asInt());
       if (sequences.exists(id)) {
-        op.comment = sequences.get(id).name;
+        op.comment = sequences.getName(id);
       }
     }
   }
@@ -508,7 +701,7 @@ int64_t MineManager::updateProgramOffset(UID id, Program& p) const {
   if (!sequences.exists(id)) {
     return 0;
   }
-  return ProgramUtil::setOffset(p, sequences.get(id).offset);
+  return ProgramUtil::setOffset(p, sequences.getOffset(id));
 }
 
 void MineManager::updateDependentOffset(UID id, UID used_id, int64_t delta) {
@@ -558,7 +751,7 @@ std::string MineManager::dumpProgram(UID id, Program& p,
   Comments::removeComments(p);
   addSeqComments(p);
   ensureDir(file);
-  const auto& seq = sequences.get(id);
+  const auto seq = sequences.get(id);
   Program tmp;
   Operation nop(Operation::Type::NOP);
   nop.comment = seq.string();
@@ -598,7 +791,7 @@ std::string MineManager::dumpProgram(UID id, Program& p,
 void MineManager::alert(Program p, UID id, const std::string& prefix,
                         const std::string& color, const std::string& formula,
                         const std::string& submitter) const {
-  const auto& seq = sequences.get(id);
+  const auto seq = sequences.get(id);
   std::string msg, full;
   // msg is for logging (no markdown escaping needed)
   msg = prefix + " program for " + seq.string();
@@ -675,7 +868,7 @@ update_program_result_t MineManager::updateProgram(
   }
 
   // check if there is an existing program already
-  auto& seq = sequences.get(id);
+  const auto seq = sequences.get(id, false);  // name not needed
   auto existing = getExistingProgram(id);
   bool is_new = existing.ops.empty();
 
@@ -692,16 +885,19 @@ update_program_result_t MineManager::updateProgram(
   check_result_t checked;
   bool full_check = full_check_list.find(seq.id) != full_check_list.end();
   auto num_usages = stats->getNumUsages(seq.id);
-  switch (validation_mode) {
-    case ValidationMode::BASIC:
-      checked = finder.getChecker().checkProgramBasic(
-          p, existing, is_new, seq, change_type, submitter, previous_hash,
-          full_check, num_usages);
-      break;
-    case ValidationMode::EXTENDED:
-      checked = finder.getChecker().checkProgramExtended(
-          p, existing, is_new, seq, full_check, num_usages);
-      break;
+  {
+    StageTimer::Span span(StageTimer::Stage::VALIDATE);
+    switch (validation_mode) {
+      case ValidationMode::BASIC:
+        checked = finder.getChecker().checkProgramBasic(
+            p, existing, is_new, seq, change_type, submitter, previous_hash,
+            full_check, num_usages);
+        break;
+      case ValidationMode::EXTENDED:
+        checked = finder.getChecker().checkProgramExtended(
+            p, existing, is_new, seq, full_check, num_usages);
+        break;
+    }
   }
   // not better or the same after optimization?
   if (checked.status.empty() || (!is_new && checked.program == existing)) {
@@ -722,7 +918,11 @@ update_program_result_t MineManager::updateProgram(
   const std::string target_file = ProgramUtil::getProgramPath(id, !is_server);
   auto delta = updateProgramOffset(id, result.program);
   optimizer.optimize(result.program);
-  const auto formula = dumpProgram(id, result.program, target_file, submitter);
+  std::string formula;
+  {
+    StageTimer::Span span(StageTimer::Stage::DUMP);
+    formula = dumpProgram(id, result.program, target_file, submitter);
+  }
   if (is_server) {
     updateAllDependentOffset(id, delta);
   }
@@ -750,7 +950,7 @@ bool MineManager::maintainProgram(UID id, bool eval) {
   if (id.number() == 0 || !sequences.exists(id)) {
     return true;
   }
-  auto& s = sequences.get(id);
+  const auto s = sequences.get(id);
 
   // try to open the program file
   const std::string file_name = ProgramUtil::getProgramPath(s.id);
@@ -41,6 +41,8 @@ class MineManager {
 
   Finder& getFinder();
 
+  Minimizer& getMinimizer() { return minimizer; }
+
   size_t getTotalCount() const { return loader.getNumTotal(); }
 
   Program getExistingProgram(UID id);
@@ -66,7 +68,9 @@ class MineManager {
  private:
   bool shouldMatch(const ManagedSequence& seq) const;
 
-  void generateStats(int64_t age_in_days);
+  void generateStats(int64_t age_in_days, bool incremental = true);
+
+  bool updateStatsIncrementally();
 
   void cleanupListFiles();
 
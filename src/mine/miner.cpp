@@ -1,5 +1,6 @@
 #include "mine/miner.hpp"
 
+#include <cctype>
 #include <chrono>
 #include <fstream>
 #include <sstream>
@@ -8,6 +9,7 @@
 
 #include "eval/interpreter.hpp"
 #include "eval/optimizer.hpp"
+#include "eval/result_cache.hpp"
 #include "gen/generator.hpp"
 #include "lang/comments.hpp"
 #include "lang/parser.hpp"
@@ -18,6 +20,7 @@
 #include "seq/seq_program.hpp"
 #include "sys/file.hpp"
 #include "sys/log.hpp"
+#include "sys/memory_budget.hpp"
 #include "sys/metrics.hpp"
 
 const std::string Miner::UNKNOWN("unknown");
@@ -39,16 +42,44 @@ Miner::Miner(const Settings& settings, ProgressMonitor* progress_monitor)
       num_processed(0),
       num_removed(0),
       num_reported_hours(0),
-      current_fetch(0) {}
+      current_fetch(0),
+      max_programs(0),
+      max_seconds(0) {}
+
+void Miner::setLimits(int64_t programs, int64_t seconds) {
+  max_programs = programs;
+  max_seconds = seconds;
+}
+
+Miner::Counters Miner::getCounters() const {
+  auto result = counters;
+  if (manager) {
+    result.cells = manager->getFinder().getNumEvaluatedCells();
+  }
+  return result;
+}
 
 void Miner::reload() {
-  api_client.reset(new ApiClient());
+  if (!api_client) {
+    api_client.reset(new ApiClient());  // keep pending submissions on reload
+  }
   manager.reset(new MineManager(settings));
   manager->load();
   manager->getFinder();  // initializes stats and matchers
   const auto miner_config = ConfigLoader::load(settings);
   profile_name = miner_config.name;
   validation_mode = miner_config.validation_mode;
+  if (mining_mode == MINING_MODE_CLIENT) {
+    // separate spill files for miner profiles
+    std::string spill_name = profile_name;
+    for (auto& ch : spill_name) {
+      if (!std::isalnum(static_cast<unsigned char>(ch))) {
+        ch = '_';
+      }
+    }
+    api_client->startSubmissions(Setup::getCacheHome() + "submissions_" +
+                                 spill_name + ".jsonl");
+  }
   if (mining_mode == MINING_MODE_SERVER || submit_mode) {
     multi_generator.reset();
   } else {
@@ -160,6 +191,7 @@ void Miner::runMineLoop() {
     Comments::removeComments(base_program);
 
     // start with constants mutations; later do random mutation
+    StageTimer::Span span(StageTimer::Stage::MUTATE);
     mutator->mutateCopiesConstants(base_program, NUM_MUTATIONS, progs);
   }
 
@@ -180,8 +212,21 @@ void Miner::runMineLoop() {
   std::string submitter;
   std::string submitted_profile;
   current_fetch = (mining_mode == MINING_MODE_SERVER) ? PROGRAMS_TO_FETCH : 0;
+
+  // reuse minimization results of earlier runs for the maintenance work
+  const std::string result_cache_path =
+      Setup::getCacheHome() + ResultCache::FILENAME;
+  if (mining_mode == MINING_MODE_SERVER) {
+    ResultCache::get().setMaxEntries(ResultCache::SERVER_MAX_ENTRIES);
+    ResultCache::get().load(result_cache_path);
+  }
   num_processed = 0;
   num_removed = 0;
+  counters = Counters();
+  StageTimer::collect();  // discard earlier measurements
+  stage_times_log = StageTimer::Histograms();
+  stage_times_metrics = StageTimer::Histograms();
+  loop_start_time = std::chrono::steady_clock::now();
   while (true) {
     // if queue is empty: fetch or generate a new program
     if (progs.empty()) {
@@ -210,14 +255,20 @@ void Miner::runMineLoop() {
         // client mode
         if (base_program.ops.empty()) {
           // generate new program
-          program = multi_generator->generateProgram();
+          {
+            StageTimer::Span span(StageTimer::Stage::GENERATE);
+            program = multi_generator->generateProgram();
+          }
           if (program.ops.empty() && multi_generator->isFinished()) {
             break;
           }
           progs.push(std::move(program));
+          counters.generated++;
         } else {
           // mutate base program
+          StageTimer::Span span(StageTimer::Stage::MUTATE);
           mutator->mutateCopiesRandom(base_program, NUM_MUTATIONS, progs);
+          counters.mutated += progs.size();
         }
       }
     }
@@ -252,6 +303,7 @@ void Miner::runMineLoop() {
       if (seq_programs.empty()) {
         seq_programs = manager->getFinder().findSequence(
             program, norm_seq, manager->getSequences());
+        counters.matches += seq_programs.size();
       }
 
       // validate matched programs and update existing programs
@@ -263,7 +315,9 @@ void Miner::runMineLoop() {
         updateSubmitter(program);
         update_result =
             manager->updateProgram(s.first, program, validation_mode);
+        counters.validations++;
         if (update_result.updated) {
+          counters.updates++;
           // update metrics
           submitter = Comments::getSubmitter(program);
           if (submitter.empty()) {
@@ -288,7 +342,8 @@ void Miner::runMineLoop() {
                     program, Comments::PREFIX_PREVIOUS_HASH + " " +
                                  std::to_string(update_result.previous_hash));
               }
-              api_client->postProgram(program, 10);  // magic number
+              StageTimer::Span span(StageTimer::Stage::SUBMIT);
+              api_client->postProgram(program);
             } else {
               Log::get().warn("Skipping program submission for " +
                               s.first.string());
@@ -296,10 +351,13 @@ void Miner::runMineLoop() {
           }
           // mutate successful program
           if (mining_mode != MINING_MODE_SERVER && progs.size() < MAX_BACKLOG) {
+            StageTimer::Span span(StageTimer::Stage::MUTATE);
+            const auto num_progs = progs.size();
             mutator->mutateCopiesConstants(update_result.program,
                                            NUM_MUTATIONS / 2, progs);
             mutator->mutateCopiesRandom(update_result.program,
                                         NUM_MUTATIONS / 2, progs);
+            counters.mutated += progs.size() - num_progs;
           }
         }
       }
@@ -317,6 +375,7 @@ void Miner::runMineLoop() {
     }
 
     num_processed++;
+    counters.programs++;
     if (!checkRegularTasks()) {
       break;
     }
@@ -325,6 +384,10 @@ void Miner::runMineLoop() {
   // final progress message
   logProgress(false);
 
+  if (mining_mode == MINING_MODE_SERVER) {
+    ResultCache::get().save(result_cache_path);
+  }
+
   // report remaining cpu hours
   while (num_reported_hours < settings.num_mine_hours) {
     reportCPUHour();
@@ -337,6 +400,16 @@ bool Miner::checkRegularTasks() {
   }
   bool result = true;
 
+  // optional limits of the mining loop
+  if (max_programs > 0 && counters.programs >= max_programs) {
+    return false;
+  }
+  if (max_seconds > 0 &&
+      std::chrono::steady_clock::now() - loop_start_time >=
+          std::chrono::seconds(max_seconds)) {
+    return false;
+  }
+
   // regular task: log info
   if (log_scheduler.isTargetReached()) {
     log_scheduler.reset();
@@ -367,6 +440,80 @@ bool Miner::checkRegularTasks() {
     labels.clear();
     labels["kind"] = "removed";
     entries.push_back({"programs", labels, static_cast<double>(num_removed)});
+    auto& cache = ResultCache::get();
+    labels["kind"] = "hit";
+    entries.push_back(
+        {"result_cache", labels, static_cast<double>(cache.getNumHits())});
+    labels["kind"] = "miss";
+    entries.push_back(
+        {"result_cache", labels, static_cast<double>(cache.getNumMisses())});
+    cache.resetCounts();
+    auto& finder = manager->getFinder();
+    if (finder.usesPrefilter()) {
+      labels["kind"] = "rejected";
+      entries.push_back({"prefilter", labels,
+                         static_cast<double>(finder.getNumPrefilterRejected())});
+      labels["kind"] = "skipped";
+      entries.push_back({"prefilter", labels,
+                         static_cast<double>(finder.getNumPrefilterSkipped())});
+      finder.resetPrefilterCounts();
+    }
+    auto& evaluator = finder.getEvaluator();
+    labels["kind"] = "aborted";
+    entries.push_back({"early_abort", labels,
+                       static_cast<double>(evaluator.getNumCostAborts())});
+    labels["kind"] = "saved_seconds";
+    entries.push_back(
+        {"early_abort", labels, evaluator.getCostSavedSeconds()});
+    evaluator.resetCostCounts();
+    collectStageTimes();
+    labels.clear();
+    for (size_t i = 0; i < StageTimer::NUM_STAGES; i++) {
+      const auto& h = stage_times_metrics[i];
+      if (h.count == 0) {
+        continue;
+      }
+      labels["stage"] = StageTimer::getName(static_cast<StageTimer::Stage>(i));
+      labels["kind"] = "count";
+      entries.push_back({"stage_time", labels, static_cast<double>(h.count)});
+      labels["kind"] = "total_us";
+      entries.push_back({"stage_time", labels, static_cast<double>(h.total)});
+      labels["kind"] = "p50_us";
+      entries.push_back(
+          {"stage_time", labels, static_cast<double>(h.quantile(0.5))});
+      labels["kind"] = "p95_us";
+      entries.push_back(
+          {"stage_time", labels, static_cast<double>(h.quantile(0.95))});
+      labels["kind"] = "max_us";
+      entries.push_back({"stage_time", labels, static_cast<double>(h.max)});
+      // cumulative histogram buckets up to the largest duration
+      labels.erase("kind");
+      size_t sum = 0;
+      for (size_t b = 0; b < StageTimer::NUM_BUCKETS && sum < h.count; b++) {
+        sum += h.buckets[b];
+        labels["le"] = (b + 1 < StageTimer::NUM_BUCKETS)
+                           ? std::to_string(StageTimer::getBucketBound(b))
+                           : "inf";
+        entries.push_back(
+            {"stage_histogram", labels, static_cast<double>(sum)});
+      }
+      labels.erase("le");
+    }
+    stage_times_metrics = StageTimer::Histograms();
+    auto& budget = MemoryBudget::get();
+    budget.update();
+    labels.clear();
+    for (size_t i = 0; i < MemoryBudget::NUM_SUBSYSTEMS; i++) {
+      const auto s = static_cast<MemoryBudget::Subsystem>(i);
+      labels["subsystem"] = MemoryBudget::getName(s);
+      entries.push_back({"memory", labels,
+                         static_cast<double>(budget.getAccount(s).getUsage())});
+    }
+    labels["subsystem"] = "process";
+    entries.push_back({"memory", labels, static_cast<double>(getMemUsage())});
+    if (mining_mode == MINING_MODE_SERVER) {
+      cache.save(Setup::getCacheHome() + ResultCache::FILENAME);
+    }
     Metrics::get().write(entries);
     num_new_per_user.clear();
     num_updated_per_user.clear();
@@ -404,6 +551,22 @@ void Miner::logProgress(bool report_slow) {
   } else if (report_slow) {
     Log::get().warn("Slow processing of programs" + progress);
   }
+  collectStageTimes();
+  const auto summary = StageTimer::summarize(stage_times_log);
+  if (!summary.empty()) {
+    Log::get().info("Stage times: " + summary);
+  }
+  stage_times_log = StageTimer::Histograms();
+  Log::get().info("Memory usage: " + MemoryBudget::get().summarize());
+}
+
+void Miner::collectStageTimes() {
+  // the measurements are shared by the log and the metrics
+  const auto histograms = StageTimer::collect();
+  for (size_t i = 0; i < StageTimer::NUM_STAGES; i++) {
+    stage_times_log[i].merge(histograms[i]);
+    stage_times_metrics[i].merge(histograms[i]);
+  }
 }
 
 void Miner::reportCPUHour() {
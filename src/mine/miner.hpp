@@ -11,6 +11,7 @@
 #include "mine/matcher.hpp"
 #include "mine/mine_manager.hpp"
 #include "mine/mutator.hpp"
+#include "mine/stage_timer.hpp"
 #include "sys/setup.hpp"
 #include "sys/util.hpp"
 
@@ -24,6 +25,7 @@ class Miner {
     ValidationMode validation_mode;
     std::vector<Generator::Config> generators;
     std::vector<Matcher::Config> matchers;
+    bool prefilter = false;
 
     bool usesBackoff() const {
       return std::any_of(matchers.begin(), matchers.end(),
@@ -40,6 +42,23 @@ class Miner {
 
   void setBaseProgram(const Program &p) { base_program = p; }
 
+  // Throughput counters of the mining loop.
+  struct Counters {
+    int64_t generated = 0;    // programs from the generators
+    int64_t mutated = 0;      // programs from mutations
+    int64_t programs = 0;     // processed programs
+    int64_t cells = 0;        // evaluated candidate memory cells
+    int64_t matches = 0;      // potential matches found by the finder
+    int64_t validations = 0;  // validated matches
+    int64_t updates = 0;      // new or updated programs
+  };
+
+  // Stops the mining loop after the given number of processed programs or
+  // seconds. Zero means no limit.
+  void setLimits(int64_t max_programs, int64_t max_seconds);
+
+  Counters getCounters() const;
+
  private:
   void runMineLoop();
 
@@ -53,6 +72,8 @@ class Miner {
 
   void logProgress(bool report_slow);
 
+  void collectStageTimes();
+
   void reportCPUHour();
 
   static const std::string UNKNOWN;
@@ -79,6 +100,12 @@ class Miner {
   int64_t num_removed;
   int64_t num_reported_hours;
   int64_t current_fetch;
+  int64_t max_programs;
+  int64_t max_seconds;
+  std::chrono::time_point<std::chrono::steady_clock> loop_start_time;
+  Counters counters;
+  StageTimer::Histograms stage_times_log;
+  StageTimer::Histograms stage_times_metrics;
   std::map<std::string, int64_t> num_new_per_user;
   std::map<std::string, int64_t> num_updated_per_user;
 };
@@ -0,0 +1,159 @@
+#include "mine/stage_timer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <set>
+
+#include "sys/trace.hpp"
+#include "sys/util.hpp"
+
+namespace {
+
+const char* const STAGE_NAMES[StageTimer::NUM_STAGES] = {
+    "generate", "mutate",   "evaluate", "match",  "check",
+    "validate", "minimize", "dump",     "submit"};
+
+struct LocalAggregate;
+
+struct Registry {
+  std::mutex mutex;
+  std::set<LocalAggregate*> locals;
+  StageTimer::Histograms retired;  // aggregates of finished threads
+};
+
+Registry& getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+// The lock is only contended while the aggregates are collected.
+struct LocalAggregate {
+  std::mutex mutex;
+  StageTimer::Histograms histograms;
+
+  LocalAggregate() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.locals.insert(this);
+  }
+
+  ~LocalAggregate() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (size_t i = 0; i < StageTimer::NUM_STAGES; i++) {
+      registry.retired[i].merge(histograms[i]);
+    }
+    registry.locals.erase(this);
+  }
+};
+
+LocalAggregate& getLocal() {
+  thread_local LocalAggregate local;
+  return local;
+}
+
+}  // namespace
+
+void StageTimer::Histogram::add(int64_t micros) {
+  micros = std::max<int64_t>(micros, 0);
+  size_t bucket = 0;
+  while (bucket + 1 < NUM_BUCKETS && micros >= getBucketBound(bucket)) {
+    bucket++;
+  }
+  buckets[bucket]++;
+  count++;
+  total += micros;
+  max = std::max(max, micros);
+}
+
+void StageTimer::Histogram::merge(const Histogram& h) {
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    buckets[i] += h.buckets[i];
+  }
+  count += h.count;
+  total += h.total;
+  max = std::max(max, h.max);
+}
+
+int64_t StageTimer::Histogram::quantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto target = static_cast<size_t>(std::ceil(q * count));
+  size_t sum = 0;
+  for (size_t i = 0; i < NUM_BUCKETS; i++) {
+    sum += buckets[i];
+    if (sum >= target) {
+      return std::min(getBucketBound(i), max);
+    }
+  }
+  return max;
+}
+
+StageTimer::Span::~Span() {
+  const auto end = std::chrono::steady_clock::now();
+  const auto micros =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+          .count();
+  StageTimer::add(stage, micros);
+  if (Trace::isEnabled()) {
+    Trace::record("mine", STAGE_NAMES[static_cast<size_t>(stage)], start, end);
+  }
+}
+
+std::string StageTimer::getName(Stage stage) {
+  return STAGE_NAMES[static_cast<size_t>(stage)];
+}
+
+int64_t StageTimer::getBucketBound(size_t bucket) {
+  if (bucket + 1 >= NUM_BUCKETS) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  return static_cast<int64_t>(1) << bucket;
+}
+
+void StageTimer::add(Stage stage, int64_t micros) {
+  auto& local = getLocal();
+  std::lock_guard<std::mutex> lock(local.mutex);
+  local.histograms[static_cast<size_t>(stage)].add(micros);
+}
+
+StageTimer::Histograms StageTimer::collect() {
+  auto& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  Histograms result = registry.retired;
+  registry.retired = Histograms();
+  for (auto local : registry.locals) {
+    std::lock_guard<std::mutex> local_lock(local->mutex);
+    for (size_t i = 0; i < NUM_STAGES; i++) {
+      result[i].merge(local->histograms[i]);
+    }
+    local->histograms = Histograms();
+  }
+  return result;
+}
+
+std::string StageTimer::summarize(const Histograms& histograms) {
+  std::vector<size_t> order;
+  for (size_t i = 0; i < NUM_STAGES; i++) {
+    if (histograms[i].count > 0) {
+      order.push_back(i);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return histograms[a].total > histograms[b].total;
+  });
+  std::string result;
+  for (auto i : order) {
+    const auto& h = histograms[i];
+    if (!result.empty()) {
+      result += ", ";
+    }
+    result += getName(static_cast<Stage>(i)) + " " + formatDuration(h.total) +
+              " (" + std::to_string(h.count) + "x, p95 " +
+              formatDuration(h.quantile(0.95)) + ")";
+  }
+  return result;
+}
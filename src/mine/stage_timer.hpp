@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timing statistics of the stages of the mining pipeline. Durations are
+// measured with steady_clock and aggregated per thread into histograms with
+// power-of-two buckets in microseconds, so that recording a span does not
+// need any synchronization across threads. The aggregates of all threads are
+// collected periodically by the miner. Stages can be nested, e.g. the
+// validation stage includes the minimization stage.
+class StageTimer {
+ public:
+  enum class Stage {
+    GENERATE,
+    MUTATE,
+    EVALUATE,
+    MATCH,
+    CHECK,
+    VALIDATE,
+    MINIMIZE,
+    DUMP,
+    SUBMIT,
+  };
+
+  static constexpr size_t NUM_STAGES = 9;
+
+  // bucket i counts durations below 2^i microseconds; the last bucket
+  // counts all remaining durations
+  static constexpr size_t NUM_BUCKETS = 28;
+
+  struct Histogram {
+    size_t count = 0;
+    int64_t total = 0;  // microseconds
+    int64_t max = 0;    // microseconds
+    std::array<size_t, NUM_BUCKETS> buckets{};
+
+    void add(int64_t micros);
+
+    void merge(const Histogram& h);
+
+    // Returns an upper bound of the given quantile in microseconds.
+    int64_t quantile(double q) const;
+  };
+
+  using Histograms = std::array<Histogram, NUM_STAGES>;
+
+  // Measures the duration of a stage until the end of the current scope.
+  class Span {
+   public:
+    explicit Span(Stage stage)
+        : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+    ~Span();
+
+   private:
+    const Stage stage;
+    const std::chrono::time_point<std::chrono::steady_clock> start;
+  };
+
+  static std::string getName(Stage stage);
+
+  // Returns the exclusive upper bound of a bucket in microseconds.
+  static int64_t getBucketBound(size_t bucket);
+
+  // Records a duration of a stage in the aggregate of the current thread.
+  static void add(Stage stage, int64_t micros);
+
+  // Merges and resets the aggregates of all threads.
+  static Histograms collect();
+
+  // Returns a one-line summary of the stages ordered by their total time.
+  static std::string summarize(const Histograms& histograms);
+};
@@ -1,9 +1,12 @@
 #include "mine/stats.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 
 #include "eval/evaluator_inc.hpp"
 #include "form/formula_parser.hpp"
@@ -26,6 +29,7 @@ const std::string Stats::PROGRAMS_HEADER(
 const std::string Stats::STEPS_HEADER("total,min,max,runs");
 const std::string Stats::SUMMARY_HEADER(
     "num_sequences,num_programs,num_formulas");
+const std::string Stats::INFO_HEADER("programs_commit,version");
 const std::string SUBMITTERS_HEADER = "submitter,ref_id,num_programs";
 const std::string OPERATION_TYPES_HEADER = "name,ref_id,count";
 
@@ -33,107 +37,17 @@ Stats::Stats()
     : num_programs(0),
       num_sequences(0),
       num_formulas(0),
-      num_ops_per_type(Operation::Types.size(), 0) {}
+      num_ops_per_type(Operation::Types.size(), 0),
+      counts_from_snapshot(false),
+      count_maps_pending(false),
+      memory_usage(MemoryBudget::Subsystem::STATS) {}
 
-void Stats::load(std::string path) {
+void Stats::load(std::string path, bool use_snapshot) {
   ensureTrailingFileSep(path);
   Log::get().debug("Loading program stats from " + path);
   auto start_time = std::chrono::steady_clock::now();
 
   std::string full;
-  Parser parser;
-  Operation op;
-  Operand count;
-
-  {
-    full = path + "constant_counts.csv";
-    Log::get().debug("Loading " + full);
-    CsvReader reader(full);
-    while (reader.readRow()) {
-      num_constants[Number(reader.getField(0))] = reader.getIntegerField(1);
-    }
-    reader.close();
-  }
-
-  {
-    full = path + "program_lengths.csv";
-    Log::get().debug("Loading " + full);
-    CsvReader reader(full);
-    while (reader.readRow()) {
-      auto l = reader.getIntegerField(0);
-      while (l >= (int64_t)num_programs_per_length.size()) {
-        num_programs_per_length.push_back(0);
-      }
-      num_programs_per_length[l] = reader.getIntegerField(1);
-    }
-    reader.close();
-  }
-
-  {
-    full = path + "operation_types.csv";
-    Log::get().debug("Loading " + full);
-    CsvReader reader(full);
-    reader.checkHeader(OPERATION_TYPES_HEADER);
-    while (reader.readRow()) {
-      auto type = Operation::Metadata::get(reader.getField(0)).type;
-      // Field 1 is ref_id, which we don't need to load (it's in metadata)
-      num_ops_per_type.at(static_cast<size_t>(type)) =
-          reader.getIntegerField(2);
-    }
-    reader.close();
-  }
-
-  {
-    full = path + "operation_counts.csv";
-    Log::get().debug("Loading " + full);
-    std::ifstream op_counts(full);
-    parser.in = &op_counts;
-    while (true) {
-      op_counts >> std::ws;
-      if (op_counts.peek() == EOF) {
-        break;
-      }
-      op.type = parser.readOperationType();
-      parser.readSeparator(',');
-      op.target = parser.readOperand();
-      parser.readSeparator(',');
-      op.source = parser.readOperand();
-      parser.readSeparator(',');
-      count = parser.readOperand();
-      num_operations[op] = count.value.asInt();
-    }
-    op_counts.close();
-  }
-
-  {
-    full = path + "operation_pos_counts.csv";
-    Log::get().debug("Loading " + full);
-    std::ifstream op_pos_counts(full);
-    parser.in = &op_pos_counts;
-    OpPos opPos;
-    Operand pos, length;
-    while (true) {
-      op_pos_counts >> std::ws;
-      if (op_pos_counts.peek() == EOF) {
-        break;
-      }
-      pos = parser.readOperand();
-      opPos.pos = pos.value.asInt();
-      parser.readSeparator(',');
-      length = parser.readOperand();
-      opPos.len = length.value.asInt();
-      parser.readSeparator(',');
-      opPos.op.type = parser.readOperationType();
-      parser.readSeparator(',');
-      opPos.op.target = parser.readOperand();
-      parser.readSeparator(',');
-      opPos.op.source = parser.readOperand();
-      parser.readSeparator(',');
-      count = parser.readOperand();
-      num_operation_positions[opPos] = count.value.asInt();
-    }
-    op_pos_counts.close();
-  }
 
   {
     full = path + "programs.csv";
@@ -216,6 +130,18 @@ void Stats::load(std::string path) {
     blocks.load(path + "blocks.asm");
   }
 
+  full = path + "info.csv";
+  if (isFile(full)) {  // optional
+    Log::get().debug("Loading " + full);
+    CsvReader reader(full);
+    reader.checkHeader(INFO_HEADER);
+    if (reader.readRow() && reader.numFields() == 2) {
+      programs_commit = reader.getField(0);
+      version = reader.getField(1);
+    }
+    reader.close();
+  }
+
   {
     full = path + "submitters.csv";
     Log::get().debug("Loading " + full);
@@ -233,8 +159,18 @@ void Stats::load(std::string path) {
     reader.close();
   }
 
+  // use the binary snapshot of the counts if it is up-to-date
+  counts_from_snapshot = use_snapshot && loadSnapshot(path);
+  count_maps_pending = counts_from_snapshot;
+  if (!counts_from_snapshot) {
+    loadCounts(path);
+    snapshot = StatsSnapshot(*this);
+  }
+
   // TODO: remaining stats
 
+  updateMemoryUsage();
+
   auto cur_time = std::chrono::steady_clock::now();
   double duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                         cur_time - start_time)
@@ -248,8 +184,155 @@ void Stats::load(std::string path) {
                   " programs in " + buf.str() + "s");
 }
 
+bool Stats::loadSnapshot(const std::string& path) {
+  const auto file = path + StatsSnapshot::FILENAME;
+  const auto main_file = getMainStatsFile(path);
+  if (!isFile(file) || !isFile(main_file) ||
+      std::filesystem::last_write_time(file) <
+          std::filesystem::last_write_time(main_file)) {
+    return false;
+  }
+  Log::get().debug("Loading " + file);
+  StatsSnapshot loaded;
+  if (!loaded.load(file) || loaded.getNumPrograms() != num_programs) {
+    return false;
+  }
+  snapshot = loaded;
+  num_programs_per_length = snapshot.getNumProgramsPerLength();
+  num_ops_per_type = snapshot.getNumOpsPerType();
+  // lookups are served from the snapshot; the count maps are built on demand
+  num_constants.clear();
+  num_operations.clear();
+  num_operation_positions.clear();
+  return true;
+}
+
+void Stats::loadCountMaps() {
+  if (!count_maps_pending) {
+    return;
+  }
+  count_maps_pending = false;
+  // the snapshot arrays are sorted like the maps
+  num_constants.clear();
+  for (size_t i = 0; i < snapshot.numConstants(); i++) {
+    num_constants.emplace_hint(num_constants.end(), snapshot.getConstant(i),
+                               snapshot.getConstantCount(i));
+  }
+  num_operations.clear();
+  for (size_t i = 0; i < snapshot.numOperations(); i++) {
+    num_operations.emplace_hint(num_operations.end(),
+                                snapshot.getOperation(i),
+                                snapshot.getOperationCount(i));
+  }
+  num_operation_positions.clear();
+  for (size_t i = 0; i < snapshot.numOperationPositions(); i++) {
+    num_operation_positions.emplace_hint(num_operation_positions.end(),
+                                         snapshot.getOperationPosition(i),
+                                         snapshot.getOperationPositionCount(i));
+  }
+  updateMemoryUsage();
+}
+
+void Stats::loadCounts(const std::string& path) {
+  std::string full;
+  Parser parser;
+  Operation op;
+  Operand count;
+
+  {
+    full = path + "constant_counts.csv";
+    Log::get().debug("Loading " + full);
+    CsvReader reader(full);
+    while (reader.readRow()) {
+      num_constants[Number(reader.getField(0))] = reader.getIntegerField(1);
+    }
+    reader.close();
+  }
+
+  {
+    full = path + "program_lengths.csv";
+    Log::get().debug("Loading " + full);
+    CsvReader reader(full);
+    while (reader.readRow()) {
+      auto l = reader.getIntegerField(0);
+      while (l >= (int64_t)num_programs_per_length.size()) {
+        num_programs_per_length.push_back(0);
+      }
+      num_programs_per_length[l] = reader.getIntegerField(1);
+    }
+    reader.close();
+  }
+
+  {
+    full = path + "operation_types.csv";
+    Log::get().debug("Loading " + full);
+    CsvReader reader(full);
+    reader.checkHeader(OPERATION_TYPES_HEADER);
+    while (reader.readRow()) {
+      auto type = Operation::Metadata::get(reader.getField(0)).type;
+      // Field 1 is ref_id, which we don't need to load (it's in metadata)
+      num_ops_per_type.at(static_cast<size_t>(type)) =
+          reader.getIntegerField(2);
+    }
+    reader.close();
+  }
+
+  {
+    full = path + "operation_counts.csv";
+    Log::get().debug("Loading " + full);
+    std::ifstream op_counts(full);
+    parser.in = &op_counts;
+    while (true) {
+      op_counts >> std::ws;
+      if (op_counts.peek() == EOF) {
+        break;
+      }
+      op.type = parser.readOperationType();
+      parser.readSeparator(',');
+      op.target = parser.readOperand();
+      parser.readSeparator(',');
+      op.source = parser.readOperand();
+      parser.readSeparator(',');
+      count = parser.readOperand();
+      num_operations[op] = count.value.asInt();
+    }
+    op_counts.close();
+  }
+
+  {
+    full = path + "operation_pos_counts.csv";
+    Log::get().debug("Loading " + full);
+    std::ifstream op_pos_counts(full);
+    parser.in = &op_pos_counts;
+    OpPos opPos;
+    Operand pos, length;
+    while (true) {
+      op_pos_counts >> std::ws;
+      if (op_pos_counts.peek() == EOF) {
+        break;
+      }
+      pos = parser.readOperand();
+      opPos.pos = pos.value.asInt();
+      parser.readSeparator(',');
+      length = parser.readOperand();
+      opPos.len = length.value.asInt();
+      parser.readSeparator(',');
+      opPos.op.type = parser.readOperationType();
+      parser.readSeparator(',');
+      opPos.op.target = parser.readOperand();
+      parser.readSeparator(',');
+      opPos.op.source = parser.readOperand();
+      parser.readSeparator(',');
+      count = parser.readOperand();
+      num_operation_positions[opPos] = count.value.asInt();
+    }
+    op_pos_counts.close();
+  }
+}
+
 void Stats::save(std::string path) {
   ensureTrailingFileSep(path);
+  loadCountMaps();
   Log::get().debug("Saving program stats to " + path);
 
   {
@@ -371,16 +454,32 @@ void Stats::save(std::string path) {
     blocks.save(path + "blocks.asm");
   }
 
+  {
+    CsvWriter writer(path + "info.csv");
+    writer.writeHeader(INFO_HEADER);
+    writer.writeRow(programs_commit, version);
+    writer.close();
+  }
+
   {
     CsvWriter writer(path + "submitters.csv");
     writer.writeHeader(SUBMITTERS_HEADER);
     for (const auto& e : submitter_ref_ids) {
+      if (num_programs_per_submitter[e.second] == 0) {
+        continue;  // all programs removed by incremental updates
+      }
       writer.writeRow({e.first, std::to_string(e.second),
                        std::to_string(num_programs_per_submitter[e.second])});
     }
     writer.close();
   }
 
+  // write the snapshot last, so that it is not older than the CSV files
+  {
+    snapshot = StatsSnapshot(*this);
+    snapshot.save(path + StatsSnapshot::FILENAME);
+  }
+
   Log::get().debug("Finished saving program stats");
 }
 
@@ -405,7 +504,7 @@ void Stats::updateProgramStats(UID id, const Program& program,
   if (it != submitter_ref_ids.end()) {
     ref_id = it->second;
   } else {
-    ref_id = submitter_ref_ids.size() + 1;
+    ref_id = nextSubmitterRefId();
     submitter_ref_ids[submitter] = ref_id;
     if (ref_id >= static_cast<int64_t>(num_programs_per_submitter.size())) {
       num_programs_per_submitter.resize(ref_id + 1, 0);
@@ -503,6 +602,169 @@ void Stats::updateProgramStats(UID id, const Program& program,
   blocks_collector.add(program);
 }
 
+template <typename K>
+void decrementCount(std::map<K, int64_t>& counts, const K& key) {
+  auto it = counts.find(key);
+  if (it != counts.end() && --it->second <= 0) {
+    counts.erase(it);
+  }
+}
+
+void Stats::removeProgramStats(UID id, const Program& program,
+                               std::string submitter) {
+  auto length = program_lengths.find(id);
+  if (length == program_lengths.end()) {
+    return;  // not contained in the stats
+  }
+  if (length->second < static_cast<int64_t>(num_programs_per_length.size())) {
+    num_programs_per_length[length->second]--;
+  }
+  program_lengths.erase(length);
+  replaceAll(submitter, ",", "_");
+  auto it = submitter_ref_ids.find(submitter);
+  if (it != submitter_ref_ids.end() &&
+      it->second < static_cast<int64_t>(num_programs_per_submitter.size())) {
+    num_programs_per_submitter[it->second]--;
+  }
+  program_submitter.erase(id);
+  OpPos o;
+  o.len = program.ops.size();
+  o.pos = 0;
+  for (auto& op : program.ops) {
+    num_ops_per_type[static_cast<size_t>(op.type)]--;
+    if (op.type != Operation::Type::SEQ && op.type != Operation::Type::PRG &&
+        Operation::Metadata::get(op.type).num_operands == 2 &&
+        op.source.type == Operand::Type::CONSTANT) {
+      decrementCount(num_constants, op.source.value);
+    }
+    if (op.type != Operation::Type::NOP) {
+      decrementCount(num_operations, op);
+      o.op = op;
+      decrementCount(num_operation_positions, o);
+    }
+    if ((op.type == Operation::Type::SEQ || op.type == Operation::Type::PRG) &&
+        op.source.type == Operand::Type::CONSTANT) {
+      auto called = UID::castFromInt(op.source.value.asInt());
+      auto usages = program_usages.find(called);
+      if (usages != program_usages.end() && --usages->second <= 0) {
+        program_usages.erase(usages);
+      }
+    }
+    o.pos++;
+  }
+  call_graph.erase(id);
+  supports_inceval.erase(id);
+  supports_logeval.erase(id);
+  supports_vireval.erase(id);
+  has_loop.erase(id);
+  has_formula.erase(id);
+  has_pari.erase(id);
+  has_lean.erase(id);
+  has_indirect.erase(id);
+  program_operation_types_bitmask.erase(id);
+  blocks_collector.remove(program);
+}
+
+template <typename K>
+void mergeCounts(std::map<K, int64_t>& counts,
+                 const std::map<K, int64_t>& other) {
+  for (const auto& e : other) {
+    counts[e.first] += e.second;
+  }
+}
+
+void mergeCounts(std::vector<int64_t>& counts,
+                 const std::vector<int64_t>& other) {
+  if (other.size() > counts.size()) {
+    counts.resize(other.size(), 0);
+  }
+  for (size_t i = 0; i < other.size(); i++) {
+    counts[i] += other[i];
+  }
+}
+
+void mergeIds(UIDSet& ids, const UIDSet& other) {
+  for (auto id : other) {
+    ids.insert(id);
+  }
+}
+
+void Stats::merge(const Stats& other) {
+  if (other.count_maps_pending) {
+    throw std::runtime_error("Cannot merge stats loaded from a snapshot");
+  }
+  loadCountMaps();
+  num_programs += other.num_programs;
+  num_sequences += other.num_sequences;
+  num_formulas += other.num_formulas;
+  mergeCounts(num_constants, other.num_constants);
+  mergeCounts(num_operations, other.num_operations);
+  mergeCounts(num_operation_positions, other.num_operation_positions);
+  mergeCounts(num_programs_per_length, other.num_programs_per_length);
+  mergeCounts(num_ops_per_type, other.num_ops_per_type);
+
+  // map submitter IDs in the order of their first occurrence
+  std::vector<std::string> other_submitters(
+      other.num_programs_per_submitter.size());
+  for (const auto& e : other.submitter_ref_ids) {
+    other_submitters.at(e.second) = e.first;
+  }
+  std::vector<int64_t> ref_ids(other_submitters.size(), 0);
+  for (size_t i = 0; i < other_submitters.size(); i++) {
+    if (other.num_programs_per_submitter[i] == 0 &&
+        other_submitters[i].empty()) {
+      continue;
+    }
+    auto it = submitter_ref_ids.find(other_submitters[i]);
+    if (it != submitter_ref_ids.end()) {
+      ref_ids[i] = it->second;
+    } else {
+      ref_ids[i] = nextSubmitterRefId();
+      submitter_ref_ids[other_submitters[i]] = ref_ids[i];
+    }
+    if (ref_ids[i] >= static_cast<int64_t>(num_programs_per_submitter.size())) {
+      num_programs_per_submitter.resize(ref_ids[i] + 1, 0);
+    }
+    num_programs_per_submitter[ref_ids[i]] +=
+        other.num_programs_per_submitter[i];
+  }
+  for (const auto& e : other.program_submitter) {
+    program_submitter[e.first] = ref_ids.at(e.second);
+  }
+
+  call_graph.insert(other.call_graph.begin(), other.call_graph.end());
+  for (const auto& e : other.program_lengths) {
+    program_lengths[e.first] = e.second;
+  }
+  for (const auto& e : other.program_usages) {
+    program_usages[e.first] += e.second;
+  }
+  for (const auto& e : other.program_operation_types_bitmask) {
+    program_operation_types_bitmask[e.first] = e.second;
+  }
+  mergeIds(all_program_ids, other.all_program_ids);
+  mergeIds(latest_program_ids, other.latest_program_ids);
+  mergeIds(supports_inceval, other.supports_inceval);
+  mergeIds(supports_logeval, other.supports_logeval);
+  mergeIds(supports_vireval, other.supports_vireval);
+  mergeIds(has_loop, other.has_loop);
+  mergeIds(has_formula, other.has_formula);
+  mergeIds(has_pari, other.has_pari);
+  mergeIds(has_lean, other.has_lean);
+  mergeIds(has_indirect, other.has_indirect);
+  blocks_collector.merge(other.blocks_collector);
+}
+
+void Stats::prepareIncrementalUpdate() {
+  loadCountMaps();
+  num_sequences = 0;
+  num_programs = 0;
+  num_formulas = 0;
+  blocks_collector.add(blocks);
+  blocks = Blocks();
+  latest_program_ids.clear();
+}
+
 void Stats::updateSequenceStats(UID id, bool program_found,
                                 bool formula_found) {
   num_sequences++;
@@ -522,10 +784,71 @@ void Stats::finalize() {
     }
     blocks = blocks_collector.finalize();
   }
+  normalizeSubmitterRefIds();
   if (latest_program_ids.empty()) {
     latest_program_ids = SequenceProgram::collectLatestProgramIds(
         Setup::NUM_COMMITS_FOR_PROGRAMS, 200, 200);  // magic number
   }
+  updateMemoryUsage();
+}
+
+void Stats::updateMemoryUsage() {
+  const int64_t node = MemoryBudget::NODE_OVERHEAD;
+  const int64_t count = sizeof(int64_t);
+  const int64_t id_entry = sizeof(UID) + count + node;
+  int64_t bytes = num_constants.size() * (sizeof(Number) + count + node);
+  bytes += num_operations.size() * (sizeof(Operation) + count + node);
+  bytes += num_operation_positions.size() * (sizeof(OpPos) + count + node);
+  bytes += submitter_ref_ids.size() * (sizeof(std::string) + count + node);
+  bytes += call_graph.size() * (2 * sizeof(UID) + node);
+  bytes += program_lengths.size() * id_entry;
+  bytes += program_usages.size() * id_entry;
+  bytes += program_submitter.size() * id_entry;
+  bytes += program_operation_types_bitmask.size() * id_entry;
+  bytes += blocks.list.ops.capacity() * sizeof(Operation);
+  memory_usage.set(bytes);
+}
+
+int64_t Stats::nextSubmitterRefId() const {
+  // ref IDs start at 1 and are never reused
+  return std::max<int64_t>(num_programs_per_submitter.size(), 1);
+}
+
+void Stats::normalizeSubmitterRefIds() {
+  // number the submitters in the order of their first programs, so that
+  // incremental updates yield the same ref IDs as a full generation
+  std::map<int64_t, UID> first_program;
+  for (const auto& e : program_submitter) {
+    auto it = first_program.find(e.second);
+    if (it == first_program.end()) {
+      first_program.emplace(e.second, e.first);
+    } else if (e.first < it->second) {
+      it->second = e.first;
+    }
+  }
+  std::vector<std::pair<UID, int64_t>> order;
+  for (const auto& e : first_program) {
+    order.emplace_back(e.second, e.first);
+  }
+  std::sort(order.begin(), order.end());
+  std::map<int64_t, int64_t> new_ref_ids;
+  for (size_t i = 0; i < order.size(); i++) {
+    new_ref_ids[order[i].second] = i + 1;
+  }
+  std::map<std::string, int64_t> ref_ids;
+  std::vector<int64_t> counts(order.size() + 1, 0);
+  for (const auto& e : submitter_ref_ids) {
+    auto it = new_ref_ids.find(e.second);
+    if (it != new_ref_ids.end()) {
+      ref_ids[e.first] = it->second;
+      counts[it->second] = num_programs_per_submitter.at(e.second);
+    }
+  }
+  for (auto& e : program_submitter) {
+    e.second = new_ref_ids.at(e.second);
+  }
+  submitter_ref_ids = std::move(ref_ids);
+  num_programs_per_submitter = std::move(counts);
 }
 
 int64_t Stats::getTransitiveLength(UID id) const {
@@ -7,6 +7,8 @@
 #include "base/uid.hpp"
 #include "eval/evaluator.hpp"
 #include "gen/blocks.hpp"
+#include "mine/stats_snapshot.hpp"
+#include "sys/memory_budget.hpp"
 
 class OpPos {
  public:
@@ -34,10 +36,16 @@ class Stats {
   static const std::string PROGRAMS_HEADER;
   static const std::string STEPS_HEADER;
   static const std::string SUMMARY_HEADER;
+  static const std::string INFO_HEADER;
 
   Stats();
 
-  void load(std::string path);
+  // Load stats from CSV files. If use_snapshot is set and the binary snapshot
+  // is up-to-date, the constant and operation counts are read from the
+  // snapshot instead of being parsed from the CSV files. In that case, the
+  // count maps stay empty until an incremental update, merge or save needs
+  // them; lookups should use getSnapshot().
+  void load(std::string path, bool use_snapshot = false);
 
   void save(std::string path);
 
@@ -46,17 +54,40 @@ class Stats {
   void updateProgramStats(UID id, const Program &program, std::string submitter,
                           const std::string &formula_str, int64_t offset);
 
+  void removeProgramStats(UID id, const Program &program,
+                          std::string submitter);
+
   void updateSequenceStats(UID id, bool program_found, bool formula_found);
 
+  // Merge partial stats into these stats. Submitter IDs are assigned in the
+  // order of their first occurrence, hence merging partial stats of
+  // consecutive ranges of sequences in order gives the same result as
+  // updating a single stats object. The other stats must not have been
+  // loaded from a snapshot.
+  void merge(const Stats &other);
+
+  // Prepare loaded stats for incremental updates using removeProgramStats()
+  // and updateProgramStats(). Sequence stats must be updated again for all
+  // sequences afterwards.
+  void prepareIncrementalUpdate();
+
   void finalize();
 
   int64_t getTransitiveLength(UID id) const;
 
   size_t getNumUsages(UID id) const;
 
+  // Flat sorted arrays of the constant and operation counts. Available after
+  // loading or saving the stats.
+  const StatsSnapshot &getSnapshot() const { return snapshot; }
+
+  bool hasCountsFromSnapshot() const { return counts_from_snapshot; }
+
   int64_t num_programs;
   int64_t num_sequences;
   int64_t num_formulas;
+  std::string programs_commit;  // commit of the programs used for the stats
+  std::string version;          // version of LODA used for the stats
   steps_t steps;
   std::map<Number, int64_t> num_constants;
   std::map<Operation, int64_t> num_operations;
@@ -83,10 +114,27 @@ class Stats {
   Blocks blocks;
 
  private:
+  int64_t nextSubmitterRefId() const;
+
+  void normalizeSubmitterRefIds();
+
+  bool loadSnapshot(const std::string &path);
+
+  // Build the count maps from the snapshot if they were not loaded yet.
+  void loadCountMaps();
+
+  void loadCounts(const std::string &path);
+
+  void updateMemoryUsage();
+
   mutable std::set<UID> visited_programs;  // used for getTransitiveLength()
   mutable std::set<UID>
       printed_recursion_warning;  // used for getTransitiveLength()
   Blocks::Collector blocks_collector;
+  StatsSnapshot snapshot;
+  bool counts_from_snapshot;
+  bool count_maps_pending;
+  MemoryBudget::Usage memory_usage;
 };
 
 class RandomProgramIds {
@@ -0,0 +1,403 @@
+#include "mine/stats_snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "mine/stats.hpp"
+#include "sys/log.hpp"
+#include "sys/mapped_file.hpp"
+
+const std::string StatsSnapshot::FILENAME("stats_snapshot.bin");
+
+const char SNAPSHOT_MAGIC[8] = {'L', 'O', 'D', 'A', 'S', 'T', 'A', 'T'};
+const uint32_t SNAPSHOT_FORMAT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// flags for numbers that do not fit into 64 bits. Their decimal
+// representation is stored in the string table instead.
+const uint8_t BIG_TARGET = 1;
+const uint8_t BIG_SOURCE = 2;
+
+struct StatsSnapshot::Header {
+  char magic[8];
+  uint32_t format_version;
+  uint32_t byte_order;
+  int64_t num_programs;
+  uint64_t num_lengths;
+  uint64_t num_types;
+  uint64_t num_constants;
+  uint64_t num_operations;
+  uint64_t num_operation_positions;
+  uint64_t strings_size;
+};
+
+struct StatsSnapshot::TypeCount {
+  int64_t ref_id;
+  int64_t count;
+};
+
+struct StatsSnapshot::ConstantCount {
+  int64_t value;
+  int64_t count;
+  uint8_t flags;
+  uint8_t padding[7];
+};
+
+struct StatsSnapshot::OperationCount {
+  int64_t target;
+  int64_t source;
+  int64_t count;
+  uint8_t type;  // ref ID of the operation type
+  uint8_t target_type;
+  uint8_t source_type;
+  uint8_t flags;
+  uint32_t padding;
+};
+
+struct StatsSnapshot::OperationPosCount {
+  OperationCount op;
+  uint32_t pos;
+  uint32_t len;
+};
+
+// all sections must keep the 8-byte alignment of the mapped file
+static_assert(sizeof(StatsSnapshot::Header) == 72, "unexpected header size");
+static_assert(sizeof(StatsSnapshot::TypeCount) == 16, "unexpected size");
+static_assert(sizeof(StatsSnapshot::ConstantCount) == 24, "unexpected size");
+static_assert(sizeof(StatsSnapshot::OperationCount) == 32, "unexpected size");
+static_assert(sizeof(StatsSnapshot::OperationPosCount) == 40,
+              "unexpected size");
+
+class SnapshotWriter {
+ public:
+  template <typename T>
+  void append(const T& record) {
+    const auto ptr = reinterpret_cast<const char*>(&record);
+    data.insert(data.end(), ptr, ptr + sizeof(T));
+  }
+
+  int64_t encode(const Number& n, uint8_t& flags, uint8_t big_flag) {
+    try {
+      if (n.getNumUsedWords() == 1) {
+        const auto value = n.asInt();
+        if (Number(value) == n) {
+          return value;
+        }
+      }
+    } catch (const std::exception&) {
+      // not representable as 64-bit integer
+    }
+    flags |= big_flag;
+    const int64_t pos = strings.size();
+    strings += n.to_string();
+    strings.push_back('\0');
+    return pos;
+  }
+
+  void encode(const Operation& op, StatsSnapshot::OperationCount& record) {
+    record.type = static_cast<uint8_t>(Operation::Metadata::get(op.type).ref_id);
+    record.target_type = static_cast<uint8_t>(op.target.type);
+    record.source_type = static_cast<uint8_t>(op.source.type);
+    record.target = encode(op.target.value, record.flags, BIG_TARGET);
+    record.source = encode(op.source.value, record.flags, BIG_SOURCE);
+  }
+
+  std::vector<char> data;
+  std::string strings;
+};
+
+StatsSnapshot::StatsSnapshot()
+    : header(nullptr),
+      programs_per_length(nullptr),
+      ops_per_type(nullptr),
+      constants(nullptr),
+      operations(nullptr),
+      operation_positions(nullptr),
+      strings(nullptr) {}
+
+StatsSnapshot::StatsSnapshot(const Stats& stats) : StatsSnapshot() {
+  SnapshotWriter writer;
+  Header h;
+  std::memset(&h, 0, sizeof(Header));
+  std::memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+  h.format_version = SNAPSHOT_FORMAT_VERSION;
+  h.byte_order = SNAPSHOT_BYTE_ORDER;
+  h.num_programs = stats.num_programs;
+  h.num_lengths = stats.num_programs_per_length.size();
+  h.num_constants = stats.num_constants.size();
+  h.num_operations = stats.num_operations.size();
+  h.num_operation_positions = stats.num_operation_positions.size();
+  for (auto count : stats.num_ops_per_type) {
+    h.num_types += (count != 0);
+  }
+  writer.append(h);
+  for (auto count : stats.num_programs_per_length) {
+    writer.append(count);
+  }
+  for (size_t i = 0; i < stats.num_ops_per_type.size(); i++) {
+    if (stats.num_ops_per_type[i] != 0) {
+      const auto type = static_cast<Operation::Type>(i);
+      writer.append(
+          TypeCount{Operation::Metadata::get(type).ref_id,
+                    stats.num_ops_per_type[i]});
+    }
+  }
+  for (const auto& e : stats.num_constants) {
+    ConstantCount record;
+    std::memset(&record, 0, sizeof(ConstantCount));
+    record.value = writer.encode(e.first, record.flags, BIG_SOURCE);
+    record.count = e.second;
+    writer.append(record);
+  }
+  for (const auto& e : stats.num_operations) {
+    OperationCount record;
+    std::memset(&record, 0, sizeof(OperationCount));
+    writer.encode(e.first, record);
+    record.count = e.second;
+    writer.append(record);
+  }
+  for (const auto& e : stats.num_operation_positions) {
+    OperationPosCount record;
+    std::memset(&record, 0, sizeof(OperationPosCount));
+    writer.encode(e.first.op, record.op);
+    record.op.count = e.second;
+    record.pos = static_cast<uint32_t>(e.first.pos);
+    record.len = static_cast<uint32_t>(e.first.len);
+    writer.append(record);
+  }
+  // the header is the first record of the buffer
+  reinterpret_cast<Header*>(writer.data.data())->strings_size =
+      writer.strings.size();
+  writer.data.insert(writer.data.end(), writer.strings.begin(),
+                     writer.strings.end());
+  auto data = std::make_shared<std::vector<char>>(std::move(writer.data));
+  if (!attach(data->data(), data->size())) {
+    Log::get().error("Invalid stats snapshot", true);
+  }
+  buffer = data;
+}
+
+bool StatsSnapshot::load(const std::string& path) {
+  std::shared_ptr<const MappedFile> mapped;
+  try {
+    mapped = std::make_shared<MappedFile>(path);
+  } catch (const std::exception& e) {
+    Log::get().debug("Cannot load stats snapshot: " + std::string(e.what()));
+    return false;
+  }
+  if (!attach(mapped->data(), mapped->size())) {
+    Log::get().warn("Ignoring invalid stats snapshot " + path);
+    *this = StatsSnapshot();
+    return false;
+  }
+  file = mapped;
+  buffer.reset();
+  return true;
+}
+
+void StatsSnapshot::save(const std::string& path) const {
+  if (empty()) {
+    Log::get().error("Cannot save empty stats snapshot", true);
+  }
+  const auto data = reinterpret_cast<const char*>(header);
+  const size_t size = (strings - data) + header->strings_size;
+  const auto tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(data, size);
+    if (!out) {
+      Log::get().error("Error writing stats snapshot " + tmp, true);
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    // e.g. on Windows if the old snapshot is still mapped
+    Log::get().warn("Cannot replace stats snapshot " + path + ": " +
+                    ec.message());
+    std::filesystem::remove(tmp, ec);
+  }
+}
+
+bool StatsSnapshot::attach(const char* data, size_t size) {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  auto h = reinterpret_cast<const Header*>(data);
+  if (std::memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0 ||
+      h->format_version != SNAPSHOT_FORMAT_VERSION ||
+      h->byte_order != SNAPSHOT_BYTE_ORDER) {
+    return false;
+  }
+  // check the section sizes before computing any pointers
+  const uint64_t limit = size;
+  uint64_t pos = sizeof(Header);
+  const std::pair<uint64_t, uint64_t> sections[] = {
+      {h->num_lengths, sizeof(int64_t)},
+      {h->num_types, sizeof(TypeCount)},
+      {h->num_constants, sizeof(ConstantCount)},
+      {h->num_operations, sizeof(OperationCount)},
+      {h->num_operation_positions, sizeof(OperationPosCount)},
+      {h->strings_size, 1}};
+  for (const auto& s : sections) {
+    if (s.first > (limit - pos) / s.second) {
+      return false;
+    }
+    pos += s.first * s.second;
+  }
+  if (pos != limit) {
+    return false;
+  }
+  const char* p = data + sizeof(Header);
+  programs_per_length = reinterpret_cast<const int64_t*>(p);
+  p += h->num_lengths * sizeof(int64_t);
+  ops_per_type = reinterpret_cast<const TypeCount*>(p);
+  p += h->num_types * sizeof(TypeCount);
+  constants = reinterpret_cast<const ConstantCount*>(p);
+  p += h->num_constants * sizeof(ConstantCount);
+  operations = reinterpret_cast<const OperationCount*>(p);
+  p += h->num_operations * sizeof(OperationCount);
+  operation_positions = reinterpret_cast<const OperationPosCount*>(p);
+  p += h->num_operation_positions * sizeof(OperationPosCount);
+  strings = p;
+
+  // validate references to operation types and the string table
+  auto validNumber = [&](int64_t value, bool big) {
+    return !big || (value >= 0 && static_cast<uint64_t>(value) <
+                                      h->strings_size &&
+                    std::memchr(strings + value, '\0',
+                                h->strings_size - value) != nullptr);
+  };
+  auto validOperation = [&](const OperationCount& r) {
+    return Operation::Metadata::findByRefId(r.type) &&
+           r.target_type <= static_cast<uint8_t>(Operand::Type::INDIRECT) &&
+           r.source_type <= static_cast<uint8_t>(Operand::Type::INDIRECT) &&
+           validNumber(r.target, r.flags & BIG_TARGET) &&
+           validNumber(r.source, r.flags & BIG_SOURCE);
+  };
+  for (uint64_t i = 0; i < h->num_types; i++) {
+    if (!Operation::Metadata::findByRefId(ops_per_type[i].ref_id)) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < h->num_constants; i++) {
+    if (!validNumber(constants[i].value, constants[i].flags & BIG_SOURCE)) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < h->num_operations; i++) {
+    if (!validOperation(operations[i])) {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < h->num_operation_positions; i++) {
+    if (!validOperation(operation_positions[i].op)) {
+      return false;
+    }
+  }
+  header = h;
+  return true;
+}
+
+int64_t StatsSnapshot::getNumPrograms() const {
+  return header ? header->num_programs : 0;
+}
+
+size_t StatsSnapshot::numConstants() const {
+  return header ? header->num_constants : 0;
+}
+
+Number StatsSnapshot::getConstant(size_t index) const {
+  const auto& r = constants[index];
+  return getNumber(r.value, r.flags & BIG_SOURCE);
+}
+
+int64_t StatsSnapshot::getConstantCount(size_t index) const {
+  return constants[index].count;
+}
+
+bool StatsSnapshot::findConstantCount(const Number& constant,
+                                      int64_t& count) const {
+  size_t left = 0, right = numConstants();
+  while (left < right) {
+    const size_t mid = left + (right - left) / 2;
+    if (getConstant(mid) < constant) {
+      left = mid + 1;
+    } else {
+      right = mid;
+    }
+  }
+  if (left < numConstants() && getConstant(left) == constant) {
+    count = constants[left].count;
+    return true;
+  }
+  return false;
+}
+
+size_t StatsSnapshot::numOperations() const {
+  return header ? header->num_operations : 0;
+}
+
+Operation StatsSnapshot::getOperation(size_t index) const {
+  return getOperation(operations[index]);
+}
+
+int64_t StatsSnapshot::getOperationCount(size_t index) const {
+  return operations[index].count;
+}
+
+size_t StatsSnapshot::numOperationPositions() const {
+  return header ? header->num_operation_positions : 0;
+}
+
+OpPos StatsSnapshot::getOperationPosition(size_t index) const {
+  const auto& r = operation_positions[index];
+  OpPos result;
+  result.op = getOperation(r.op);
+  result.pos = r.pos;
+  result.len = r.len;
+  return result;
+}
+
+int64_t StatsSnapshot::getOperationPositionCount(size_t index) const {
+  return operation_positions[index].op.count;
+}
+
+std::vector<int64_t> StatsSnapshot::getNumProgramsPerLength() const {
+  if (!header) {
+    return {};
+  }
+  return std::vector<int64_t>(programs_per_length,
+                              programs_per_length + header->num_lengths);
+}
+
+std::vector<int64_t> StatsSnapshot::getNumOpsPerType() const {
+  std::vector<int64_t> result(Operation::Types.size(), 0);
+  if (header) {
+    for (uint64_t i = 0; i < header->num_types; i++) {
+      const auto type =
+          Operation::Metadata::findByRefId(ops_per_type[i].ref_id)->type;
+      result.at(static_cast<size_t>(type)) = ops_per_type[i].count;
+    }
+  }
+  return result;
+}
+
+Number StatsSnapshot::getNumber(int64_t value, bool big) const {
+  if (big) {
+    return Number(std::string(strings + value));
+  }
+  return Number(value);
+}
+
+Operation StatsSnapshot::getOperation(const OperationCount& record) const {
+  return Operation(
+      Operation::Metadata::findByRefId(record.type)->type,
+      Operand(static_cast<Operand::Type>(record.target_type),
+              getNumber(record.target, record.flags & BIG_TARGET)),
+      Operand(static_cast<Operand::Type>(record.source_type),
+              getNumber(record.source, record.flags & BIG_SOURCE)));
+}
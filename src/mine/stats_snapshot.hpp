@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lang/program.hpp"
+
+class MappedFile;
+class OpPos;
+class Stats;
+
+// Binary snapshot of the constant and operation counts of the program stats.
+// The counts are stored as flat arrays sorted in the same order as the maps
+// in Stats, so that consumers iterating over them behave the same. Snapshot
+// files are memory-mapped on load and can be used without parsing.
+class StatsSnapshot {
+ public:
+  static const std::string FILENAME;
+
+  StatsSnapshot();
+
+  // Build a snapshot from the count maps of the given stats.
+  explicit StatsSnapshot(const Stats &stats);
+
+  // Load a snapshot file. Returns false if the file is missing, has an
+  // unsupported format or is inconsistent.
+  bool load(const std::string &path);
+
+  // Write the snapshot to a temporary file and rename it, which keeps
+  // existing mappings of the old file valid.
+  void save(const std::string &path) const;
+
+  bool empty() const { return header == nullptr; }
+
+  int64_t getNumPrograms() const;
+
+  size_t numConstants() const;
+  Number getConstant(size_t index) const;
+  int64_t getConstantCount(size_t index) const;
+
+  // Look up the count of a constant using binary search.
+  bool findConstantCount(const Number &constant, int64_t &count) const;
+
+  size_t numOperations() const;
+  Operation getOperation(size_t index) const;
+  int64_t getOperationCount(size_t index) const;
+
+  size_t numOperationPositions() const;
+  OpPos getOperationPosition(size_t index) const;
+  int64_t getOperationPositionCount(size_t index) const;
+
+  std::vector<int64_t> getNumProgramsPerLength() const;
+  std::vector<int64_t> getNumOpsPerType() const;
+
+  struct Header;
+  struct TypeCount;
+  struct ConstantCount;
+  struct OperationCount;
+  struct OperationPosCount;
+
+ private:
+  bool attach(const char *data, size_t size);
+
+  Number getNumber(int64_t value, bool big) const;
+
+  Operation getOperation(const OperationCount &record) const;
+
+  // either a mapped file or a buffer built in memory
+  std::shared_ptr<const MappedFile> file;
+  std::shared_ptr<const std::vector<char>> buffer;
+
+  const Header *header;
+  const int64_t *programs_per_length;
+  const TypeCount *ops_per_type;
+  const ConstantCount *constants;
+  const OperationCount *operations;
+  const OperationPosCount *operation_positions;
+  const char *strings;
+};
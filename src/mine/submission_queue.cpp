@@ -0,0 +1,178 @@
+#include "mine/submission_queue.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+#include "sys/log.hpp"
+
+SubmissionQueue::SubmissionQueue(const std::string& spill_file, Sender sender,
+                                 size_t max_pending,
+                                 std::chrono::milliseconds initial_backoff)
+    : spill_file(spill_file),
+      sender(sender),
+      max_pending(std::max<size_t>(max_pending, 1)),
+      initial_backoff(initial_backoff),
+      num_spilled(0),
+      backoff(initial_backoff),
+      retry_time(std::chrono::steady_clock::now()),
+      num_failures(0),
+      stopping(false) {
+  const auto lines = readSpillFile();
+  for (const auto& line : lines) {
+    if (pending.size() < this->max_pending) {
+      pending.push_back(line);
+    } else {
+      num_spilled++;
+    }
+  }
+  if (!lines.empty()) {
+    Log::get().info("Loaded " + std::to_string(lines.size()) +
+                    " pending submissions from " + spill_file);
+    writeSpillFile(lines, 0);  // drop incomplete lines
+  }
+  worker = std::thread(&SubmissionQueue::run, this);
+}
+
+SubmissionQueue::~SubmissionQueue() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  cond.notify_all();
+  worker.join();
+}
+
+void SubmissionQueue::push(const std::string& body) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::ofstream out(spill_file, std::ios::app);
+    out << body << '\n';
+    out.close();
+    if (!out) {
+      Log::get().warn("Cannot write submission to " + spill_file);
+    }
+    if (num_spilled == 0 && pending.size() < max_pending) {
+      pending.push_back(body);
+    } else {
+      num_spilled++;
+    }
+  }
+  cond.notify_all();
+}
+
+bool SubmissionQueue::flush(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  retry_time = std::chrono::steady_clock::now();
+  cond.notify_all();
+  return cond.wait_for(lock, timeout,
+                       [this]() { return pending.empty() || stopping; }) &&
+         pending.empty();
+}
+
+size_t SubmissionQueue::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return pending.size() + num_spilled;
+}
+
+void SubmissionQueue::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    if (pending.empty()) {
+      cond.wait(lock);
+      continue;
+    }
+    if (std::chrono::steady_clock::now() < retry_time) {
+      cond.wait_until(lock, retry_time);
+      continue;
+    }
+    const size_t n = std::min(pending.size(), BATCH_SIZE);
+    const std::vector<std::string> batch(pending.begin(), pending.begin() + n);
+
+    // send the batch without blocking producers
+    lock.unlock();
+    size_t num_sent = 0;
+    for (const auto& body : batch) {
+      if (!sender(body)) {
+        break;
+      }
+      num_sent++;
+    }
+    lock.lock();
+
+    // new submissions are only appended, so the batch is still in front
+    acknowledge(num_sent);
+    if (num_sent < n) {
+      num_failures++;
+      const auto size = pending.size() + num_spilled;
+      Log::get().warn("Cannot submit programs to API server, retrying in " +
+                      std::to_string(backoff.count() / 1000) + "s (" +
+                      std::to_string(size) + " pending)");
+      retry_time = std::chrono::steady_clock::now() + backoff;
+      backoff = std::min<std::chrono::milliseconds>(
+          2 * backoff, std::chrono::seconds(MAX_BACKOFF_SECS));
+    } else {
+      if (num_failures > 0) {
+        Log::get().info("Resumed submissions to API server");
+      }
+      num_failures = 0;
+      backoff = initial_backoff;
+    }
+    cond.notify_all();
+  }
+}
+
+void SubmissionQueue::acknowledge(size_t num_sent) {
+  if (num_sent == 0) {
+    return;
+  }
+  pending.erase(pending.begin(), pending.begin() + num_sent);
+  const auto lines = readSpillFile();
+  writeSpillFile(lines, num_sent);
+  // refill from the spill file; its first lines are the pending submissions
+  if (num_spilled > 0 && pending.size() < max_pending) {
+    for (size_t i = num_sent + pending.size();
+         i < lines.size() && num_spilled > 0 && pending.size() < max_pending;
+         i++) {
+      pending.push_back(lines[i]);
+      num_spilled--;
+    }
+  }
+}
+
+std::vector<std::string> SubmissionQueue::readSpillFile() const {
+  std::vector<std::string> lines;
+  std::ifstream in(spill_file);
+  std::string line;
+  while (std::getline(in, line)) {
+    // skip lines that were not completely written
+    if (!line.empty() && line.front() == '{' && line.back() == '}') {
+      lines.push_back(line);
+    }
+  }
+  return lines;
+}
+
+void SubmissionQueue::writeSpillFile(const std::vector<std::string>& lines,
+                                     size_t skip) const {
+  if (skip >= lines.size()) {
+    std::remove(spill_file.c_str());
+    return;
+  }
+  const std::string tmp = spill_file + ".tmp";
+  {
+    std::ofstream out(tmp);
+    for (size_t i = skip; i < lines.size(); i++) {
+      out << lines[i] << '\n';
+    }
+    out.close();
+    if (!out) {
+      Log::get().warn("Cannot write submissions to " + tmp);
+      return;
+    }
+  }
+#ifdef _WIN64
+  std::remove(spill_file.c_str());  // rename does not overwrite on Windows
+#endif
+  std::rename(tmp.c_str(), spill_file.c_str());
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Queue of submissions to the API server that are sent by a background
+// worker, so that a slow or unavailable server does not stall mining. Each
+// submission is a single-line request body. All pending submissions are
+// written to a spill file until they are sent, and the spill file is loaded
+// again when a queue with the same file is created, e.g. after a crash.
+// At most max_pending submissions are kept in memory; the remaining ones are
+// only read from the spill file when there is room again. The worker sends
+// batches of submissions and backs off exponentially on failures.
+class SubmissionQueue {
+ public:
+  using Sender = std::function<bool(const std::string& body)>;
+
+  static constexpr size_t MAX_PENDING = 1000;  // magic number
+  static constexpr size_t BATCH_SIZE = 10;     // magic number
+  static constexpr int64_t MAX_BACKOFF_SECS = 300;
+
+  SubmissionQueue(const std::string& spill_file, Sender sender,
+                  size_t max_pending = MAX_PENDING,
+                  std::chrono::milliseconds initial_backoff =
+                      std::chrono::milliseconds(1000));
+
+  // Stops the worker. Pending submissions remain in the spill file.
+  ~SubmissionQueue();
+
+  void push(const std::string& body);
+
+  // Waits until all pending submissions are sent or the timeout is reached.
+  // A running backoff is cancelled. Returns true if the queue is empty.
+  bool flush(std::chrono::milliseconds timeout);
+
+  // Number of pending submissions, including the ones only in the spill file.
+  size_t size() const;
+
+ private:
+  void run();
+
+  std::vector<std::string> readSpillFile() const;
+
+  void writeSpillFile(const std::vector<std::string>& lines, size_t skip) const;
+
+  void acknowledge(size_t num_sent);
+
+  const std::string spill_file;
+  const Sender sender;
+  const size_t max_pending;
+  const std::chrono::milliseconds initial_backoff;
+
+  mutable std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<std::string> pending;
+  size_t num_spilled;  // submissions only in the spill file
+  std::chrono::milliseconds backoff;
+  std::chrono::steady_clock::time_point retry_time;
+  size_t num_failures;  // consecutive failures
+  bool stopping;
+  std::thread worker;
+};
@@ -8,19 +8,29 @@
 #include "lang/program_util.hpp"
 #include "math/big_number.hpp"
 #include "mine/api_client.hpp"
+#include "seq/seq_index.hpp"
 #include "seq/seq_util.hpp"
 #include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/setup.hpp"
+#include "sys/trace.hpp"
 #include "sys/util.hpp"
 #include "sys/web_client.hpp"
 
 ManagedSequence::ManagedSequence(UID id)
-    : id(id), offset(0), num_bfile_terms(0) {}
+    : id(id),
+      offset(0),
+      num_bfile_terms(0),
+      index(nullptr) {}
 
 ManagedSequence::ManagedSequence(UID id, const std::string& name,
                                  const Sequence& full)
-    : id(id), name(name), offset(0), terms(full), num_bfile_terms(0) {}
+    : id(id),
+      name(name),
+      offset(0),
+      terms(full),
+      num_bfile_terms(0),
+      index(nullptr) {}
 
 std::ostream& operator<<(std::ostream& out, const ManagedSequence& s) {
   out << s.id.string() << ": " << s.name;
@@ -53,6 +63,10 @@ void ManagedSequence::removeInvalidBFile(const std::string& error) const {
 }
 
 Sequence ManagedSequence::loadBFile() const {
+  Trace::Span span("seq", "bfile");
+  if (span) {
+    span.setArg(id.string());
+  }
   Sequence result;
 
   // try to read b-file
@@ -171,6 +185,18 @@ Sequence ManagedSequence::getTerms(int64_t max_num_terms) const {
   // try to (re-)load b-file if not loaded yet or if there are more terms
   // available
   if (num_bfile_terms == 0 || num_bfile_terms > terms.size()) {
+    // use cached b-file terms if there are enough
+    Sequence cached;
+    size_t num_cached = 0;
+    if (index && index->lookupBFile(id, cached, num_cached) &&
+        (cached.size() >= real_max_terms || cached.size() == num_cached)) {
+      num_bfile_terms = num_cached;
+      if (cached.size() > real_max_terms) {
+        cached = cached.subsequence(0, real_max_terms);
+      }
+      terms = cached;
+      return terms;
+    }
     const auto path = getBFilePath();
     auto big = loadBFile();
     if (big.empty() && id.domain() == 'A') {
@@ -202,6 +228,9 @@ Sequence ManagedSequence::getTerms(int64_t max_num_terms) const {
 
     // replace terms
     terms = big;
+    if (index) {
+      index->insertBFile(id, terms, num_bfile_terms);
+    }
   }
 
   return terms;
@@ -7,6 +7,8 @@
 #include "math/sequence.hpp"
 #include "seq/seq_util.hpp"
 
+class SequenceIndex;
+
 class ManagedSequence {
  public:
   ManagedSequence(UID id = UID());
@@ -31,7 +33,10 @@ class ManagedSequence {
  private:
   mutable Sequence terms;
   mutable size_t num_bfile_terms;
+  const SequenceIndex* index;  // caches b-file terms if set
 
   Sequence loadBFile() const;
   void removeInvalidBFile(const std::string& error = "invalid") const;
+
+  friend class SequenceIndex;
 };
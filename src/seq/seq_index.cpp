@@ -1,62 +1,264 @@
 #include "seq/seq_index.hpp"
 
-bool SequenceIndex::exists(UID id) const {
-  auto it = data.find(id.domain());
-  if (it == data.end()) {
-    return false;
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#include "math/big_number.hpp"
+#include "sys/log.hpp"
+
+const SequenceIndex::Domain* SequenceIndex::findSlot(UID id) const {
+  auto it = domains.find(id.domain());
+  if (it == domains.end()) {
+    return nullptr;
   }
-  const auto& seqs = it->second;
   auto index = id.number();
-  if (index < 0 || index >= static_cast<int64_t>(seqs.size())) {
+  const auto& d = it->second;
+  if (index < 0 || index >= static_cast<int64_t>(d.present.size()) ||
+      !d.present[index]) {
+    return nullptr;
+  }
+  return &d;
+}
+
+SequenceIndex::Domain* SequenceIndex::findSlot(UID id) {
+  return const_cast<Domain*>(
+      static_cast<const SequenceIndex*>(this)->findSlot(id));
+}
+
+bool SequenceIndex::exists(UID id) const { return findSlot(id) != nullptr; }
+
+ManagedSequence SequenceIndex::get(UID id, bool with_name) const {
+  if (!exists(id)) {
+    throw std::out_of_range("Sequence not found: " + id.string());
+  }
+  ManagedSequence seq(id, with_name ? getName(id) : "", getTerms(id));
+  seq.offset = getOffset(id);
+  seq.index = this;
+  return seq;
+}
+
+void SequenceIndex::add(UID id, const Sequence& terms) {
+  if (terms.size() > std::numeric_limits<uint16_t>::max() ||
+      term_pool.size() + terms.size() > std::numeric_limits<uint32_t>::max()) {
+    Log::get().error("Sequence index capacity exceeded: " + id.string(), true);
+  }
+  auto& d = domains[id.domain()];
+  auto index = id.number();
+  if (index >= static_cast<int64_t>(d.present.size())) {
+    const size_t new_size = static_cast<int64_t>(1.5 * index) + 1;
+    // slot data without the presence bits
+    memory_usage.add((new_size - d.present.size()) *
+                     (sizeof(uint32_t) + sizeof(uint16_t) + 2 * sizeof(int64_t)));
+    d.present.resize(new_size, false);
+    d.term_pos.resize(new_size, 0);
+    d.term_len.resize(new_size, 0);
+    d.offsets.resize(new_size, 0);
+    d.name_pos.resize(new_size, -1);
+  }
+  if (!d.present[index]) {
+    num_sequences++;
+  }
+  d.present[index] = true;
+  d.term_pos[index] = static_cast<uint32_t>(term_pool.size());
+  d.term_len[index] = static_cast<uint16_t>(terms.size());
+  d.offsets[index] = 0;
+  d.name_pos[index] = -1;
+  const auto old_capacity = term_pool.capacity();
+  term_pool.insert(term_pool.end(), terms.begin(), terms.end());
+  int64_t bytes = (term_pool.capacity() - old_capacity) * sizeof(Number);
+  for (const auto& t : terms) {
+    if (t.isBig()) {
+      bytes += sizeof(BigNumber);
+    }
+  }
+  memory_usage.add(bytes);
+}
+
+Sequence SequenceIndex::getTerms(UID id) const {
+  Sequence result;
+  auto d = findSlot(id);
+  if (d) {
+    auto index = id.number();
+    auto start = term_pool.begin() + d->term_pos[index];
+    result.assign(start, start + d->term_len[index]);
+  }
+  return result;
+}
+
+size_t SequenceIndex::numTerms(UID id) const {
+  auto d = findSlot(id);
+  return d ? d->term_len[id.number()] : 0;
+}
+
+int64_t SequenceIndex::getOffset(UID id) const {
+  auto d = findSlot(id);
+  return d ? d->offsets[id.number()] : 0;
+}
+
+void SequenceIndex::setOffset(UID id, int64_t offset) {
+  auto d = findSlot(id);
+  if (d) {
+    d->offsets[id.number()] = offset;
+  }
+}
+
+void SequenceIndex::setNamesFile(char domain, const std::string& path) {
+  domains[domain].names_file = path;
+}
+
+void SequenceIndex::setNamePos(UID id, int64_t pos) {
+  auto d = findSlot(id);
+  if (d) {
+    d->name_pos[id.number()] = pos;
+  }
+}
+
+bool SequenceIndex::hasName(UID id) const {
+  auto d = findSlot(id);
+  return d && d->name_pos[id.number()] >= 0;
+}
+
+std::string SequenceIndex::getName(UID id) const {
+  auto d = findSlot(id);
+  if (!d || d->name_pos[id.number()] < 0) {
+    return "";
+  }
+  std::ifstream names(d->names_file);
+  names.seekg(d->name_pos[id.number()]);
+  std::string line;
+  if (!names.good() || !std::getline(names, line)) {
+    Log::get().warn("Cannot read name of " + id.string() + " from " +
+                    d->names_file);
+    return "";
+  }
+  return parseName(id, line, d->names_file);
+}
+
+size_t SequenceIndex::numCachedBFiles() const {
+  std::lock_guard<std::mutex> lock(bfiles_mutex);
+  return bfiles.size();
+}
+
+bool SequenceIndex::lookupBFile(UID id, Sequence& terms,
+                                size_t& num_bfile_terms) const {
+  std::lock_guard<std::mutex> lock(bfiles_mutex);
+  auto it = bfiles_index.find(id);
+  if (it == bfiles_index.end()) {
     return false;
   }
-  return seqs[index].id == id;
+  bfiles.splice(bfiles.begin(), bfiles, it->second);
+  terms = it->second->terms;
+  num_bfile_terms = it->second->num_bfile_terms;
+  return true;
 }
 
-const ManagedSequence& SequenceIndex::get(UID uid) const {
-  return data.at(uid.domain()).at(uid.number());
+void SequenceIndex::insertBFile(UID id, const Sequence& terms,
+                                size_t num_bfile_terms) const {
+  std::lock_guard<std::mutex> lock(bfiles_mutex);
+  if (bfiles_usage.shouldShrink()) {
+    bfiles.clear();
+    bfiles_index.clear();
+    bfiles_usage.set(0);
+  }
+  auto it = bfiles_index.find(id);
+  if (it != bfiles_index.end()) {
+    bfiles_usage.add(-getMemoryUsage(*it->second));
+    bfiles.erase(it->second);
+    bfiles_index.erase(it);
+  }
+  // do not grow beyond the share of the memory budget
+  const size_t max_entries =
+      bfiles_usage.mayGrow() ? MAX_BFILES
+                             : std::min<size_t>(MAX_BFILES, bfiles.size());
+  bfiles.push_front({id, terms, num_bfile_terms});
+  bfiles_index[id] = bfiles.begin();
+  bfiles_usage.add(getMemoryUsage(bfiles.front()));
+  while (bfiles.size() > max_entries) {
+    bfiles_usage.add(-getMemoryUsage(bfiles.back()));
+    bfiles_index.erase(bfiles.back().id);
+    bfiles.pop_back();
+  }
 }
 
-ManagedSequence& SequenceIndex::get(UID uid) {
-  return data[uid.domain()][uid.number()];
+int64_t SequenceIndex::getMemoryUsage(const BFile& bfile) {
+  return bfile.terms.getMemoryUsage() + 2 * MemoryBudget::NODE_OVERHEAD;
 }
 
-void SequenceIndex::add(ManagedSequence&& seq) {
-  auto& seqs = data[seq.id.domain()];
-  auto index = seq.id.number();
-  if (index >= static_cast<int64_t>(seqs.size())) {
-    seqs.resize(static_cast<int64_t>(1.5 * index) + 1);
+std::string SequenceIndex::parseName(UID id, const std::string& line,
+                                     const std::string& path) {
+  // the names file may have been updated in the meantime
+  const auto prefix = id.string() + " ";
+  if (line.compare(0, prefix.size(), prefix) != 0) {
+    Log::get().warn("Outdated name position of " + id.string() + " in " +
+                    path);
+    return "";
   }
-  seqs[index] = std::move(seq);
+  return line.substr(prefix.size());
 }
 
 using const_iterator = SequenceIndex::const_iterator;
 using outer_iter_t = const_iterator::outer_iter_t;
-using inner_iter_t = const_iterator::inner_iter_t;
 
-const_iterator::const_iterator(outer_iter_t outer, outer_iter_t outer_end)
-    : outer_it(outer), outer_end(outer_end) {
-  if (outer_it != outer_end) {
-    inner_it = outer_it->second.begin();
-    advance_to_valid();
+const_iterator::const_iterator(const SequenceIndex* index, outer_iter_t outer,
+                               outer_iter_t outer_end)
+    : index(index), outer_it(outer), outer_end(outer_end), inner_index(0) {
+  advance_to_valid();
+}
+
+const ManagedSequence& const_iterator::operator*() const {
+  const UID id(outer_it->first, inner_index);
+  if (current.id != id) {
+    current = ManagedSequence(id, readName(id), index->getTerms(id));
+    current.offset = index->getOffset(id);
+    current.index = index;
   }
+  return current;
 }
 
-const ManagedSequence& const_iterator::operator*() const { return *inner_it; }
+std::string const_iterator::readName(UID id) const {
+  const auto& d = outer_it->second;
+  const auto pos = d.name_pos[inner_index];
+  if (pos < 0) {
+    return "";
+  }
+  if (!names || names_domain != outer_it->first) {
+    names = std::make_shared<std::ifstream>(d.names_file);
+    names_domain = outer_it->first;
+  }
+  // the names file is sorted by ID, so skip lines instead of seeking
+  std::string line;
+  int64_t current_pos = names->tellg();
+  while (current_pos >= 0 && current_pos < pos && std::getline(*names, line)) {
+    current_pos += line.size() + 1;
+  }
+  if (current_pos != pos) {
+    names->clear();
+    names->seekg(pos);
+  }
+  if (!std::getline(*names, line)) {
+    Log::get().warn("Cannot read name of " + id.string() + " from " +
+                    d.names_file);
+    names->clear();
+    return "";
+  }
+  return SequenceIndex::parseName(id, line, d.names_file);
+}
 
 const ManagedSequence* const_iterator::operator->() const {
-  return &(*inner_it);
+  return &(**this);
 }
 
 const_iterator& const_iterator::operator++() {
-  ++inner_it;
+  ++inner_index;
   advance_to_valid();
   return *this;
 }
 
 bool const_iterator::operator==(const const_iterator& other) const {
   return outer_it == other.outer_it &&
-         (outer_it == outer_end || inner_it == other.inner_it);
+         (outer_it == outer_end || inner_index == other.inner_index);
 }
 
 bool const_iterator::operator!=(const const_iterator& other) const {
@@ -64,29 +266,24 @@ bool const_iterator::operator!=(const const_iterator& other) const {
 }
 
 void const_iterator::advance_to_valid() {
-  while (outer_it != outer_end && inner_it == outer_it->second.end()) {
-    ++outer_it;
-    if (outer_it != outer_end) {
-      inner_it = outer_it->second.begin();
-    }
-  }
   // skip empty slots
-  while (outer_it != outer_end && inner_it != outer_it->second.end() &&
-         inner_it->id.empty()) {
-    ++inner_it;
-    if (inner_it == outer_it->second.end()) {
-      ++outer_it;
-      if (outer_it != outer_end) {
-        inner_it = outer_it->second.begin();
-      }
+  while (outer_it != outer_end) {
+    const auto& present = outer_it->second.present;
+    while (inner_index < present.size() && !present[inner_index]) {
+      ++inner_index;
+    }
+    if (inner_index < present.size()) {
+      return;
     }
+    ++outer_it;
+    inner_index = 0;
   }
 }
 
 const_iterator SequenceIndex::begin() const {
-  return const_iterator(data.begin(), data.end());
+  return const_iterator(this, domains.begin(), domains.end());
 }
 
 const_iterator SequenceIndex::end() const {
-  return const_iterator(data.end(), data.end());
+  return const_iterator(this, domains.end(), domains.end());
 }
@@ -1,36 +1,113 @@
 #pragma once
 
+#include <fstream>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "seq/managed_seq.hpp"
+#include "sys/memory_budget.hpp"
 
+// Compact index of sequence data. The terms of all sequences are stored in a
+// single contiguous pool, and each domain has dense per-UID slots holding
+// offsets and lengths into the pool. Sequence names are not kept in memory,
+// but only their positions in the names file. ManagedSequence objects are
+// created on access and returned by value. B-file terms loaded by them are
+// kept in a bounded cache of the index, where least recently used entries
+// are evicted first. The cache is accounted in the memory budget and is
+// cleared if it should shrink.
 class SequenceIndex {
  public:
+  static constexpr size_t MAX_BFILES = 1000;  // magic number
+
   bool exists(UID id) const;
 
-  const ManagedSequence& get(UID id) const;
+  // Names are only read from the names file if requested.
+  ManagedSequence get(UID id, bool with_name = true) const;
+
+  void add(UID id, const Sequence& terms);
+
+  Sequence getTerms(UID id) const;
+
+  size_t numTerms(UID id) const;
+
+  int64_t getOffset(UID id) const;
+
+  void setOffset(UID id, int64_t offset);
+
+  void setNamesFile(char domain, const std::string& path);
+
+  void setNamePos(UID id, int64_t pos);
+
+  bool hasName(UID id) const;
+
+  std::string getName(UID id) const;
 
-  ManagedSequence& get(UID id);
+  size_t size() const { return num_sequences; }
 
-  void add(ManagedSequence&& seq);
+  size_t numCachedBFiles() const;
 
   class const_iterator;
   const_iterator begin() const;
   const_iterator end() const;
 
  private:
-  std::map<char, std::vector<ManagedSequence>> data;
+  struct Domain {
+    std::vector<bool> present;
+    std::vector<uint32_t> term_pos;
+    std::vector<uint16_t> term_len;
+    std::vector<int64_t> offsets;
+    std::vector<int64_t> name_pos;
+    std::string names_file;
+  };
+
+  const Domain* findSlot(UID id) const;
+
+  Domain* findSlot(UID id);
+
+  static std::string parseName(UID id, const std::string& line,
+                               const std::string& path);
+
+  struct BFile {
+    UID id;
+    Sequence terms;
+    size_t num_bfile_terms;  // including terms not kept in the cache
+  };
+
+  bool lookupBFile(UID id, Sequence& terms, size_t& num_bfile_terms) const;
+
+  void insertBFile(UID id, const Sequence& terms,
+                   size_t num_bfile_terms) const;
+
+  static int64_t getMemoryUsage(const BFile& bfile);
+
+  std::map<char, Domain> domains;
+  std::vector<Number> term_pool;
+  size_t num_sequences = 0;
+  MemoryBudget::Usage memory_usage{MemoryBudget::Subsystem::SEQUENCES};
+
+  mutable std::mutex bfiles_mutex;
+  mutable std::list<BFile> bfiles;  // most recently used first
+  mutable std::unordered_map<UID, std::list<BFile>::iterator> bfiles_index;
+  mutable MemoryBudget::Usage bfiles_usage{MemoryBudget::Subsystem::BFILES};
+
+  friend class const_iterator;
+  friend class ManagedSequence;
 };
 
+// Iterates over all sequences in the index in order of their IDs. The
+// sequences are provided as temporary objects that are only valid until the
+// iterator is advanced. Names are read sequentially from the names files.
 class SequenceIndex::const_iterator {
  public:
-  using outer_iter_t =
-      std::map<char, std::vector<ManagedSequence>>::const_iterator;
-  using inner_iter_t = std::vector<ManagedSequence>::const_iterator;
+  using outer_iter_t = std::map<char, Domain>::const_iterator;
 
   const_iterator() = default;
-  const_iterator(outer_iter_t outer, outer_iter_t outer_end);
+  const_iterator(const SequenceIndex* index, outer_iter_t outer,
+                 outer_iter_t outer_end);
 
   const ManagedSequence& operator*() const;
   const ManagedSequence* operator->() const;
@@ -40,8 +117,12 @@ class SequenceIndex::const_iterator {
 
  private:
   void advance_to_valid();
+  std::string readName(UID id) const;
+  const SequenceIndex* index = nullptr;
   outer_iter_t outer_it;
   outer_iter_t outer_end;
-  inner_iter_t inner_it;
-  inner_iter_t inner_end;
+  size_t inner_index = 0;
+  mutable ManagedSequence current;
+  mutable std::shared_ptr<std::ifstream> names;  // of the current domain
+  mutable char names_domain = 0;
 };
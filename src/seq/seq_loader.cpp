@@ -104,22 +104,26 @@ void SequenceLoader::loadData(const std::string &folder, char domain) {
     }
 
     // add sequence to index
-    index.add(ManagedSequence(UID(domain, id), "", seq_full));
+    index.add(UID(domain, id), seq_full);
     num_loaded++;
   }
 }
 
 void SequenceLoader::loadNames(const std::string &folder, char domain) {
   const std::string path = folder + "names";
-  Log::get().debug("Loading sequence names from \"" + path + "\"");
+  Log::get().debug("Loading sequence name positions from \"" + path + "\"");
   std::ifstream names(path);
   if (!names.good()) {
     Log::get().error("Sequence names not found: " + path, true);
   }
+  index.setNamesFile(domain, path);
   std::string line;
   size_t pos;
   size_t id;
+  int64_t line_pos = 0, next_pos = 0;
   while (std::getline(names, line)) {
+    line_pos = next_pos;
+    next_pos += line.size() + 1;
     if (line.empty() || line[0] == '#') {
       continue;
     }
@@ -134,16 +138,8 @@ void SequenceLoader::loadNames(const std::string &folder, char domain) {
     if (pos >= line.length() || line[pos] != ' ' || id == 0) {
       throwParseError(line);
     }
-    ++pos;
-    const auto uid = UID(domain, id);
-    if (index.exists(uid)) {
-      index.get(uid).name = line.substr(pos);
-      if (Log::get().level == Log::Level::DEBUG) {
-        std::stringstream buf;
-        buf << "Loaded sequence " << index.get(uid);
-        Log::get().debug(buf.str());
-      }
-    }
+    // only the position is stored; names are read on demand
+    index.setNamePos(UID(domain, id), line_pos);
   }
 }
 
@@ -155,7 +151,7 @@ void SequenceLoader::loadOffsets(const std::string &folder, char domain) {
   for (const auto &entry : entries) {
     const UID id = entry.first;
     if (index.exists(id)) {
-      index.get(id).offset = std::stoll(entry.second);
+      index.setOffset(id, std::stoll(entry.second));
     }
   }
 }
@@ -203,11 +199,10 @@ void SequenceLoader::checkConsistency() const {
   Log::get().debug("Checking sequence data consistency");
   size_t num_seqs = 0, num_names = 0;
   for (const auto &s : index) {
-    Log::get().debug("Checking consistency of " + s.string());
     if (s.id.empty()) {
       Log::get().error("Empty sequence ID", true);
     }
-    if (s.name.empty()) {
+    if (!index.hasName(s.id)) {
       // only a warning because some new sequences may not have a name yet
       Log::get().warn("Missing name for sequence " + s.id.string());
     } else {
@@ -3,12 +3,14 @@
 #include <algorithm>
 #include <cstdio>
 #include <fstream>
+#include <sstream>
 
 #include "math/big_number.hpp"
 #include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/process.hpp"
 #include "sys/setup.hpp"
+#include "sys/tool_worker.hpp"
 
 const size_t SequenceUtil::DEFAULT_SEQ_LENGTH = 80;  // magic number
 
@@ -69,14 +71,9 @@ static bool looksLikeErrorLine(const std::string& line) {
          (lowered.find("error") != std::string::npos);
 }
 
-// Helper function to parse tool output file, extracting both errors and numbers
-static ParsedToolOutput parseToolOutput(const std::string& resultPath) {
+// Helper function to parse tool output, extracting both errors and numbers
+static ParsedToolOutput parseToolOutput(std::istream& resultFile) {
   ParsedToolOutput result;
-  std::ifstream resultFile(resultPath);
-  if (!resultFile) {
-    return result;  // Return empty result if file cannot be opened
-  }
-
   std::string line;
   bool inError =
       false;  // once set, all following lines are treated as error text
@@ -114,39 +111,28 @@ static ParsedToolOutput parseToolOutput(const std::string& resultPath) {
       inError = true;
     }
   }
-  resultFile.close();
-
   return result;
 }
 
-bool SequenceUtil::evalFormulaWithExternalTool(
-    const std::string& evalCode, const std::string& toolName,
-    const std::string& toolPath, const std::string& resultPath,
-    const std::vector<std::string>& args, int timeoutSeconds, Sequence& result,
-    const std::string& workingDir, const std::string& stdinContent) {
-  // write tool file
-  std::ofstream toolFile(toolPath);
-  if (!toolFile) {
-    Log::get().error("Error generating " + toolName + " file", true);
+static ParsedToolOutput parseToolOutput(const std::string& resultPath) {
+  std::ifstream resultFile(resultPath);
+  if (!resultFile) {
+    return {};  // Return empty result if file cannot be opened
   }
-  toolFile << evalCode;
-  toolFile.close();
-
-  int exitCode = execWithTimeout(args, timeoutSeconds, resultPath, workingDir,
-                                 stdinContent);
-
-  // Parse the output file for both errors and numeric values
-  auto parsed = parseToolOutput(resultPath);
+  return parseToolOutput(resultFile);
+}
 
+// Check the exit code and the parsed output of an external tool. Returns
+// false if a timeout occurred and throws an exception on errors.
+static bool checkToolOutput(int exitCode, const ParsedToolOutput& parsed,
+                            const std::string& toolName, Sequence& result) {
   // Handle timeouts
   if (exitCode == PROCESS_ERROR_TIMEOUT) {
-    std::remove(resultPath.c_str());
     return false;
   }
 
   // Handle non-zero exit codes
   if (exitCode != 0) {
-    std::remove(resultPath.c_str());
     std::string fullMsg = "Error evaluating " + toolName +
                           " code: tool exited with code " +
                           std::to_string(exitCode);
@@ -158,23 +144,60 @@ bool SequenceUtil::evalFormulaWithExternalTool(
 
   // Handle parsing errors (e.g., non-numeric output)
   if (parsed.hasError()) {
-    std::remove(resultPath.c_str());
     Log::get().error(
         "Error parsing " + toolName + " output: " + parsed.errorMsg, true);
   }
 
   // Handle no numeric output
   if (parsed.numericValues.empty()) {
-    std::remove(resultPath.c_str());
     Log::get().error("Error parsing " + toolName + " output: no numeric output",
                      true);
   }
 
-  // Clean up temporary files
-  std::remove(toolPath.c_str());
-  std::remove(resultPath.c_str());
-
   // Copy results to output parameter
   result = parsed.numericValues;
   return true;
 }
+
+bool SequenceUtil::evalFormulaWithExternalTool(
+    const std::string& evalCode, const std::string& toolName,
+    const std::string& toolPath, const std::string& resultPath,
+    const std::vector<std::string>& args, int timeoutSeconds, Sequence& result,
+    const std::string& workingDir, const std::string& stdinContent) {
+  // write tool file
+  std::ofstream toolFile(toolPath);
+  if (!toolFile) {
+    Log::get().error("Error generating " + toolName + " file", true);
+  }
+  toolFile << evalCode;
+  toolFile.close();
+
+  int exitCode = execWithTimeout(args, timeoutSeconds, resultPath, workingDir,
+                                 stdinContent);
+
+  // Parse the output file for both errors and numeric values
+  auto parsed = parseToolOutput(resultPath);
+  std::remove(resultPath.c_str());
+  if (!checkToolOutput(exitCode, parsed, toolName, result)) {
+    return false;
+  }
+
+  // Clean up temporary files
+  std::remove(toolPath.c_str());
+  return true;
+}
+
+bool SequenceUtil::evalFormulaWithWorkerPool(const std::string& evalCode,
+                                             const std::string& toolName,
+                                             ToolWorkerPool& pool,
+                                             int timeoutSeconds,
+                                             Sequence& result) {
+  std::vector<std::string> lines;
+  int exitCode = pool.eval(evalCode, timeoutSeconds, lines);
+  std::stringstream buf;
+  for (const auto& line : lines) {
+    buf << line << "\n";
+  }
+  auto parsed = parseToolOutput(buf);
+  return checkToolOutput(exitCode, parsed, toolName, result);
+}
@@ -3,6 +3,8 @@
 #include "base/uid.hpp"
 #include "math/sequence.hpp"
 
+class ToolWorkerPool;
+
 class SequenceUtil {
  public:
   static const size_t DEFAULT_SEQ_LENGTH;
@@ -30,4 +32,11 @@ class SequenceUtil {
                                           int timeoutSeconds, Sequence& result,
                                           const std::string& workingDir = "",
                                           const std::string& stdinContent = "");
+
+  // Evaluate generated code using a long-lived external tool process of the
+  // given worker pool. Errors are handled as in evalFormulaWithExternalTool().
+  static bool evalFormulaWithWorkerPool(const std::string& evalCode,
+                                        const std::string& toolName,
+                                        ToolWorkerPool& pool,
+                                        int timeoutSeconds, Sequence& result);
 };
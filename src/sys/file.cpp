@@ -23,6 +23,7 @@
 #include <psapi.h>
 #include <windows.h>
 #else
+#include <fcntl.h>
 #include <sys/file.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -372,3 +373,43 @@ void FolderLock::release() {
   fd = 0;
 #endif
 }
+
+FileLock::FileLock(const std::string &path) : path(path) {
+#ifdef _WIN64
+  fd = CreateFile(path.c_str(), GENERIC_WRITE, 0, 0, OPEN_ALWAYS, 0, 0);
+  if (fd == INVALID_HANDLE_VALUE) {
+    fd = nullptr;
+  }
+#else
+  fd = open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+  if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) != 0) {
+    close(fd);
+    fd = -1;
+  }
+#endif
+  if (isLocked()) {
+    Log::get().debug("Obtained lock " + path);
+  }
+}
+
+FileLock::~FileLock() {
+  if (!isLocked()) {
+    return;
+  }
+  Log::get().debug("Releasing lock " + path);
+  // the lock file is kept to avoid races with processes that already opened it
+#ifdef _WIN64
+  CloseHandle(fd);
+#else
+  flock(fd, LOCK_UN);
+  close(fd);
+#endif
+}
+
+bool FileLock::isLocked() const {
+#ifdef _WIN64
+  return fd != nullptr;
+#else
+  return fd >= 0;
+#endif
+}
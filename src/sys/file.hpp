@@ -77,3 +77,22 @@ class FolderLock {
   int fd;
 #endif
 };
+
+// Exclusive lock on a file that does not wait if the file is already locked
+// by another process. The lock is held until the object is destroyed.
+class FileLock {
+ public:
+  explicit FileLock(const std::string &path);
+
+  ~FileLock();
+
+  bool isLocked() const;
+
+ private:
+  std::string path;
+#ifdef _WIN64
+  void *fd;
+#else
+  int fd;
+#endif
+};
@@ -183,13 +183,9 @@ std::vector<std::string> Git::log(const std::string &folder,
   return commits;
 }
 
-std::vector<std::pair<std::string, std::string>> Git::diffTree(
-    const std::string &folder, const std::string &commit_id) {
+std::vector<std::pair<std::string, std::string>> readNameStatus(
+    const std::string &tmp_file) {
   std::vector<std::pair<std::string, std::string>> result;
-  auto tmp_file = getTmpFile();
-  git(folder, "diff-tree --no-commit-id --name-status -r " + commit_id +
-                  " > \"" + tmp_file + "\"");
-  // read changed file names from file
   std::ifstream in(tmp_file);
   std::string line;
   while (std::getline(in, line)) {
@@ -199,16 +195,41 @@ std::vector<std::pair<std::string, std::string>> Git::diffTree(
     iss >> entry.second;
     result.emplace_back(entry);
   }
+  in.close();
   std::remove(tmp_file.c_str());
   return result;
 }
 
+std::vector<std::pair<std::string, std::string>> Git::diffTree(
+    const std::string &folder, const std::string &commit_id) {
+  auto tmp_file = getTmpFile();
+  git(folder, "diff-tree --no-commit-id --name-status -r " + commit_id +
+                  " > \"" + tmp_file + "\"");
+  // read changed file names from file
+  return readNameStatus(tmp_file);
+}
+
+std::vector<std::pair<std::string, std::string>> Git::diff(
+    const std::string &folder, const std::string &commit_id) {
+  auto tmp_file = getTmpFile();
+  git(folder, "diff --name-status --no-renames " + commit_id + " > \"" +
+                  tmp_file + "\"");
+  return readNameStatus(tmp_file);
+}
+
 void Git::gunzip(const std::string &path, bool keep) { ::gunzip(path, keep); }
 
 std::string Git::extractHeadVersion(const std::string &folder,
                                     const std::string &file) {
+  return extractVersion(folder, "HEAD", file);
+}
+
+std::string Git::extractVersion(const std::string &folder,
+                                const std::string &revision,
+                                const std::string &file) {
   std::string tmp_file = getTmpFile();
-  if (!git(folder, "show HEAD:\"" + file + "\" > \"" + tmp_file + "\"",
+  if (!git(folder,
+           "show " + revision + ":\"" + file + "\" > \"" + tmp_file + "\"",
            false)) {
     return "";
   }
@@ -32,9 +32,20 @@ class Git {
   static std::vector<std::pair<std::string, std::string>> diffTree(
       const std::string &folder, const std::string &commit_id);
 
+  // Returns the status and names of files changed in the working tree since
+  // the given commit (renames are reported as deletions and additions).
+  static std::vector<std::pair<std::string, std::string>> diff(
+      const std::string &folder, const std::string &commit_id);
+
   static void gunzip(const std::string &path, bool keep);
 
   // Returns the path to a tmp file containing the HEAD version of the file.
   static std::string extractHeadVersion(const std::string &folder,
                                         const std::string &file);
+
+  // Returns the path to a tmp file containing the given revision of the file,
+  // or an empty string if the file does not exist in this revision.
+  static std::string extractVersion(const std::string &folder,
+                                    const std::string &revision,
+                                    const std::string &file);
 };
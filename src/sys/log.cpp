@@ -1,16 +1,246 @@
 #include "sys/log.hpp"
 
 #include <algorithm>
-#include <chrono>
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
 #include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <set>
 #include <thread>
+#include <vector>
+
+#ifndef _WIN64
+#include <pthread.h>
+#endif
 
 #include "sys/file.hpp"
+#include "sys/publisher.hpp"
 #include "sys/setup.hpp"
 #include "sys/util.hpp"
 #include "sys/web_client.hpp"
 
+namespace {
+
+struct Line {
+  uint64_t seq;
+  Log::Level level;
+  std::string text;
+};
+
+struct Buffer;
+
+// set when the buffer of the thread was destroyed at thread exit
+thread_local bool buffer_destroyed = false;
+
+// Writes the buffered lines of all threads in order. A background thread
+// flushes the buffers in short intervals, so that logging on the hot path
+// does not need system calls or a global lock.
+struct Writer {
+  static constexpr int64_t FLUSH_INTERVAL_MILLIS = 50;
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::set<Buffer*> buffers;
+  std::vector<Line> retired;  // lines of finished threads
+  std::atomic<uint64_t> next_seq{0};
+  std::atomic<bool> started{false};
+  bool stopping = false;
+  bool stopped = false;
+  bool registered_handlers = false;
+  std::thread* thread = nullptr;
+  std::ofstream file;
+  std::string path;
+
+  void start();
+  void stop();
+  void run();
+  void flushLocked();
+  void write(std::vector<Line>&& lines);
+};
+
+Writer& getWriter() {
+  // never destroyed, because other threads may log during exit
+  static Writer* writer = new Writer();
+  return *writer;
+}
+
+struct Buffer {
+  std::mutex mutex;
+  std::vector<Line> lines;
+
+  Buffer() {
+    auto& writer = getWriter();
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    writer.buffers.insert(this);
+  }
+
+  ~Buffer() {
+    auto& writer = getWriter();
+    std::lock_guard<std::mutex> lock(writer.mutex);
+    std::move(lines.begin(), lines.end(), std::back_inserter(writer.retired));
+    writer.buffers.erase(this);
+    buffer_destroyed = true;
+  }
+
+  void add(Log::Level level, std::string&& text) {
+    std::lock_guard<std::mutex> lock(mutex);  // only contended by flushes
+    lines.push_back({getWriter().next_seq++, level, std::move(text)});
+  }
+};
+
+// Returns the buffer of the current thread, or nullptr if it was destroyed.
+Buffer* getBuffer() {
+  if (buffer_destroyed) {
+    return nullptr;
+  }
+  thread_local Buffer buffer;
+  return &buffer;
+}
+
+void stopAtExit() { getWriter().stop(); }
+
+#ifndef _WIN64
+// Forked child processes inherit the buffers but not the background thread.
+// The buffers are flushed before forking to avoid duplicate lines.
+void prepareFork() {
+  auto& writer = getWriter();
+  writer.mutex.lock();
+  writer.flushLocked();
+  for (auto buffer : writer.buffers) {
+    buffer->mutex.lock();
+  }
+}
+
+void parentAfterFork() {
+  auto& writer = getWriter();
+  for (auto buffer : writer.buffers) {
+    buffer->mutex.unlock();
+  }
+  writer.mutex.unlock();
+}
+
+void childAfterFork() {
+  auto& writer = getWriter();
+  for (auto buffer : writer.buffers) {
+    buffer->lines.clear();
+    buffer->mutex.unlock();
+  }
+  writer.thread = nullptr;  // not running in the child
+  writer.started = false;
+  writer.stopping = false;
+  writer.mutex.unlock();
+}
+#endif
+
+void Writer::start() {
+  if (!registered_handlers) {
+    std::atexit(stopAtExit);
+#ifndef _WIN64
+    pthread_atfork(prepareFork, parentAfterFork, childAfterFork);
+#endif
+    registered_handlers = true;
+  }
+  thread = new std::thread(&Writer::run, this);
+  started = true;
+}
+
+void Writer::stop() {
+  std::thread* t;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!started) {
+      return;
+    }
+    stopping = true;
+    started = false;
+    t = thread;
+    thread = nullptr;
+  }
+  cond.notify_all();
+  if (t) {
+    t->join();
+    delete t;
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  flushLocked();
+  stopped = true;
+}
+
+void Writer::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping) {
+    cond.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MILLIS));
+    flushLocked();
+  }
+}
+
+void Writer::flushLocked() {
+  std::vector<Line> lines;
+  lines.swap(retired);
+  for (auto buffer : buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    if (lines.empty()) {
+      lines.swap(buffer->lines);
+    } else {
+      std::move(buffer->lines.begin(), buffer->lines.end(),
+                std::back_inserter(lines));
+      buffer->lines.clear();
+    }
+  }
+  write(std::move(lines));
+}
+
+void Writer::write(std::vector<Line>&& lines) {
+  if (lines.empty()) {
+    return;
+  }
+  std::sort(lines.begin(), lines.end(),
+            [](const Line& a, const Line& b) { return a.seq < b.seq; });
+  const bool to_file = file.is_open();
+  std::string console, text;
+  for (const auto& line : lines) {
+    if (!to_file || line.level >= Log::Level::ERROR) {
+      console += line.text;
+    }
+    if (to_file) {
+      text += line.text;
+    }
+  }
+  if (!console.empty()) {
+    std::cerr.write(console.data(), console.size());
+    std::cerr.flush();
+  }
+  if (to_file) {
+    file.write(text.data(), text.size());
+    file.flush();
+  }
+}
+
+// formats the current time; cached per thread for the current second
+const std::string& getTimestamp() {
+  thread_local time_t cached_time = 0;
+  thread_local std::string cached;
+  const time_t now = time(nullptr);
+  if (now != cached_time || cached.empty()) {
+    struct tm timeinfo;
+#ifdef _WIN64
+    localtime_s(&timeinfo, &now);
+#else
+    localtime_r(&now, &timeinfo);
+#endif
+    char buffer[80];
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
+    cached = buffer;
+    cached_time = now;
+  }
+  return cached;
+}
+
+}  // namespace
+
 Log::Log()
     : level(Level::INFO),
       silent(false),
@@ -26,6 +256,18 @@ void Log::debug(const std::string& msg) { log(Log::Level::DEBUG, msg); }
 
 void Log::info(const std::string& msg) { log(Log::Level::INFO, msg); }
 
+void Log::debug(const std::function<std::string()>& msg) {
+  if (isEnabled(Log::Level::DEBUG)) {
+    log(Log::Level::DEBUG, msg());
+  }
+}
+
+void Log::info(const std::function<std::string()>& msg) {
+  if (isEnabled(Log::Level::INFO)) {
+    log(Log::Level::INFO, msg());
+  }
+}
+
 void Log::warn(const std::string& msg) { log(Log::Level::WARN, msg); }
 
 void Log::error(const std::string& msg, bool throw_) {
@@ -98,13 +340,15 @@ void Log::slack(const std::string& msg, AlertDetails details) {
 #else
   cmd += " > " + slack_debug + ".out 2> " + slack_debug + ".err";
 #endif
-  auto exit_code = system(cmd.c_str());
-  if (exit_code != 0) {
-    Log::get().error("Error sending alert to Slack!", false);
-    std::ofstream out(slack_debug + ".cmd");
-    out << cmd;
-    out.close();
-  }
+  Publisher::get().post("Slack alert", [cmd]() {
+    if (system(cmd.c_str()) != 0) {
+      std::ofstream out(slack_debug + ".cmd");
+      out << cmd;
+      out.close();
+      return false;
+    }
+    return true;
+  });
 }
 
 void Log::discord(const std::string& msg, AlertDetails details) {
@@ -113,37 +357,21 @@ void Log::discord(const std::string& msg, AlertDetails details) {
         "Cannot send message to Discord because webhook is not set");
     return;
   }
-  const auto tmp_file_id = Random::get().gen() % 1000;
-  // attention: curl sometimes has problems with absolute paths.
-  // so we use a relative path here!
-  // TODO: extend WebClient::postFile to support content directly
-  const std::string tmp_file =
-      "loda_discord_" + std::to_string(tmp_file_id) + ".json";
-  std::ofstream out(tmp_file);
-  out << "{\"content\":\"" << escapeJsonString(details.text) << "\"}";
-  out.close();
-  const std::vector<std::string> headers = {"Content-Type: application/json"};
-  if (!WebClient::postFile(discord_webhook, tmp_file, {}, headers)) {
-    std::this_thread::sleep_for(std::chrono::seconds(1));
-    Log::get().warn("Retrying Discord message: " + details.text);
-    if (!WebClient::postFile(discord_webhook, tmp_file, {}, headers,
-                             true)) {  // for debugging
-      Log::get().error("Error sending message to Discord", false);
-    }
-  }
-  std::remove(tmp_file.c_str());
+  const std::string content =
+      "{\"content\":\"" + escapeJsonString(details.text) + "\"}";
+  const std::string webhook = discord_webhook;
+  Publisher::get().post("Discord message", [webhook, content]() {
+    const std::vector<std::string> headers = {
+        "Content-Type: application/json"};
+    return WebClient::postContent(webhook, content, {}, headers);
+  });
 }
 
 void Log::log(Level level, const std::string& msg) {
-  if (level < this->level || silent) {
+  if (!isEnabled(level)) {
     return;
   }
-  time_t rawtime;
-  char buffer[80];
-  time(&rawtime);
-  auto timeinfo = localtime(&rawtime);
-  strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-  std::string lev;
+  const char* lev = "";
   switch (level) {
     case Log::Level::DEBUG:
       lev = "DEBUG";
@@ -161,5 +389,64 @@ void Log::log(Level level, const std::string& msg) {
       lev = "ALERT";
       break;
   }
-  std::cerr << std::string(buffer) << "|" << lev << "|" << msg << std::endl;
+  const auto& timestamp = getTimestamp();
+  std::string text;
+  text.reserve(timestamp.size() + msg.size() + 8);
+  text += timestamp;
+  text += '|';
+  text += lev;
+  text += '|';
+  text += msg;
+  text += '\n';
+  auto& writer = getWriter();
+  auto buffer = getBuffer();  // registers the thread on first use
+  const bool urgent = level >= Level::ERROR;
+  if (buffer && writer.started && !urgent) {
+    buffer->add(level, std::move(text));
+    return;
+  }
+  // first message, urgent message or during exit
+  std::lock_guard<std::mutex> lock(writer.mutex);
+  if (!writer.started && !writer.stopped) {
+    writer.start();
+  }
+  if (buffer && !writer.stopped) {
+    buffer->add(level, std::move(text));
+    if (urgent) {
+      writer.flushLocked();
+    }
+  } else {
+    writer.flushLocked();
+    writer.write({{writer.next_seq++, level, std::move(text)}});
+  }
+}
+
+void Log::setFile(const std::string& path) {
+  auto& writer = getWriter();
+  std::lock_guard<std::mutex> lock(writer.mutex);
+  writer.flushLocked();
+  writer.file.close();
+  writer.path = path;
+  if (!path.empty()) {
+    ensureDir(path);
+    writer.file.open(path, std::ios::app);
+    if (!writer.file) {
+      writer.path.clear();
+      writer.write({{writer.next_seq++, Level::ERROR,
+                     getTimestamp() + "|ERROR|Cannot open log file " + path +
+                         "\n"}});
+    }
+  }
+}
+
+std::string Log::getFile() const {
+  auto& writer = getWriter();
+  std::lock_guard<std::mutex> lock(writer.mutex);
+  return writer.path;
+}
+
+void Log::flush() {
+  auto& writer = getWriter();
+  std::lock_guard<std::mutex> lock(writer.mutex);
+  writer.flushLocked();
 }
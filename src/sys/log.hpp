@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 
 class Log {
@@ -18,12 +19,29 @@ class Log {
 
   static Log &get();
 
+  bool isEnabled(Level l) const { return l >= level && !silent; }
+
   void debug(const std::string &msg);
   void info(const std::string &msg);
+
+  // Lazy variants that build the message only if the level is enabled.
+  void debug(const std::function<std::string()> &msg);
+  void info(const std::function<std::string()> &msg);
+
   void warn(const std::string &msg);
   void error(const std::string &msg, bool throw_ = false);
   void alert(const std::string &msg, AlertDetails details = AlertDetails());
 
+  // Writes the log to the given file instead of stderr. Errors and alerts
+  // are written to stderr as well. An empty path restores the default.
+  void setFile(const std::string &path);
+
+  std::string getFile() const;
+
+  // Writes all buffered messages. Messages are written by a background
+  // thread in short intervals; errors and alerts are written immediately.
+  void flush();
+
   Level level;
   bool silent;
   bool loaded_alerts_config;
@@ -0,0 +1,97 @@
+#include "sys/mapped_file.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN64
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+void readFileToBuffer(const std::string& path, std::vector<char>& buffer) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in) {
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  buffer.resize(static_cast<size_t>(in.tellg()));
+  in.seekg(0);
+  if (!in.read(buffer.data(), buffer.size())) {
+    throw std::runtime_error("Cannot read file: " + path);
+  }
+}
+
+#ifdef _WIN64
+
+MappedFile::MappedFile(const std::string& path)
+    : ptr(nullptr),
+      length(0),
+      file_handle(INVALID_HANDLE_VALUE),
+      mapping_handle(nullptr) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  LARGE_INTEGER size;
+  if (file != INVALID_HANDLE_VALUE && GetFileSizeEx(file, &size) &&
+      size.QuadPart > 0) {
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping) {
+      auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if (view) {
+        file_handle = file;
+        mapping_handle = mapping;
+        ptr = static_cast<const char*>(view);
+        length = static_cast<size_t>(size.QuadPart);
+        return;
+      }
+      CloseHandle(mapping);
+    }
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+  }
+  readFileToBuffer(path, buffer);
+  ptr = buffer.data();
+  length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+  if (mapping_handle) {
+    UnmapViewOfFile(ptr);
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) : ptr(nullptr), length(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Cannot open file: " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED) {
+      close(fd);  // the mapping remains valid
+      ptr = static_cast<const char*>(addr);
+      length = static_cast<size_t>(st.st_size);
+      return;
+    }
+  }
+  close(fd);
+  readFileToBuffer(path, buffer);
+  ptr = buffer.data();
+  length = buffer.size();
+}
+
+MappedFile::~MappedFile() {
+  if (ptr && buffer.empty()) {
+    munmap(const_cast<char*>(ptr), length);
+  }
+}
+
+#endif
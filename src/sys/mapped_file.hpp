@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of the contents of a file. The file is memory-mapped if
+// supported by the platform, otherwise it is read into a buffer. Files must
+// not be modified in place while mapped; replace them using rename instead.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data() const { return ptr; }
+
+  size_t size() const { return length; }
+
+ private:
+  const char* ptr;
+  size_t length;
+  std::vector<char> buffer;  // used if memory mapping is not available
+#ifdef _WIN64
+  void* file_handle;
+  void* mapping_handle;
+#endif
+};
@@ -0,0 +1,138 @@
+#include "sys/memory_budget.hpp"
+
+#include <algorithm>
+
+#include "sys/file.hpp"
+#include "sys/setup.hpp"
+
+namespace {
+
+// relative shares of the memory available for caches
+double getWeight(MemoryBudget::Subsystem subsystem) {
+  switch (subsystem) {
+    case MemoryBudget::Subsystem::TERMS_CACHE:
+      return 3.0;
+    case MemoryBudget::Subsystem::BFILES:
+      return 1.0;
+    case MemoryBudget::Subsystem::BACKOFF:
+      return 1.0;
+    default:
+      return 0.0;
+  }
+}
+
+std::string formatBytes(int64_t bytes) {
+  if (bytes < 1024 * 1024) {
+    return std::to_string(bytes / 1024) + "KB";
+  }
+  return std::to_string(bytes / (1024 * 1024)) + "MB";
+}
+
+}  // namespace
+
+MemoryBudget::Usage::Usage(Subsystem subsystem)
+    : account(&MemoryBudget::get().getAccount(subsystem)), bytes(0) {}
+
+MemoryBudget::Usage::Usage(const Usage& u) : account(u.account), bytes(0) {
+  add(u.bytes);
+}
+
+MemoryBudget::Usage& MemoryBudget::Usage::operator=(const Usage& u) {
+  if (this != &u) {
+    set(0);
+    account = u.account;
+    add(u.bytes);
+  }
+  return *this;
+}
+
+MemoryBudget::Usage::~Usage() { set(0); }
+
+void MemoryBudget::Usage::add(int64_t b) {
+  bytes += b;
+  account->usage.fetch_add(b, std::memory_order_relaxed);
+}
+
+void MemoryBudget::Usage::set(int64_t b) { add(b - bytes); }
+
+MemoryBudget& MemoryBudget::get() {
+  static MemoryBudget budget;
+  return budget;
+}
+
+std::string MemoryBudget::getName(Subsystem subsystem) {
+  switch (subsystem) {
+    case Subsystem::SEQUENCES:
+      return "sequences";
+    case Subsystem::BFILES:
+      return "bfiles";
+    case Subsystem::MATCHERS:
+      return "matchers";
+    case Subsystem::STATS:
+      return "stats";
+    case Subsystem::PROGRAM_CACHE:
+      return "program_cache";
+    case Subsystem::TERMS_CACHE:
+      return "terms_cache";
+    case Subsystem::BACKOFF:
+      return "backoff";
+  }
+  return "unknown";
+}
+
+bool MemoryBudget::isCache(Subsystem subsystem) {
+  return getWeight(subsystem) > 0;
+}
+
+bool MemoryBudget::update() {
+  const bool has_memory = Setup::hasMemory();
+  update(getMemUsage(), Setup::getMaxMemory());
+  return has_memory;
+}
+
+void MemoryBudget::update(int64_t process_usage, int64_t limit) {
+  int64_t caches = 0;
+  double weights = 0;
+  for (size_t i = 0; i < NUM_SUBSYSTEMS; i++) {
+    const auto s = static_cast<Subsystem>(i);
+    if (isCache(s)) {
+      caches += std::max<int64_t>(accounts[i].getUsage(), 0);
+      weights += getWeight(s);
+    }
+  }
+  const bool low_usage = process_usage < GROW_THRESHOLD * limit;
+  const bool at_limit = process_usage > SHRINK_THRESHOLD * limit;
+  // memory left for caches after all other memory usage
+  const int64_t others = std::max<int64_t>(process_usage - caches, 0);
+  const double available =
+      std::max<double>(GROW_THRESHOLD * limit - others, 0.0);
+  for (size_t i = 0; i < NUM_SUBSYSTEMS; i++) {
+    const auto s = static_cast<Subsystem>(i);
+    if (!isCache(s)) {
+      continue;
+    }
+    auto& account = accounts[i];
+    const double share = available * getWeight(s) / weights;
+    const bool over_share = account.getUsage() > share;
+    account.may_grow = low_usage || !over_share;
+    account.should_shrink = at_limit && over_share;
+  }
+}
+
+std::string MemoryBudget::summarize() const {
+  std::string result;
+  for (size_t i = 0; i < NUM_SUBSYSTEMS; i++) {
+    const auto s = static_cast<Subsystem>(i);
+    const auto& account = accounts[i];
+    if (!result.empty()) {
+      result += ", ";
+    }
+    result += getName(s) + " " + formatBytes(account.getUsage());
+    if (account.shouldShrink()) {
+      result += " (shrinking)";
+    } else if (!account.mayGrow()) {
+      result += " (full)";
+    }
+  }
+  return result;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Central accounting of the memory used by the large data structures and
+// caches. Each subsystem has an account with an estimated number of bytes.
+// The memory available for caches is shared between the cache subsystems by
+// weight. When the process memory usage gets high, caches that use more than
+// their share stop growing, and if the limit is reached, they are asked to
+// shrink. Caches below their share keep working, so that they degrade one by
+// one instead of all at the same time.
+class MemoryBudget {
+ public:
+  enum class Subsystem {
+    SEQUENCES,
+    BFILES,
+    MATCHERS,
+    STATS,
+    PROGRAM_CACHE,
+    TERMS_CACHE,
+    BACKOFF,
+  };
+
+  static constexpr size_t NUM_SUBSYSTEMS = 7;
+
+  // estimated overhead of a node in a hash map or set in bytes
+  static constexpr size_t NODE_OVERHEAD = 32;
+
+  // fraction of the memory limit above which caches stop growing beyond
+  // their share
+  static constexpr double GROW_THRESHOLD = 0.8;
+
+  // fraction of the memory limit above which caches that use more than
+  // their share are asked to shrink
+  static constexpr double SHRINK_THRESHOLD = 0.95;
+
+  class Account {
+   public:
+    int64_t getUsage() const { return usage.load(std::memory_order_relaxed); }
+
+    bool mayGrow() const { return may_grow.load(std::memory_order_relaxed); }
+
+    bool shouldShrink() const {
+      return should_shrink.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<int64_t> usage{0};
+    std::atomic<bool> may_grow{true};
+    std::atomic<bool> should_shrink{false};
+
+    friend class MemoryBudget;
+  };
+
+  // Tracks the memory usage of a single object in the account of a
+  // subsystem. Copies are accounted separately.
+  class Usage {
+   public:
+    explicit Usage(Subsystem subsystem);
+
+    Usage(const Usage& u);
+
+    Usage& operator=(const Usage& u);
+
+    ~Usage();
+
+    void add(int64_t bytes);
+
+    void set(int64_t bytes);
+
+    int64_t get() const { return bytes; }
+
+    bool mayGrow() const { return account->mayGrow(); }
+
+    bool shouldShrink() const { return account->shouldShrink(); }
+
+   private:
+    Account* account;
+    int64_t bytes;
+  };
+
+  static MemoryBudget& get();
+
+  static std::string getName(Subsystem subsystem);
+
+  static bool isCache(Subsystem subsystem);
+
+  Account& getAccount(Subsystem subsystem) {
+    return accounts[static_cast<size_t>(subsystem)];
+  }
+
+  // Updates the states of the cache accounts based on the memory usage of
+  // the process. Returns false if the memory limit is reached (see
+  // Setup::hasMemory()).
+  bool update();
+
+  // Updates the states of the cache accounts for a given memory usage and
+  // limit in bytes.
+  void update(int64_t process_usage, int64_t limit);
+
+  // Returns a one-line summary of the usage per subsystem.
+  std::string summarize() const;
+
+ private:
+  std::array<Account, NUM_SUBSYSTEMS> accounts;
+};
@@ -1,10 +1,11 @@
 #include "sys/metrics.hpp"
 
 #include <algorithm>
-#include <fstream>
+#include <sstream>
 
 #include "sys/file.hpp"
 #include "sys/log.hpp"
+#include "sys/publisher.hpp"
 #include "sys/setup.hpp"
 #include "sys/util.hpp"
 #include "sys/web_client.hpp"
@@ -17,7 +18,6 @@ Metrics::Metrics()
   if (!host.empty()) {
     auth = Setup::getSetupValue("LODA_INFLUXDB_AUTH");
   }
-  tmp_file_id = Random::get().gen() % 1000;
 }
 
 Metrics &Metrics::get() {
@@ -33,25 +33,43 @@ void Metrics::write(const std::vector<Entry> &entries) const {
     Log::get().debug("Publishing metrics to InfluxDB");
     notified = true;
   }
-  // attention: curl sometimes has problems with absolute paths.
-  // so we use a relative path here!
-  const std::string tmp_file =
-      "loda_metrics_" + std::to_string(tmp_file_id) + ".txt";
-  std::ofstream out(tmp_file);
-  for (const auto &entry : entries) {
-    out << entry.field;
-    for (const auto &l : entry.labels) {
-      auto v = l.second;
-      replaceAll(v, " ", "\\ ");
-      out << "," << l.first << "=" << v;
+  {
+    // points of the same series in one request would get the same
+    // timestamp, so only the latest value is kept
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &entry : entries) {
+      std::string series = entry.field;
+      for (const auto &l : entry.labels) {
+        auto v = l.second;
+        replaceAll(v, " ", "\\ ");
+        series += "," + l.first + "=" + v;
+      }
+      pending[series] = entry.value;
     }
-    out << " value=" << entry.value << "\n";
   }
-  out.close();
+  Publisher::get().post(
+      "metrics", [this]() { return publish(); }, true);
+}
+
+bool Metrics::publish() const {
+  std::map<std::string, double> points;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    points.swap(pending);
+  }
+  if (points.empty()) {
+    return true;
+  }
+  std::stringstream out;
+  for (const auto &p : points) {
+    out << p.first << " value=" << p.second << "\n";
+  }
   const std::string url = host + "/write?db=loda";
-  if (!WebClient::postFile(url, tmp_file, auth)) {
-    WebClient::postFile(url, tmp_file, auth, {}, true);  // for debugging
-    Log::get().error("Error publishing metrics", false);
+  if (WebClient::postContent(url, out.str(), auth)) {
+    return true;
   }
-  std::remove(tmp_file.c_str());
+  // keep the values for the retry unless there are newer ones
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.insert(points.begin(), points.end());
+  return false;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -16,13 +17,18 @@ class Metrics {
 
   static Metrics& get();
 
+  // Queues the entries for publishing in the background. Pending values of
+  // the same series are replaced by newer ones.
   void write(const std::vector<Entry>& entries) const;
 
   const int64_t publish_interval;
 
  private:
+  bool publish() const;
+
   std::string host;
   std::string auth;
-  int64_t tmp_file_id;
   mutable bool notified;
+  mutable std::mutex mutex;
+  mutable std::map<std::string, double> pending;  // series -> value
 };
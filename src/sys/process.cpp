@@ -1,17 +1,24 @@
 #include "sys/process.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include "sys/trace.hpp"
+
 #ifdef _WIN64
 #include <windows.h>
 #else
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <csignal>
 #include <ctime>
 #endif
@@ -36,23 +43,156 @@ HANDLE createWindowsProcess(const std::string& command) {
 
 #endif
 
-bool isChildProcessAlive(HANDLE pid) {
-  if (pid == 0) {
+#ifndef _WIN64
+
+// Reap a terminated child process without blocking. Returns true if the
+// process terminated.
+static bool tryReap(pid_t pid, int& exitCode) {
+  int status = 0;
+  if (waitpid(pid, &status, WNOHANG) != pid) {
     return false;
   }
-#ifdef _WIN64
-  DWORD exit_code = STILL_ACTIVE;
-  GetExitCodeProcess(pid, &exit_code);
-  if (exit_code != STILL_ACTIVE) {
-    CloseHandle(pid);
-    return false;
+  if (WIFEXITED(status)) {
+    exitCode = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    exitCode = 128 + WTERMSIG(status);
+  } else {
+    exitCode = -1;
   }
   return true;
+}
+
+#endif
+
+int64_t waitForChildProcesses(const std::vector<HANDLE>& pids,
+                              int64_t timeoutMillis, int& exitCode) {
+#ifdef _WIN64
+  std::vector<HANDLE> handles;
+  std::vector<int64_t> indices;
+  for (size_t i = 0; i < pids.size(); i++) {
+    if (pids[i] != 0) {
+      handles.push_back(pids[i]);
+      indices.push_back(i);
+    }
+  }
+  const auto start = GetTickCount64();
+  while (!handles.empty()) {
+    // wait for at most MAXIMUM_WAIT_OBJECTS handles at a time
+    const DWORD n = static_cast<DWORD>(
+        std::min<size_t>(handles.size(), MAXIMUM_WAIT_OBJECTS));
+    const int64_t elapsed = GetTickCount64() - start;
+    const int64_t remaining = std::max<int64_t>(timeoutMillis - elapsed, 0);
+    const DWORD wait =
+        handles.size() > n
+            ? static_cast<DWORD>(std::min<int64_t>(remaining, 100))
+            : static_cast<DWORD>(remaining);
+    const DWORD result = WaitForMultipleObjects(n, handles.data(), FALSE, wait);
+    if (result < WAIT_OBJECT_0 + n) {
+      const size_t j = result - WAIT_OBJECT_0;
+      DWORD code = 0;
+      GetExitCodeProcess(handles[j], &code);
+      CloseHandle(handles[j]);
+      exitCode = static_cast<int>(code);
+      return indices[j];
+    }
+    if (remaining == 0) {
+      break;
+    }
+    // rotate, so that all handles are checked
+    std::rotate(handles.begin(), handles.begin() + n, handles.end());
+    std::rotate(indices.begin(), indices.begin() + n, indices.end());
+  }
+  if (timeoutMillis > 0 && handles.empty()) {
+    Sleep(static_cast<DWORD>(timeoutMillis));
+  }
+  return -1;
 #else
-  return (waitpid(pid, nullptr, WNOHANG) == 0);
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeoutMillis);
+  int64_t sleep_millis = 1;  // backoff if process descriptors are unsupported
+  while (true) {
+    for (size_t i = 0; i < pids.size(); i++) {
+      if (pids[i] != 0 && tryReap(pids[i], exitCode)) {
+        return i;
+      }
+    }
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())
+            .count();
+    if (remaining <= 0) {
+      return -1;
+    }
+    // wait for an exit event of any child using process file descriptors
+    std::vector<struct pollfd> fds;
+    bool has_pidfds = true;
+#ifdef SYS_pidfd_open
+    for (auto pid : pids) {
+      if (pid == 0) {
+        continue;
+      }
+      const int pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+      if (pidfd < 0) {
+        has_pidfds = false;
+        break;
+      }
+      fds.push_back({pidfd, POLLIN, 0});
+    }
+#else
+    has_pidfds = false;
+#endif
+    if (has_pidfds) {
+      // without children, this just sleeps until the deadline
+      int ready;
+      do {
+        ready = poll(fds.data(), fds.size(), static_cast<int>(remaining));
+      } while (ready < 0 && errno == EINTR);
+    } else {
+      const auto millis = std::min<int64_t>(remaining, sleep_millis);
+      usleep(static_cast<useconds_t>(millis) * 1000);
+      sleep_millis = std::min<int64_t>(sleep_millis * 2, 100);
+    }
+    for (const auto& fd : fds) {
+      close(fd.fd);
+    }
+  }
+#endif
+}
+
+#ifndef _WIN64
+
+// Block until the child process terminates or the timeout is reached, using
+// a process file descriptor if supported. Returns 1 if the process
+// terminated, 0 if it was killed due to the timeout and -1 if process file
+// descriptors are not supported, so that the caller needs to poll.
+static int waitWithTimeout(int pid, int timeoutSeconds, int& status) {
+#ifdef SYS_pidfd_open
+  const int pidfd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+  if (pidfd < 0) {
+    return -1;
+  }
+  struct pollfd fd = {pidfd, POLLIN, 0};
+  int ready;
+  do {
+    ready = poll(&fd, 1, timeoutSeconds * 1000);
+  } while (ready < 0 && errno == EINTR);
+  close(pidfd);
+  if (ready == 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    return 0;
+  }
+  if (waitpid(pid, &status, 0) != pid) {
+    throw std::runtime_error("waitpid failed");
+  }
+  return 1;
+#else
+  return -1;
 #endif
 }
 
+#endif
+
 int execWithTimeout(const std::vector<std::string>& args, int timeoutSeconds,
                     const std::string& outputFile,
                     const std::string& workingDir,
@@ -62,6 +202,10 @@ int execWithTimeout(const std::vector<std::string>& args, int timeoutSeconds,
       "execWithTimeout is only supported on Unix-like systems");
 #else
   // Unix implementation
+  Trace::Span span("tool", "exec");
+  if (span && !args.empty()) {
+    span.setArg(args[0]);
+  }
 
   // Only create a stdin pipe when stdinContent is non-empty
   int stdinPipe[2] = {-1, -1};
@@ -123,8 +267,15 @@ int execWithTimeout(const std::vector<std::string>& args, int timeoutSeconds,
   }
   // Parent
   int status = 0;
+  const int waited = waitWithTimeout(pid, timeoutSeconds, status);
+  if (waited == 0) {
+    return PROCESS_ERROR_TIMEOUT;
+  }
+  // fallback without process file descriptors: poll with increasing delays,
+  // so that short-running tools are not delayed unnecessarily
   time_t start = time(nullptr);
-  while (true) {
+  useconds_t delay = 1000;
+  while (waited < 0) {
     pid_t result = waitpid(pid, &status, WNOHANG);
     if (result == pid) break;
     if (result == -1) {
@@ -134,7 +285,8 @@ int execWithTimeout(const std::vector<std::string>& args, int timeoutSeconds,
       kill(pid, SIGKILL);
       return PROCESS_ERROR_TIMEOUT;
     }
-    usleep(100000);  // Sleep for 100 ms
+    usleep(delay);
+    delay = std::min<useconds_t>(2 * delay, 100000);  // at most 100 ms
   }
 
   // Check output file for "alarm interrupt" messages that indicate timeout
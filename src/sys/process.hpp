@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,9 @@ typedef int64_t HANDLE;
 // Parent-side sentinel (returned by the parent when it kills a timed-out
 // child process):
 //  - PROCESS_ERROR_TIMEOUT (124): child was terminated due to timeout
+//  - PROCESS_ERROR_INCOMPLETE (123): worker process exited successfully
+//  before completing its request (see ToolWorkerPool)
+#define PROCESS_ERROR_INCOMPLETE 123
 #define PROCESS_ERROR_TIMEOUT 124
 #define PROCESS_ERROR_OPEN_OUTPUT 125
 #define PROCESS_ERROR_CHDIR 126
@@ -35,7 +39,12 @@ HANDLE createWindowsProcess(const std::string& command);
 
 #endif
 
-bool isChildProcessAlive(HANDLE pid);
+// Block until one of the given child processes terminates or the timeout is
+// reached. Entries equal to 0 are ignored. Returns the index of a terminated
+// child process and sets its exit code, or -1 if the timeout was reached.
+// The terminated process is reaped, i.e. its handle must not be used again.
+int64_t waitForChildProcesses(const std::vector<HANDLE>& pids,
+                              int64_t timeoutMillis, int& exitCode);
 
 // Run a process with arguments and optional output redirection, kill after
 // timeoutSeconds. Optionally run the process from workingDir (chdir).
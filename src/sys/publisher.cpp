@@ -0,0 +1,122 @@
+#include "sys/publisher.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+#ifndef _WIN64
+#include <pthread.h>
+#endif
+
+#include "sys/log.hpp"
+
+namespace {
+
+void flushAtExit() {
+  Publisher::get().flush(
+      std::chrono::seconds(Publisher::FLUSH_TIMEOUT_SECS));
+}
+
+}  // namespace
+
+Publisher::Publisher(std::chrono::milliseconds retry_delay)
+    : retry_delay(retry_delay), running(false) {}
+
+Publisher::~Publisher() {
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [this]() { return !running; });
+}
+
+Publisher& Publisher::get() {
+  // never destroyed, because the background thread may outlive the flush
+  // at exit; the log must be constructed first to outlive the exit handler
+  static Publisher* publisher = []() {
+    Log::get();
+    std::atexit(flushAtExit);
+#ifndef _WIN64
+    pthread_atfork(prepareFork, parentAfterFork, childAfterFork);
+#endif
+    return new Publisher();
+  }();
+  return *publisher;
+}
+
+#ifndef _WIN64
+void Publisher::prepareFork() { get().mutex.lock(); }
+
+void Publisher::parentAfterFork() { get().mutex.unlock(); }
+
+void Publisher::childAfterFork() {
+  auto& publisher = get();
+  publisher.queue.clear();
+  publisher.running = false;  // not running in the child
+  publisher.mutex.unlock();
+}
+#endif
+
+void Publisher::post(const std::string& name, Task task, bool coalesce) {
+  std::lock_guard<std::mutex> lock(mutex);
+  if (coalesce && std::any_of(queue.begin(), queue.end(), [&](const Entry& e) {
+        return e.coalesce && e.name == name;
+      })) {
+    return;
+  }
+  if (queue.size() >= MAX_QUEUE_SIZE) {
+    Log::get().warn("Dropping " + name + " because too many are pending");
+    return;
+  }
+  queue.push_back({name, std::move(task), coalesce, 0,
+                   std::chrono::steady_clock::now()});
+  if (!running) {
+    // the thread is detached, so that it does not need to be joined in
+    // forked child processes
+    running = true;
+    std::thread(&Publisher::run, this).detach();
+  } else {
+    cond.notify_all();
+  }
+}
+
+bool Publisher::flush(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return cond.wait_for(lock, timeout, [this]() { return !running; });
+}
+
+void Publisher::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!queue.empty()) {
+    // run the first task that is not waiting for a retry
+    const auto now = std::chrono::steady_clock::now();
+    auto it = std::min_element(queue.begin(), queue.end(),
+                               [](const Entry& a, const Entry& b) {
+                                 return a.not_before < b.not_before;
+                               });
+    if (it->not_before > now) {
+      cond.wait_until(lock, it->not_before);
+      continue;
+    }
+    auto entry = std::move(*it);
+    queue.erase(it);
+    lock.unlock();
+    bool success = false;
+    try {
+      success = entry.task();
+    } catch (const std::exception& e) {
+      Log::get().warn("Error sending " + entry.name + ": " + e.what());
+    }
+    lock.lock();
+    if (success) {
+      continue;
+    }
+    if (++entry.attempts < MAX_ATTEMPTS) {
+      Log::get().warn("Retrying " + entry.name);
+      entry.not_before = std::chrono::steady_clock::now() +
+                         retry_delay * (1 << (entry.attempts - 1));
+      queue.push_back(std::move(entry));
+    } else {
+      Log::get().error("Error sending " + entry.name, false);
+    }
+  }
+  running = false;
+  cond.notify_all();
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+// Runs tasks that publish data to external services, e.g. metrics and
+// alerts, in a background thread, so that slow or unavailable services do
+// not block the caller. Failed tasks are retried a limited number of times.
+// A coalescing task is only queued if no task with the same name is pending;
+// such tasks are expected to publish the latest data when they run. The
+// background thread only exists while there are pending tasks.
+class Publisher {
+ public:
+  // Returns true on success.
+  using Task = std::function<bool()>;
+
+  static constexpr size_t MAX_QUEUE_SIZE = 100;  // magic number
+  static constexpr size_t MAX_ATTEMPTS = 3;
+  static constexpr int64_t FLUSH_TIMEOUT_SECS = 5;
+
+  explicit Publisher(std::chrono::milliseconds retry_delay =
+                         std::chrono::milliseconds(1000));
+
+  // Waits for the pending tasks to finish.
+  ~Publisher();
+
+  Publisher(const Publisher&) = delete;
+  Publisher& operator=(const Publisher&) = delete;
+
+  // Shared instance. Pending tasks are flushed at exit.
+  static Publisher& get();
+
+  // Queues a task. The name is used in log messages and for coalescing.
+  // Tasks are dropped with a warning if the queue is full.
+  void post(const std::string& name, Task task, bool coalesce = false);
+
+  // Waits until all tasks are finished or the timeout is reached. Returns
+  // true if there are no pending tasks.
+  bool flush(std::chrono::milliseconds timeout);
+
+ private:
+  struct Entry {
+    std::string name;
+    Task task;
+    bool coalesce;
+    size_t attempts;
+    std::chrono::steady_clock::time_point not_before;
+  };
+
+  void run();
+
+#ifndef _WIN64
+  // Forked child processes inherit the queue of the shared instance but not
+  // the background thread. The pending tasks are left to the parent.
+  static void prepareFork();
+  static void parentAfterFork();
+  static void childAfterFork();
+#endif
+
+  const std::chrono::milliseconds retry_delay;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::deque<Entry> queue;
+  bool running;  // background thread started and not finished
+};
@@ -155,6 +155,9 @@ const std::string& Setup::getProgramsHome() {
 
 void Setup::setProgramsHome(const std::string& home) {
   PROGRAMS_HOME = home;
+  if (PROGRAMS_HOME.empty()) {
+    return;  // use the default
+  }
   checkDir(PROGRAMS_HOME);
   ensureTrailingFileSep(PROGRAMS_HOME);
   checkDir(PROGRAMS_HOME);
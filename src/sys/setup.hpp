@@ -41,6 +41,11 @@ class Setup {
 
   static const std::string& getProgramsHome();
 
+  // Returns the programs home if it is set, or an empty string if the default
+  // is used. The directory is not checked.
+  static const std::string& getProgramsHomeNoCheck() { return PROGRAMS_HOME; }
+
+  // Set the programs home. An empty string resets it to the default.
   static void setProgramsHome(const std::string& home);
 
   static bool existsProgramsHome();
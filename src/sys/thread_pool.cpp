@@ -0,0 +1,76 @@
+#include "sys/thread_pool.hpp"
+
+#include <algorithm>
+
+#include "sys/setup.hpp"
+
+ThreadPool::ThreadPool(size_t num_threads) : num_active(0), stopping(false) {
+  num_threads = std::max<size_t>(num_threads, 1);
+  for (size_t i = 0; i < num_threads; i++) {
+    workers.emplace_back([this]() { run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  task_available.notify_all();
+  for (auto& w : workers) {
+    w.join();
+  }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.emplace_back(std::move(task));
+  }
+  task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  tasks_done.wait(lock, [this]() { return tasks.empty() && num_active == 0; });
+  if (error) {
+    auto e = error;
+    error = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+size_t ThreadPool::getDefaultNumThreads() {
+  return std::max<int64_t>(Setup::getMaxInstances(), 1);
+}
+
+void ThreadPool::run() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      task_available.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (tasks.empty()) {
+        return;  // stopping
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+      num_active++;
+    }
+    try {
+      task();
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      num_active--;
+      if (tasks.empty() && num_active == 0) {
+        tasks_done.notify_all();
+      }
+    }
+  }
+}
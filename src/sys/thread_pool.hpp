@@ -0,0 +1,44 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads executing submitted tasks in FIFO order.
+// The first exception thrown by a task is rethrown by wait().
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t num_threads);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  void submit(std::function<void()> task);
+
+  // Wait until all submitted tasks are finished.
+  void wait();
+
+  size_t size() const { return workers.size(); }
+
+  // Default number of threads based on the configured maximum number of
+  // instances.
+  static size_t getDefaultNumThreads();
+
+ private:
+  void run();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable task_available;
+  std::condition_variable tasks_done;
+  size_t num_active;
+  bool stopping;
+  std::exception_ptr error;
+};
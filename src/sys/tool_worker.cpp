@@ -0,0 +1,260 @@
+#include "sys/tool_worker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#ifndef _WIN64
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#endif
+
+struct ToolWorkerPool::Worker {
+  HANDLE pid = 0;
+  int in_fd = -1;   // standard input of the worker
+  int out_fd = -1;  // standard output and error of the worker
+  std::string buffer;
+
+  ~Worker() {
+#ifndef _WIN64
+    if (in_fd >= 0) {
+      close(in_fd);
+    }
+    if (out_fd >= 0) {
+      close(out_fd);
+    }
+    if (pid > 0) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+    }
+#endif
+  }
+};
+
+ToolWorkerPool::ToolWorkerPool(const std::vector<std::string>& args,
+                               const std::string& end_command,
+                               const std::string& end_marker,
+                               size_t max_workers,
+                               const std::string& working_dir)
+    : args(args),
+      end_command(end_command),
+      end_marker(end_marker),
+      max_workers(std::max<size_t>(max_workers, 1)),
+      working_dir(working_dir),
+      num_busy(0),
+      num_starts(0) {}
+
+ToolWorkerPool::~ToolWorkerPool() { shutdown(); }
+
+size_t ToolWorkerPool::getNumStarts() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return num_starts;
+}
+
+void ToolWorkerPool::shutdown() {
+  std::vector<std::unique_ptr<Worker>> workers;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    workers.swap(idle);
+  }
+  workers.clear();  // kills the processes
+}
+
+std::unique_ptr<ToolWorkerPool::Worker> ToolWorkerPool::acquire() {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    worker_available.wait(lock, [&] {
+      return !idle.empty() || num_busy < max_workers;
+    });
+    num_busy++;
+    if (!idle.empty()) {
+      auto worker = std::move(idle.back());
+      idle.pop_back();
+      return worker;
+    }
+    num_starts++;
+  }
+  try {
+    return start();
+  } catch (...) {
+    release(nullptr);
+    throw;
+  }
+}
+
+void ToolWorkerPool::release(std::unique_ptr<Worker> worker) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    num_busy--;
+    if (worker) {
+      idle.emplace_back(std::move(worker));
+    }
+  }
+  worker_available.notify_one();
+}
+
+#ifdef _WIN64
+
+std::unique_ptr<ToolWorkerPool::Worker> ToolWorkerPool::start() {
+  throw std::runtime_error(
+      "tool workers are only supported on Unix-like systems");
+}
+
+int ToolWorkerPool::eval(const std::string& request, int timeoutSeconds,
+                         std::vector<std::string>& output) {
+  throw std::runtime_error(
+      "tool workers are only supported on Unix-like systems");
+}
+
+#else
+
+std::unique_ptr<ToolWorkerPool::Worker> ToolWorkerPool::start() {
+  // write errors to dead workers are handled using return codes
+  static const auto ignored = std::signal(SIGPIPE, SIG_IGN);
+  (void)ignored;
+  int in_pipe[2], out_pipe[2];
+  if (pipe(in_pipe) != 0) {
+    throw std::runtime_error("pipe failed");
+  }
+  if (pipe(out_pipe) != 0) {
+    close(in_pipe[0]);
+    close(in_pipe[1]);
+    throw std::runtime_error("pipe failed");
+  }
+  // the parent ends must not be inherited by other child processes, because
+  // else the workers would not see the end of their input
+  fcntl(in_pipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(out_pipe[0], F_SETFD, FD_CLOEXEC);
+  int pid = fork();
+  if (pid < 0) {
+    for (int fd : {in_pipe[0], in_pipe[1], out_pipe[0], out_pipe[1]}) {
+      close(fd);
+    }
+    throw std::runtime_error("fork failed");
+  }
+  if (pid == 0) {
+    // Child
+    if (!working_dir.empty() && chdir(working_dir.c_str()) != 0) {
+      _exit(PROCESS_ERROR_CHDIR);
+    }
+    dup2(in_pipe[0], STDIN_FILENO);
+    dup2(out_pipe[1], STDOUT_FILENO);
+    dup2(out_pipe[1], STDERR_FILENO);
+    for (int fd : {in_pipe[0], in_pipe[1], out_pipe[0], out_pipe[1]}) {
+      close(fd);
+    }
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    execvp(argv[0], argv.data());
+    _exit(PROCESS_ERROR_EXEC);
+  }
+  // Parent
+  close(in_pipe[0]);
+  close(out_pipe[1]);
+  // writing requests must not block while the worker is busy
+  fcntl(in_pipe[1], F_SETFL, fcntl(in_pipe[1], F_GETFL) | O_NONBLOCK);
+  std::unique_ptr<Worker> worker(new Worker());
+  worker->pid = pid;
+  worker->in_fd = in_pipe[1];
+  worker->out_fd = out_pipe[0];
+  return worker;
+}
+
+static int exitCode(int status) {
+  if (WIFEXITED(status)) {
+    return WEXITSTATUS(status);
+  }
+  if (WIFSIGNALED(status)) {
+    return 128 + WTERMSIG(status);
+  }
+  return -1;
+}
+
+int ToolWorkerPool::eval(const std::string& request, int timeoutSeconds,
+                         std::vector<std::string>& output) {
+  output.clear();
+  auto worker = acquire();
+  const std::string input = request + "\n" + end_command + "\n";
+  size_t written = 0;
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(timeoutSeconds);
+  char chunk[4096];
+  while (true) {
+    // wait for output of the worker or for space in its input pipe
+    const auto remaining =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())
+            .count();
+    if (remaining <= 0) {
+      worker.reset();  // kills the process
+      release(nullptr);
+      return PROCESS_ERROR_TIMEOUT;
+    }
+    struct pollfd fds[2];
+    fds[0] = {worker->out_fd, POLLIN, 0};
+    fds[1] = {worker->in_fd, POLLOUT, 0};
+    const nfds_t num_fds = (written < input.size()) ? 2 : 1;
+    const int ready = poll(fds, num_fds, static_cast<int>(remaining));
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      release(nullptr);
+      throw std::runtime_error("poll failed");
+    }
+    if (num_fds == 2 && (fds[1].revents & POLLOUT)) {
+      const ssize_t n = write(worker->in_fd, input.data() + written,
+                              input.size() - written);
+      if (n > 0) {
+        written += n;
+      } else if (n < 0 && errno != EINTR && errno != EAGAIN) {
+        written = input.size();  // the worker died; read its remaining output
+      }
+    }
+    if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) {
+      continue;
+    }
+    const ssize_t n = read(worker->out_fd, chunk, sizeof(chunk));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // the worker terminated before printing the end marker
+      if (!worker->buffer.empty()) {
+        output.push_back(worker->buffer);
+      }
+      int status = 0;
+      waitpid(worker->pid, &status, 0);
+      worker->pid = 0;
+      worker.reset();
+      release(nullptr);
+      const int code = exitCode(status);
+      return code != 0 ? code : PROCESS_ERROR_INCOMPLETE;
+    }
+    worker->buffer.append(chunk, n);
+    size_t pos;
+    while ((pos = worker->buffer.find('\n')) != std::string::npos) {
+      auto line = worker->buffer.substr(0, pos);
+      worker->buffer.erase(0, pos + 1);
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (line == end_marker) {
+        worker->buffer.clear();
+        release(std::move(worker));
+        return 0;
+      }
+      output.push_back(line);
+    }
+  }
+}
+
+#endif
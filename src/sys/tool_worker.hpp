@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sys/process.hpp"
+
+// Pool of long-lived external tool processes, e.g. PARI/GP interpreters.
+// A request is written to the standard input of an idle worker, followed by
+// a command that makes the tool print an end marker line. All output lines
+// (standard output and error) up to the marker form the response. Workers
+// are started on demand up to a maximum number. A worker that does not
+// respond in time is killed and replaced by a new one on the next request.
+class ToolWorkerPool {
+ public:
+  ToolWorkerPool(const std::vector<std::string>& args,
+                 const std::string& end_command, const std::string& end_marker,
+                 size_t max_workers, const std::string& working_dir = "");
+
+  ~ToolWorkerPool();
+
+  ToolWorkerPool(const ToolWorkerPool&) = delete;
+  ToolWorkerPool& operator=(const ToolWorkerPool&) = delete;
+
+  // Evaluate a request and write the output lines to 'output'. Returns 0 on
+  // success, PROCESS_ERROR_TIMEOUT if the request timed out, or the exit code
+  // of a worker that terminated before printing the end marker. If such a
+  // worker exited with code 0, PROCESS_ERROR_INCOMPLETE is returned.
+  int eval(const std::string& request, int timeoutSeconds,
+           std::vector<std::string>& output);
+
+  // Number of worker processes started so far.
+  size_t getNumStarts() const;
+
+  // Terminate all idle workers.
+  void shutdown();
+
+ private:
+  struct Worker;
+
+  std::unique_ptr<Worker> acquire();
+
+  void release(std::unique_ptr<Worker> worker);
+
+  std::unique_ptr<Worker> start();
+
+  const std::vector<std::string> args;
+  const std::string end_command;
+  const std::string end_marker;
+  const size_t max_workers;
+  const std::string working_dir;
+
+  mutable std::mutex mutex;
+  std::condition_variable worker_available;
+  std::vector<std::unique_ptr<Worker>> idle;
+  size_t num_busy;
+  size_t num_starts;
+};
@@ -0,0 +1,157 @@
+#include "sys/trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "sys/log.hpp"
+#include "sys/util.hpp"
+
+std::atomic<bool> Trace::enabled(false);
+
+namespace {
+
+struct Event {
+  const char* category;
+  const char* name;
+  Trace::time_point start;
+  Trace::time_point end;
+  std::string arg;
+  size_t tid;
+};
+
+struct Buffer;
+
+struct Registry {
+  std::mutex mutex;
+  std::set<Buffer*> buffers;
+  std::vector<Event> retired;  // events of finished threads
+  std::string path;
+  Trace::time_point start_time;
+  size_t next_tid = 0;
+  bool registered_exit = false;
+};
+
+Registry& getRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+// Ring buffer of a thread. The lock is only contended while the events are
+// written to the trace file.
+struct Buffer {
+  std::mutex mutex;
+  std::vector<Event> events;
+  size_t next = 0;
+  size_t tid;
+
+  Buffer() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    tid = registry.next_tid++;
+    registry.buffers.insert(this);
+  }
+
+  ~Buffer() {
+    auto& registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::move(events.begin(), events.end(),
+              std::back_inserter(registry.retired));
+    registry.buffers.erase(this);
+  }
+
+  void add(Event&& e) {
+    if (events.size() < Trace::BUFFER_SIZE) {
+      events.emplace_back(std::move(e));
+    } else {
+      events[next] = std::move(e);  // overwrite the oldest event
+      next = (next + 1) % Trace::BUFFER_SIZE;
+    }
+  }
+};
+
+Buffer& getBuffer() {
+  thread_local Buffer buffer;
+  return buffer;
+}
+
+void stopAtExit() { Trace::stop(); }
+
+int64_t toMicros(Trace::time_point t, Trace::time_point start_time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(t - start_time)
+      .count();
+}
+
+}  // namespace
+
+void Trace::start(const std::string& path) {
+  auto& registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  registry.path = path;
+  registry.start_time = std::chrono::steady_clock::now();
+  // the log is used by stop() and must outlive the exit handler
+  Log::get().debug("Recording trace events for " + path);
+  if (!registry.registered_exit) {
+    std::atexit(stopAtExit);
+    registry.registered_exit = true;
+  }
+  enabled = true;
+}
+
+void Trace::stop() {
+  if (!enabled.exchange(false)) {
+    return;
+  }
+  auto& registry = getRegistry();
+  std::vector<Event> events;
+  std::string path;
+  time_point start_time;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    events.swap(registry.retired);
+    for (auto buffer : registry.buffers) {
+      std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+      std::move(buffer->events.begin(), buffer->events.end(),
+                std::back_inserter(events));
+      buffer->events.clear();
+      buffer->next = 0;
+    }
+    path = registry.path;
+    start_time = registry.start_time;
+  }
+  std::sort(events.begin(), events.end(),
+            [](const Event& a, const Event& b) { return a.start < b.start; });
+  std::ofstream out(path);
+  if (!out) {
+    Log::get().error("Error writing trace file: " + path, false);
+    return;
+  }
+  out << "{\"traceEvents\":[";
+  bool first = true;
+  for (const auto& e : events) {
+    out << (first ? "\n" : ",\n");
+    first = false;
+    out << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+        << "\",\"ph\":\"X\",\"ts\":" << toMicros(e.start, start_time)
+        << ",\"dur\":" << toMicros(e.end, e.start) << ",\"pid\":0,\"tid\":"
+        << e.tid;
+    if (!e.arg.empty()) {
+      out << ",\"args\":{\"arg\":\"" << escapeJsonString(e.arg) << "\"}";
+    }
+    out << "}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.close();
+  Log::get().info("Wrote " + std::to_string(events.size()) +
+                  " trace events to " + path);
+}
+
+void Trace::record(const char* category, const char* name, time_point start,
+                   time_point end, const std::string& arg) {
+  auto& buffer = getBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.add({category, name, start, end, arg, buffer.tid});
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Opt-in event tracing in the Chrome trace format, which can be viewed using
+// chrome://tracing or Perfetto. Events are recorded into a ring buffer per
+// thread, i.e. only the most recent events of each thread are kept. The
+// buffers are written to the trace file when tracing is stopped or the
+// process exits. If tracing is disabled, a span costs a single flag check.
+class Trace {
+ public:
+  using time_point = std::chrono::time_point<std::chrono::steady_clock>;
+
+  // maximum number of events per thread
+  static constexpr size_t BUFFER_SIZE = 1 << 16;
+
+  // Measures a complete event until the end of the current scope. The
+  // category and name must be string literals or have static lifetime.
+  class Span {
+   public:
+    Span(const char* category, const char* name)
+        : category(category), name(name), active(isEnabled()) {
+      if (active) {
+        start = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~Span() {
+      if (active) {
+        record(category, name, start, std::chrono::steady_clock::now(), arg);
+      }
+    }
+
+    // Returns true if the event is recorded.
+    explicit operator bool() const { return active; }
+
+    // Sets an additional argument, e.g. a sequence ID, shown in the viewer.
+    void setArg(const std::string& a) { arg = a; }
+
+   private:
+    const char* const category;
+    const char* const name;
+    const bool active;
+    time_point start;
+    std::string arg;
+  };
+
+  static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+  // Enables tracing. The events are written to the given file by stop(),
+  // which is also called automatically at exit.
+  static void start(const std::string& path);
+
+  // Writes the recorded events of all threads and disables tracing.
+  static void stop();
+
+  // Records a complete event in the buffer of the current thread.
+  static void record(const char* category, const char* name, time_point start,
+                     time_point end, const std::string& arg = std::string());
+
+ private:
+  static std::atomic<bool> enabled;
+};
@@ -8,6 +8,7 @@
 #include "sys/file.hpp"
 #include "sys/log.hpp"
 #include "sys/setup.hpp"
+#include "sys/trace.hpp"
 
 #define cstr(a) std::string(xstr(a))
 #define xstr(a) ystr(a)
@@ -51,7 +52,9 @@ enum class Option {
   NUM_MINE_HOURS,
   MINER_PROFILE,
   EXPORT_FORMAT,
-  LOG_LEVEL
+  LOG_LEVEL,
+  LOG_FILE,
+  TRACE_FILE
 };
 
 std::vector<std::string> Settings::parseArgs(int argc, char* argv[]) {
@@ -90,6 +93,8 @@ std::vector<std::string> Settings::parseArgs(int argc, char* argv[]) {
           num_mine_hours = val;
           break;
         case Option::LOG_LEVEL:
+        case Option::LOG_FILE:
+        case Option::TRACE_FILE:
         case Option::MINER_PROFILE:
         case Option::EXPORT_FORMAT:
         case Option::NONE:
@@ -102,6 +107,12 @@ std::vector<std::string> Settings::parseArgs(int argc, char* argv[]) {
     } else if (option == Option::EXPORT_FORMAT) {
       export_format = arg;
       option = Option::NONE;
+    } else if (option == Option::TRACE_FILE) {
+      Trace::start(arg);
+      option = Option::NONE;
+    } else if (option == Option::LOG_FILE) {
+      Log::get().setFile(arg);
+      option = Option::NONE;
     } else if (option == Option::LOG_LEVEL) {
       if (arg == "debug") {
         Log::get().level = Log::Level::DEBUG;
@@ -149,6 +160,10 @@ std::vector<std::string> Settings::parseArgs(int argc, char* argv[]) {
         report_cpu_hours = false;
       } else if (opt == "l") {
         option = Option::LOG_LEVEL;
+      } else if (opt == "L") {
+        option = Option::LOG_FILE;
+      } else if (opt == "T") {
+        option = Option::TRACE_FILE;
       } else {
         Log::get().error("Unknown option: -" + opt, true);
       }
@@ -2,6 +2,8 @@
 
 #include <cstring>
 #include <fstream>
+#include <mutex>
+#include <sstream>
 
 #include <curl/curl.h>
 
@@ -16,13 +18,15 @@
 int64_t WebClient::WEB_CLIENT_TYPE = 0;
 
 void WebClient::initWebClient() {
-  if (WEB_CLIENT_TYPE == 0) {
+  // requests are also sent from background threads
+  static std::once_flag init_flag;
+  std::call_once(init_flag, []() {
     curl_global_init(CURL_GLOBAL_DEFAULT);
     WEB_CLIENT_TYPE = 1;
     // Note: curl_global_cleanup() is intentionally not called as it's not
     // thread-safe and the library remains usable for the lifetime of the
     // program. This is a common pattern for libcurl usage.
-  }
+  });
 }
 
 namespace {
@@ -45,14 +49,6 @@ size_t writeStringCallback(void* contents, size_t size, size_t nmemb,
   return total_size;
 }
 
-// Callback function to read data from a file
-size_t readFileCallback(void* ptr, size_t size, size_t nmemb, void* userp) {
-  std::ifstream* file = static_cast<std::ifstream*>(userp);
-  size_t total_size = size * nmemb;
-  file->read(static_cast<char*>(ptr), total_size);
-  return file->gcount();
-}
-
 }  // namespace
 
 bool WebClient::get(const std::string& url, const std::string& local_path,
@@ -111,6 +107,26 @@ bool WebClient::postFile(const std::string& url, const std::string& file_path,
                          const std::string& auth,
                          const std::vector<std::string>& headers,
                          bool enable_debug) {
+  std::string content;
+  if (!file_path.empty()) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+      if (enable_debug) {
+        Log::get().error("Failed to open file: " + file_path, false);
+      }
+      return false;
+    }
+    std::stringstream buf;
+    buf << file.rdbuf();
+    content = buf.str();
+  }
+  return postContent(url, content, auth, headers, enable_debug);
+}
+
+bool WebClient::postContent(const std::string& url, const std::string& content,
+                            const std::string& auth,
+                            const std::vector<std::string>& headers,
+                            bool enable_debug) {
   initWebClient();
 
   CURL* curl = curl_easy_init();
@@ -135,40 +151,11 @@ bool WebClient::postFile(const std::string& url, const std::string& file_path,
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header_list);
   }
 
-  std::ifstream file;
-  if (!file_path.empty()) {
-    file.open(file_path, std::ios::binary);
-    if (!file.is_open()) {
-      curl_slist_free_all(header_list);
-      curl_easy_cleanup(curl);
-      if (enable_debug) {
-        Log::get().error("Failed to open file: " + file_path, false);
-      }
-      return false;
-    }
-
-    file.seekg(0, std::ios::end);
-    std::streampos pos = file.tellg();
-    if (pos == std::streampos(-1)) {
-      file.close();
-      curl_slist_free_all(header_list);
-      curl_easy_cleanup(curl);
-      if (enable_debug) {
-        Log::get().error("Failed to determine file size: " + file_path, false);
-      }
-      return false;
-    }
-    size_t file_size = static_cast<size_t>(pos);
-    file.seekg(0, std::ios::beg);
-
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_READFUNCTION, readFileCallback);
-    curl_easy_setopt(curl, CURLOPT_READDATA, &file);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(file_size));
-  } else {
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, 0L);
-  }
+  // the content is not copied and must outlive the request
+  curl_easy_setopt(curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, content.data());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
+                   static_cast<long>(content.size()));
 
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
   curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
@@ -184,9 +171,6 @@ bool WebClient::postFile(const std::string& url, const std::string& file_path,
 
   CURLcode res = curl_easy_perform(curl);
 
-  if (file.is_open()) {
-    file.close();
-  }
   curl_slist_free_all(header_list);
   curl_easy_cleanup(curl);
 
@@ -16,6 +16,12 @@ class WebClient {
                        const std::vector<std::string>& headers = {},
                        bool enable_debug = false);
 
+  // Posts the given content directly, i.e. without a temporary file.
+  static bool postContent(const std::string& url, const std::string& content,
+                          const std::string& auth = std::string(),
+                          const std::vector<std::string>& headers = {},
+                          bool enable_debug = false);
+
   static jute::jValue getJson(const std::string& url);
 
  private: